@@ -23,6 +23,39 @@
 //#define FEATURE_TEST
 //#define LOOKUP_TEST
 
+///////////////////////////////////TABLE DATA///////////////////////////////////////////
+
+//Keep the raw font tables alive and read big endian arrays (coverage glyphs, class values,
+//substitutes, cmap segments etc.) in place instead of copying them while parsing.
+#define SF_TABLE_VIEWS
+
+//Read the subtables of a lookup when it is applied for the first time instead of while
+//opening the font. This relies on the table data that is kept alive for the views.
+#ifdef SF_TABLE_VIEWS
+#define SF_LAZY_LOOKUPS
+#endif
+
+//Parse the tables of a font and large lookup lists on separate threads while opening the
+//font. This only pays off when lookups are not read lazily. The output of the test macros
+//is interleaved when it is enabled.
+#ifndef SF_LAZY_LOOKUPS
+#define SF_PARALLEL_TABLES
+#endif
+
+//Keep a bitmap of the glyphs of large coverage tables while reading them, so that finding
+//the coverage index of a glyph does not have to search the table.
+#define SF_COVERAGE_BITMAPS
+
+////////////////////////////////////////////////////////////////////////////////////////
+
+/////////////////////////////////////////MEMORY/////////////////////////////////////////
+
+//Count the allocations and bytes of every subsystem of the library. Each allocation carries
+//a small header recording its size.
+#define SF_ALLOCATION_STATS
+
+////////////////////////////////////////////////////////////////////////////////////////
+
 /////////////////DEFINE TABLES THAT ARE IMPLEMENTED IN THE LIBRARY//////////////////////
 
 //////////////////////////////////////GDEF TABLE////////////////////////////////////////
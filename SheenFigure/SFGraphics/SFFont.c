@@ -14,102 +14,264 @@
  * limitations under the License.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if !defined(SF_IOS_CG) && !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define SF_MMAP_FONT_FILES
+#endif
 
+#include "SFAllocator.h"
+#include "SFAtomic.h"
 #include "SFFontPrivate.h"
+#include "SFFontCache.h"
+#include "SFFontRegistry.h"
 #include "SFFont.h"
 
+static void releaseTableData(SFTableData data) {
+    if (data) {
+#ifdef SF_IOS_CG
+        CFRelease(data);
+#else
+        SFFree(SFSubsystemFont, data);
+#endif
+    }
+}
+
+#ifndef SF_IOS_CG
+
+static const SFUByte *mapFontFile(const char *path, size_t *length, SFBool *ownsData) {
+#ifdef SF_MMAP_FONT_FILES
+    struct stat fileStat;
+    void *data;
+    int fd;
+    
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    
+    data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    
+    if (data == MAP_FAILED)
+        return NULL;
+    
+    *length = fileStat.st_size;
+    *ownsData = SFTrue;
+    
+    return data;
+#else
+    //Without mmap the file is read into a single buffer, which is still shared by all tables.
+    FILE *file;
+    SFUByte *data;
+    long size;
+    
+    file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+    
+    data = SFAllocate(SFSubsystemFont, size);
+    if (fread(data, 1, size, file) != (size_t)size) {
+        SFFree(SFSubsystemFont, data);
+        fclose(file);
+        return NULL;
+    }
+    
+    fclose(file);
+    
+    *length = size;
+    *ownsData = SFTrue;
+    
+    return data;
+#endif
+}
+
+static void unmapFontData(const SFUByte *data, size_t length, SFBool ownsData) {
+    if (!ownsData)
+        return;
+    
+#ifdef SF_MMAP_FONT_FILES
+    munmap((void *)data, length);
+#else
+    SFFree(SFSubsystemFont, (void *)data);
+#endif
+}
+
+#endif
+
 static SFFontTablesRef SFFontTablesCreate() {
-    SFFontTablesRef sfFontTables = malloc(sizeof(SFFontTables));
+    SFFontTablesRef sfFontTables = SFAllocate(SFSubsystemFont, sizeof(SFFontTables));
+    sfFontTables->_tablesRead = 0;
+    pthread_mutex_init(&sfFontTables->_readMutex, NULL);
+    
     sfFontTables->_availableTables = 0;
+    
+    SFArenaInitialize(&sfFontTables->_arena);
+    sfFontTables->_snapshot = NULL;
+    sfFontTables->_snapshotLength = 0;
+    sfFontTables->_shapePlans = NULL;
+    
+    memset(sfFontTables->_tableSizes, 0, sizeof(sfFontTables->_tableSizes));
+    memset(sfFontTables->_slices, 0, sizeof(sfFontTables->_slices));
+    memset(sfFontTables->_tableData, 0, sizeof(sfFontTables->_tableData));
+    memset(&sfFontTables->_gdef, 0, sizeof(SFTableGDEF));
+    
+#ifndef SF_IOS_CG
+    sfFontTables->_fileData = NULL;
+    sfFontTables->_fileLength = 0;
+    sfFontTables->_ownsFileData = SFFalse;
+#endif
+    
+    memset(&sfFontTables->_key, 0, sizeof(SFRegistryKey));
+    sfFontTables->_lastUse = 0;
+    sfFontTables->_previousEntry = NULL;
+    sfFontTables->_nextEntry = NULL;
+    
     sfFontTables->_retainCount = 1;
     
     return sfFontTables;
 }
 
-static SFFontTablesRef SFFontTablesRetain(SFFontTablesRef sfFontTables) {
-    if (sfFontTables) {
-        sfFontTables->_retainCount++;
+void SFFontTablesDestroy(SFFontTablesRef sfFontTables) {
+    int i;
+    
+    if (sfFontTables->_snapshot) {
+        SFFontCacheReleaseSnapshot(sfFontTables->_snapshot, sfFontTables->_snapshotLength);
     }
     
-    return sfFontTables;
+    SFArenaFinalize(&sfFontTables->_arena);
+    
+    for (i = 0; i < tiCount; i++)
+        releaseTableData(sfFontTables->_tableData[i]);
+    
+#ifndef SF_IOS_CG
+    unmapFontData(sfFontTables->_fileData, sfFontTables->_fileLength, sfFontTables->_ownsFileData);
+#endif
+    
+    SFFree(SFSubsystemFont, sfFontTables->_key.path);
+    
+    pthread_mutex_destroy(&sfFontTables->_readMutex);
+    
+    SFFree(SFSubsystemFont, sfFontTables);
 }
 
-static void SFFontTablesRelease(SFFontTablesRef sfFontTables) {
-    if (!sfFontTables) {
-        return;
-    }
+size_t SFFontTablesGetMemoryUsage(SFFontTablesRef sfFontTables) {
+    size_t usage = sizeof(SFFontTables);
+    int i;
     
-    sfFontTables->_retainCount--;
+    pthread_mutex_lock(&sfFontTables->_readMutex);
+    SFArenaLock(&sfFontTables->_arena);
     
-    if (sfFontTables->_retainCount == 0) {
-        if (sfFontTables->_availableTables & itCMAP) {
-            SFFreeCMAP(&sfFontTables->_cmap);
-        }
-        
-        if (sfFontTables->_availableTables & itGDEF) {
-            SFFreeGDEF(&sfFontTables->_gdef);
-        }
-        
-        if (sfFontTables->_availableTables & itGSUB) {
-            SFFreeGSUB(&sfFontTables->_gsub);
-        }
-        
-        if (sfFontTables->_availableTables & itGPOS) {
-            SFFreeGPOS(&sfFontTables->_gpos);
-        }
-        
-        free(sfFontTables);
+    usage += SFArenaGetSize(&sfFontTables->_arena);
+    
+    usage += sfFontTables->_snapshotLength;
+    
+    for (i = 0; i < tiCount; i++) {
+        if (sfFontTables->_tableData[i])
+            usage += sfFontTables->_slices[i].length;
     }
+    
+#ifndef SF_IOS_CG
+    if (sfFontTables->_ownsFileData)
+        usage += sfFontTables->_fileLength;
+#endif
+    
+    SFArenaUnlock(&sfFontTables->_arena);
+    pthread_mutex_unlock(&sfFontTables->_readMutex);
+    
+    return usage;
 }
 
-#ifdef SF_IOS_CG
-
-static void readCMAPTable(SFFontRef sfFont) {
-    CFDataRef cmapData = CGFontCopyTableForTag(sfFont->_cgFont, 'cmap');
+void SFFontGetMemoryUsage(SFFontRef sfFont, SFFontMemoryUsage *usage) {
+    SFFontTablesRef sfFontTables = sfFont->_tables;
+    int i;
+    
+    pthread_mutex_lock(&sfFontTables->_readMutex);
+    SFArenaLock(&sfFontTables->_arena);
     
-    if (cmapData) {
-        const SFUByte * const tableBytes = CFDataGetBytePtr(cmapData);
-        SFReadCMAP(tableBytes, &sfFont->_tables->_cmap, CFDataGetLength(cmapData));
-        sfFont->_tables->_availableTables |= itCMAP;
+    usage->cmap = sfFontTables->_tableSizes[tiCMAP];
+    usage->gdef = sfFontTables->_tableSizes[tiGDEF];
+    usage->gsub = sfFontTables->_tableSizes[tiGSUB];
+    usage->gpos = sfFontTables->_tableSizes[tiGPOS];
+    
+    if (sfFontTables->_tablesRead && (sfFontTables->_availableTables & itCMAP))
+        usage->cmap += sfFontTables->_cmap.loadedSize;
+    
+#ifdef SF_LAZY_LOOKUPS
+    //The lookup lists of missing tables are never read.
+    if (sfFontTables->_tablesRead) {
+        if (sfFontTables->_availableTables & itGSUB)
+            usage->gsub += sfFontTables->_gsub.lookupList.loadedSize;
         
-        CFRelease(cmapData);
+        if (sfFontTables->_availableTables & itGPOS)
+            usage->gpos += sfFontTables->_gpos.lookupList.loadedSize;
     }
-}
-
-static void readGDEFTable(SFFontRef sfFont) {
-    CFDataRef gdefData = CGFontCopyTableForTag(sfFont->_cgFont, 'GDEF');
+#endif
     
-    if (gdefData) {
-        const SFUByte * const tableBytes = CFDataGetBytePtr(gdefData);
-        SFReadGDEF(tableBytes, &sfFont->_tables->_gdef);
-        sfFont->_tables->_availableTables |= itGDEF;
-        
-        CFRelease(gdefData);
+    usage->tableData = 0;
+    
+    for (i = 0; i < tiCount; i++) {
+        if (sfFontTables->_tableData[i])
+            usage->tableData += sfFontTables->_slices[i].length;
     }
+    
+    SFArenaUnlock(&sfFontTables->_arena);
+    pthread_mutex_unlock(&sfFontTables->_readMutex);
+    
+    usage->total = sizeof(SFFont) + SFFontTablesGetMemoryUsage(sfFontTables);
 }
 
-static void readGSUBTable(SFFontRef sfFont) {
-    CFDataRef gsubTable = CGFontCopyTableForTag(sfFont->_cgFont, 'GSUB');
+//Hands out the registered tables with the same content if there are any. Otherwise the
+//new tables are registered and returned.
+static SFFontTablesRef shareTablesByContent(SFFontTablesRef sfFontTables) {
+    SFFontTablesRef registeredTables;
+    SFRegistryKey key;
+    int i;
     
-    if (gsubTable) {
-        const SFUByte * const tableBytes = CFDataGetBytePtr(gsubTable);
-        SFReadGSUB(tableBytes, &sfFont->_tables->_gsub);
-        sfFont->_tables->_availableTables |= itGSUB;
-        
-        CFRelease(gsubTable);
-    }
+    memset(&key, 0, sizeof(SFRegistryKey));
+    key.type = rkContent;
+    key.hash = SFFontCacheMakeKey(sfFontTables->_slices);
+    
+    for (i = 0; i < tiCount; i++)
+        key.lengths[i] = sfFontTables->_slices[i].length;
+    
+    registeredTables = SFFontRegistryAddTables(sfFontTables, &key);
+    if (registeredTables != sfFontTables)
+        SFFontTablesDestroy(sfFontTables);
+    
+    return registeredTables;
 }
 
-static void readGPOSTable(SFFontRef sfFont) {
-    CFDataRef gposTable = CGFontCopyTableForTag(sfFont->_cgFont, 'GPOS');
+#ifdef SF_IOS_CG
+
+static void loadTables(SFFontTablesRef sfFontTables, CGFontRef cgFont) {
+    static const SFUInt tags[tiCount] = { 'cmap', 'GDEF', 'GSUB', 'GPOS' };
+    int i;
     
-    if (gposTable) {
-        const SFUByte * const tableBytes = CFDataGetBytePtr(gposTable);
-        SFReadGPOS(tableBytes, &sfFont->_tables->_gpos);
-        sfFont->_tables->_availableTables |= itGPOS;
+    for (i = 0; i < tiCount; i++) {
+        CFDataRef tableData = CGFontCopyTableForTag(cgFont, tags[i]);
         
-        CFRelease(gposTable);
+        if (tableData) {
+            sfFontTables->_slices[i].data = CFDataGetBytePtr(tableData);
+            sfFontTables->_slices[i].length = (SFUInt)CFDataGetLength(tableData);
+        }
+        
+        sfFontTables->_tableData[i] = tableData;
     }
 }
 
@@ -122,9 +284,14 @@ static void setFontSize(SFFontRef sfFont, SFFloat size) {
 }
 
 SFFontRef SFFontCreateWithCGFont(CGFontRef cgFont, SFFloat size) {
-    SFFont *sfFont = malloc(sizeof(SFFont));
+    SFFont *sfFont = SFAllocate(SFSubsystemFont, sizeof(SFFont));
+    SFFontTablesRef sfFontTables;
+    
+    sfFontTables = SFFontTablesCreate();
+    loadTables(sfFontTables, cgFont);
+    
     sfFont->_cgFont = CGFontRetain(cgFont);
-    sfFont->_tables = SFFontTablesCreate();
+    sfFont->_tables = shareTablesByContent(sfFontTables);
     
     setFontSize(sfFont, size);
     
@@ -135,9 +302,9 @@ SFFontRef SFFontCreateWithCGFont(CGFontRef cgFont, SFFloat size) {
 }
 
 SFFontRef SFFontMakeCloneForCGFont(SFFontRef sfFont, CGFontRef cgFont, SFFloat size) {
-    SFFont *clone = malloc(sizeof(SFFont));
+    SFFont *clone = SFAllocate(SFSubsystemFont, sizeof(SFFont));
     clone->_cgFont = CGFontRetain(cgFont);
-    clone->_tables = SFFontTablesRetain(sfFont->_tables);
+    clone->_tables = SFFontRegistryRetainTables(sfFont->_tables);
     
     setFontSize(clone, size);
     
@@ -153,96 +320,98 @@ CGFontRef SFFontGetCGFont(SFFontRef sfFont) {
 
 #else
 
-static void readCMAPTable(SFFontRef sfFont) {
-	FT_ULong length = 0;
-    
-    FT_Tag tag;
-    FT_Byte *buffer;
-    
-    FT_Error error;
-    
-	tag = FT_MAKE_TAG('c', 'm', 'a', 'p');
-	error = FT_Load_Sfnt_Table(sfFont->_ftFace, tag, 0, NULL, &length);
-	if (error)
-		return;
-    
-	buffer = malloc(length);
-	error = FT_Load_Sfnt_Table(sfFont->_ftFace, tag, 0, buffer, &length);
-	if (!error) {
-		SFReadCMAP(buffer, &sfFont->_tables->_cmap, length);
-		sfFont->_tables->_availableTables |= itCMAP;
-	}
-    
-	free(buffer);
-}
-
-static void readGDEFTable(SFFontRef sfFont) {
-	FT_ULong length = 0;
+static SFBool readTableDirectory(SFFontTablesRef sfFontTables, FT_Long faceIndex) {
+    const SFUByte *data = sfFontTables->_fileData;
+    size_t length = sfFontTables->_fileLength;
     
-    FT_Tag tag;
-    FT_Byte *buffer;
+    SFUInt offset = 0;
+    SFUShort numTables;
+    SFUShort i;
     
-    FT_Error error;
+    if (length < 12)
+        return SFFalse;
     
-	tag = FT_MAKE_TAG('G', 'D', 'E', 'F');
-	error = FT_Load_Sfnt_Table(sfFont->_ftFace, tag, 0, NULL, &length);
-	if (error)
-		return;
-    
-	buffer = malloc(length);
-	error = FT_Load_Sfnt_Table(sfFont->_ftFace, tag, 0, buffer, &length);
-	if (!error) {
-		SFReadGDEF(buffer, &sfFont->_tables->_gdef);
-		sfFont->_tables->_availableTables |= itGDEF;
-	}
-    
-	free(buffer);
-}
-
-static void readGSUBTable(SFFontRef sfFont) {
-	FT_ULong length = 0;
-    
-    FT_Tag tag;
-    FT_Byte *buffer;
-    
-    FT_Error error;
+    //Font collections keep an offset table for each of their faces.
+    if (SFReadUInt(data, 0) == TTAG_ttcf) {
+        SFUInt numFonts = SFReadUInt(data, 8);
+        
+        if (faceIndex >= numFonts || 12 + ((size_t)numFonts * 4) > length)
+            return SFFalse;
+        
+        offset = SFReadUInt(data, 12 + (faceIndex * 4));
+        if (offset > length - 12)
+            return SFFalse;
+    }
     
-	tag = FT_MAKE_TAG('G', 'S', 'U', 'B');
-	error = FT_Load_Sfnt_Table(sfFont->_ftFace, tag, 0, NULL, &length);
-	if (error)
-		return;
+    numTables = SFReadUShort(data, offset + 4);
+    if (offset + 12 + ((size_t)numTables * 16) > length)
+        return SFFalse;
     
-	buffer = malloc(length);
-	error = FT_Load_Sfnt_Table(sfFont->_ftFace, tag, 0, buffer, &length);
-	if (!error) {
-		SFReadGSUB(buffer, &sfFont->_tables->_gsub);
-		sfFont->_tables->_availableTables |= itGSUB;
-	}
+    for (i = 0; i < numTables; i++) {
+        const SFUByte *record = &data[offset + 12 + (i * 16)];
+        
+        SFUInt tag = SFReadUInt(record, 0);
+        SFUInt tableOffset = SFReadUInt(record, 8);
+        SFUInt tableLength = SFReadUInt(record, 12);
+        
+        SFTableSlice *slice;
+        
+        switch (tag) {
+            case TTAG_cmap:
+                slice = &sfFontTables->_slices[tiCMAP];
+                break;
+                
+            case TTAG_GDEF:
+                slice = &sfFontTables->_slices[tiGDEF];
+                break;
+                
+            case TTAG_GSUB:
+                slice = &sfFontTables->_slices[tiGSUB];
+                break;
+                
+            case TTAG_GPOS:
+                slice = &sfFontTables->_slices[tiGPOS];
+                break;
+                
+            default:
+                continue;
+        }
+        
+        if (tableOffset > length || tableLength > length - tableOffset)
+            continue;
+        
+        slice->data = &data[tableOffset];
+        slice->length = tableLength;
+    }
     
-	free(buffer);
+    return SFTrue;
 }
 
-static void readGPOSTable(SFFontRef sfFont) {
-	FT_ULong length = 0;
+static void loadTables(SFFontTablesRef sfFontTables, FT_Face ftFace) {
+    static const FT_Tag tags[tiCount] = { TTAG_cmap, TTAG_GDEF, TTAG_GSUB, TTAG_GPOS };
     
-    FT_Tag tag;
+    FT_ULong length;
     FT_Byte *buffer;
-    
     FT_Error error;
+    int i;
     
-	tag = FT_MAKE_TAG('G', 'P', 'O', 'S');
-	error = FT_Load_Sfnt_Table(sfFont->_ftFace, tag, 0, NULL, &length);
-	if (error)
-		return;
-    
-	buffer = malloc(length);
-    error = FT_Load_Sfnt_Table(sfFont->_ftFace, tag, 0, buffer, &length);
-	if (!error) {
-		SFReadGPOS(buffer, &sfFont->_tables->_gpos);
-		sfFont->_tables->_availableTables |= itGPOS;
-	}
-    
-	free(buffer);
+    for (i = 0; i < tiCount; i++) {
+        length = 0;
+        error = FT_Load_Sfnt_Table(ftFace, tags[i], 0, NULL, &length);
+        if (error)
+            continue;
+        
+        buffer = SFAllocate(SFSubsystemFont, length);
+        error = FT_Load_Sfnt_Table(ftFace, tags[i], 0, buffer, &length);
+        if (error) {
+            SFFree(SFSubsystemFont, buffer);
+            continue;
+        }
+        
+        sfFontTables->_slices[i].data = buffer;
+        sfFontTables->_slices[i].length = (SFUInt)length;
+        sfFontTables->_tableData[i] = buffer;
+    }
 }
 
 static void setFontSize(SFFontRef sfFont, SFFloat size) {
@@ -253,12 +422,10 @@ static void setFontSize(SFFontRef sfFont, SFFloat size) {
 	sfFont->_leading = sfFont->_ascender - sfFont->_descender;
 }
 
-SFFontRef SFFontCreateWithFTFace(FT_Face ftFace, SFFloat size) {
-    SFFont *sfFont = malloc(sizeof(SFFont));
-    
-    FT_Reference_Face(ftFace);
+static SFFontRef createWithTables(FT_Face ftFace, SFFontTablesRef sfFontTables, SFFloat size) {
+    SFFont *sfFont = SFAllocate(SFSubsystemFont, sizeof(SFFont));
     sfFont->_ftFace = ftFace;
-    sfFont->_tables = SFFontTablesCreate();
+    sfFont->_tables = sfFontTables;
     
     setFontSize(sfFont, size);
     
@@ -268,12 +435,23 @@ SFFontRef SFFontCreateWithFTFace(FT_Face ftFace, SFFloat size) {
 	return sfFont;
 }
 
+SFFontRef SFFontCreateWithFTFace(FT_Face ftFace, SFFloat size) {
+    SFFontTablesRef sfFontTables;
+    
+    sfFontTables = SFFontTablesCreate();
+    loadTables(sfFontTables, ftFace);
+    
+    FT_Reference_Face(ftFace);
+    
+    return createWithTables(ftFace, shareTablesByContent(sfFontTables), size);
+}
+
 SFFontRef SFFontMakeCloneForFTFace(SFFontRef sfFont, FT_Face ftFace, SFFloat size) {
-	SFFont *clone = malloc(sizeof(SFFont));
+	SFFont *clone = SFAllocate(SFSubsystemFont, sizeof(SFFont));
     
     FT_Reference_Face(ftFace);
 	clone->_ftFace = ftFace;
-    clone->_tables = SFFontTablesRetain(sfFont->_tables);
+    clone->_tables = SFFontRegistryRetainTables(sfFont->_tables);
     
     setFontSize(clone, size);
     
@@ -283,19 +461,266 @@ SFFontRef SFFontMakeCloneForFTFace(SFFontRef sfFont, FT_Face ftFace, SFFloat siz
 	return clone;
 }
 
+//Creates a face on the font data of registered tables, which keep the data alive.
+static SFFontRef createWithRegisteredTables(FT_Library library, SFFontTablesRef sfFontTables, FT_Long faceIndex, SFFloat size) {
+    FT_Face ftFace;
+    FT_Error error;
+    
+    error = FT_New_Memory_Face(library, sfFontTables->_fileData, sfFontTables->_fileLength, faceIndex, &ftFace);
+    if (error) {
+        SFFontRegistryReleaseTables(sfFontTables);
+        return NULL;
+    }
+    
+    return createWithTables(ftFace, sfFontTables, size);
+}
+
+static SFFontRef createWithFontData(FT_Library library, const SFUByte *data, size_t length, SFBool ownsData, FT_Long faceIndex, SFFloat size, const SFRegistryKey *key) {
+    SFFontTablesRef sfFontTables;
+    SFFontTablesRef registeredTables;
+    
+    FT_Face ftFace;
+    FT_Error error;
+    
+    error = FT_New_Memory_Face(library, data, length, faceIndex, &ftFace);
+    if (error) {
+        unmapFontData(data, length, ownsData);
+        return NULL;
+    }
+    
+    sfFontTables = SFFontTablesCreate();
+    sfFontTables->_fileData = data;
+    sfFontTables->_fileLength = length;
+    sfFontTables->_ownsFileData = ownsData;
+    
+    //Faces that FreeType reads from some other format are not laid out as an sfnt, so
+    //their tables are copied out of the face.
+    if (!readTableDirectory(sfFontTables, faceIndex & 0xFFFF))
+        loadTables(sfFontTables, ftFace);
+    
+    registeredTables = SFFontRegistryAddTables(sfFontTables, key);
+    
+    //Another thread has registered the same font in the meantime.
+    if (registeredTables != sfFontTables) {
+        FT_Done_Face(ftFace);
+        SFFontTablesDestroy(sfFontTables);
+        
+        return createWithRegisteredTables(library, registeredTables, faceIndex, size);
+    }
+    
+    return createWithTables(ftFace, sfFontTables, size);
+}
+
+SFFontRef SFFontCreateWithFile(FT_Library library, const char *path, FT_Long faceIndex, SFFloat size) {
+    SFFontTablesRef sfFontTables;
+    SFRegistryKey key;
+    
+    const SFUByte *data;
+    size_t length;
+    SFBool ownsData;
+    
+    memset(&key, 0, sizeof(SFRegistryKey));
+    key.type = rkFile;
+    key.path = (char *)path;
+    key.faceIndex = faceIndex;
+    
+    //The file is opened only once while any font or the registry uses it.
+    sfFontTables = SFFontRegistryFindTables(&key);
+    if (sfFontTables)
+        return createWithRegisteredTables(library, sfFontTables, faceIndex, size);
+    
+    data = mapFontFile(path, &length, &ownsData);
+    if (!data)
+        return NULL;
+    
+    return createWithFontData(library, data, length, ownsData, faceIndex, size, &key);
+}
+
+SFFontRef SFFontCreateWithMemory(FT_Library library, const void *data, size_t length, FT_Long faceIndex, SFFloat size) {
+    SFFontTablesRef sfFontTables;
+    SFRegistryKey key;
+    
+    memset(&key, 0, sizeof(SFRegistryKey));
+    key.type = rkMemory;
+    key.data = data;
+    key.length = length;
+    key.faceIndex = faceIndex;
+    
+    sfFontTables = SFFontRegistryFindTables(&key);
+    if (sfFontTables)
+        return createWithRegisteredTables(library, sfFontTables, faceIndex, size);
+    
+    return createWithFontData(library, data, length, SFFalse, faceIndex, size, &key);
+}
+
 FT_Face SFFontGetFTFace(SFFontRef sfFont) {
 	return sfFont->_ftFace;
 }
 
 #endif
 
+static void parseTable(SFFontTablesRef sfFontTables, SFTableIndex index, const SFTableSlice *slice, SFArena *arena) {
+    switch (index) {
+        case tiCMAP:
+            SFReadCMAP(slice->data, &sfFontTables->_cmap, slice->length, arena);
+            break;
+            
+        case tiGDEF:
+            SFReadGDEF(slice->data, &sfFontTables->_gdef, arena);
+            break;
+            
+        case tiGSUB:
+            SFReadGSUB(slice->data, &sfFontTables->_gsub, arena);
+            break;
+            
+        case tiGPOS:
+            SFReadGPOS(slice->data, &sfFontTables->_gpos, arena);
+            break;
+            
+        default:
+            break;
+    }
+}
+
+#ifdef SF_PARALLEL_TABLES
+
+typedef struct SFTableTask {
+    SFFontTablesRef tables;
+    SFTableIndex index;
+    const SFTableSlice *slice;
+    SFArena arena;
+} SFTableTask;
+
+static void *parseTableTask(void *param) {
+    SFTableTask *task = param;
+    parseTable(task->tables, task->index, task->slice, &task->arena);
+    
+    return NULL;
+}
+
+#endif
+
+void SFFontParseTables(SFFontTablesRef sfFontTables, const SFTableSlice *slices, SFArena *arena) {
+    static const SFImplementedTable flags[tiCount] = { itCMAP, itGDEF, itGSUB, itGPOS };
+    int i;
+    
+#ifdef SF_PARALLEL_TABLES
+    //Every table is read into an arena of its own, which is merged in the order of the
+    //tables afterwards, so the memory is laid out the same way in every run.
+    SFTableTask tasks[tiCount];
+    pthread_t threads[tiCount];
+    SFBool started[tiCount];
+    
+    for (i = 0; i < tiCount; i++) {
+        started[i] = SFFalse;
+        
+        if (slices[i].data) {
+            tasks[i].tables = sfFontTables;
+            tasks[i].index = i;
+            tasks[i].slice = &slices[i];
+            SFArenaInitialize(&tasks[i].arena);
+            
+            started[i] = (pthread_create(&threads[i], NULL, &parseTableTask, &tasks[i]) == 0);
+        }
+    }
+    
+    for (i = 0; i < tiCount; i++) {
+        if (slices[i].data) {
+            if (started[i])
+                pthread_join(threads[i], NULL);
+            else
+                parseTableTask(&tasks[i]);
+            
+            sfFontTables->_tableSizes[i] = SFArenaGetUsedSize(&tasks[i].arena);
+            SFArenaMerge(arena, &tasks[i].arena);
+        }
+    }
+#else
+    for (i = 0; i < tiCount; i++) {
+        if (slices[i].data) {
+            size_t usedSize = SFArenaGetUsedSize(arena);
+            
+            parseTable(sfFontTables, i, &slices[i], arena);
+            sfFontTables->_tableSizes[i] = SFArenaGetUsedSize(arena) - usedSize;
+        }
+    }
+#endif
+    
+    for (i = 0; i < tiCount; i++) {
+        if (slices[i].data)
+            sfFontTables->_availableTables |= flags[i];
+    }
+}
+
 void SFFontReadTables(SFFontRef sfFont) {
-    if (!sfFont->_tables->_availableTables) {
-        readCMAPTable(sfFont);
-        readGDEFTable(sfFont);
-        readGSUBTable(sfFont);
-        readGPOSTable(sfFont);
+    SFFontTablesRef sfFontTables = sfFont->_tables;
+    
+    //Threads only take the lock until the tables of the font have been read.
+    if (SFAtomicLoadInt(&sfFontTables->_tablesRead))
+        return;
+    
+    pthread_mutex_lock(&sfFontTables->_readMutex);
+    
+    if (!sfFontTables->_tablesRead) {
+        if (!SFFontCacheReadTables(sfFontTables, sfFontTables->_slices))
+            SFFontParseTables(sfFontTables, sfFontTables->_slices, &sfFontTables->_arena);
+        
+#ifndef SF_TABLE_VIEWS
+        //Parsed tables do not refer to their bytes, so the copies are not needed anymore.
+        {
+            int i;
+            for (i = 0; i < tiCount; i++) {
+                if (sfFontTables->_tableData[i]) {
+                    releaseTableData(sfFontTables->_tableData[i]);
+                    
+                    sfFontTables->_tableData[i] = NULL;
+                    sfFontTables->_slices[i].data = NULL;
+                }
+            }
+        }
+#endif
+        
+        SFAtomicStoreInt(&sfFontTables->_tablesRead, 1);
     }
+    
+    pthread_mutex_unlock(&sfFontTables->_readMutex);
+}
+
+static const SFShapePlan *findShapePlan(SFShapePlan *plan, SFUInt scriptTag, SFUInt languageTag) {
+    for (; plan; plan = plan->next) {
+        if (plan->scriptTag == scriptTag && plan->languageTag == languageTag)
+            return plan;
+    }
+    
+    return NULL;
+}
+
+const SFShapePlan *SFFontGetShapePlan(SFFontRef sfFont, SFUInt scriptTag, SFUInt languageTag) {
+    SFFontTablesRef sfFontTables = sfFont->_tables;
+    const SFShapePlan *plan;
+    
+    //Plans are never removed, so a plan found without the lock stays valid.
+    plan = findShapePlan(SFAtomicLoadPointer(&sfFontTables->_shapePlans), scriptTag, languageTag);
+    if (plan)
+        return plan;
+    
+    pthread_mutex_lock(&sfFontTables->_readMutex);
+    
+    plan = findShapePlan(sfFontTables->_shapePlans, scriptTag, languageTag);
+    if (!plan) {
+        SFShapePlan *newPlan = SFMakeShapePlan((sfFontTables->_availableTables & itGSUB) ? &sfFontTables->_gsub : NULL,
+                                               (sfFontTables->_availableTables & itGPOS) ? &sfFontTables->_gpos : NULL,
+                                               scriptTag, languageTag, &sfFontTables->_arena);
+        
+        newPlan->next = sfFontTables->_shapePlans;
+        SFAtomicStorePointer(&sfFontTables->_shapePlans, newPlan);
+        
+        plan = newPlan;
+    }
+    
+    pthread_mutex_unlock(&sfFontTables->_readMutex);
+    
+    return plan;
 }
 
 SFFloat SFFontGetSize(SFFontRef sfFont) {
@@ -332,13 +757,15 @@ SFFontRef SFFontRetain(SFFontRef sfFont) {
 
 void SFFontRelease(SFFontRef sfFont) {
     if (sfFont) {
+        SFUInt retainCount;
+        
         pthread_mutex_lock(&sfFont->_retainMutex);
         
-        sfFont->_retainCount--;
+        retainCount = --sfFont->_retainCount;
         
         pthread_mutex_unlock(&sfFont->_retainMutex);
         
-        if (sfFont->_retainCount == 0) {
+        if (retainCount == 0) {
 #ifdef SF_IOS_CG
             if (sfFont->_cgFont) {
                 CGFontRelease(sfFont->_cgFont);
@@ -349,11 +776,11 @@ void SFFontRelease(SFFontRef sfFont) {
             }
 #endif
             
-            SFFontTablesRelease(sfFont->_tables);
+            SFFontRegistryReleaseTables(sfFont->_tables);
             
             pthread_mutex_destroy(&sfFont->_retainMutex);
             
-            free(sfFont);
+            SFFree(SFSubsystemFont, sfFont);
         }
     }
 }
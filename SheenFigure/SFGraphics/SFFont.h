@@ -17,6 +17,8 @@
 #ifndef _SF_FONT_H
 #define _SF_FONT_H
 
+#include <stddef.h>
+
 #include "SFConfig.h"
 #include "SFTypes.h"
 
@@ -41,11 +43,29 @@ CGFontRef SFFontGetCGFont(SFFontRef sfFont);
 #include <freetype/freetype.h>
 
 SFFontRef SFFontCreateWithFTFace(FT_Face ftFace, SFFloat size);
+SFFontRef SFFontCreateWithFile(FT_Library library, const char *path, FT_Long faceIndex, SFFloat size);
+SFFontRef SFFontCreateWithMemory(FT_Library library, const void *data, size_t length, FT_Long faceIndex, SFFloat size);
 SFFontRef SFFontMakeCloneForFTFace(SFFontRef sfFont, FT_Face ftFace, SFFloat size);
 FT_Face SFFontGetFTFace(SFFontRef sfFont);
 
 #endif
 
+void SFFontSetCacheDirectory(const char *path);
+void SFFontSetMemoryBudget(size_t budget);
+
+//Number of bytes taken by a font. The parsed tables are shared by all fonts created for
+//the same face, so they are counted in full for each of them.
+typedef struct SFFontMemoryUsage {
+    size_t cmap;                    //Parsed cmap table
+    size_t gdef;                    //Parsed GDEF table
+    size_t gsub;                    //Parsed GSUB table along with its loaded lookups
+    size_t gpos;                    //Parsed GPOS table along with its loaded lookups
+    size_t tableData;               //Copies of the raw table bytes
+    size_t total;                   //Everything above including bookkeeping
+} SFFontMemoryUsage;
+
+void SFFontGetMemoryUsage(SFFontRef sfFont, SFFontMemoryUsage *usage);
+
 SFFloat SFFontGetSize(SFFontRef sfFont);
 SFFloat SFFontGetSizeByEm(SFFontRef sfFont);
 
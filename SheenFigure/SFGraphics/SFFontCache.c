@@ -0,0 +1,593 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define SF_MMAP_SNAPSHOTS
+#endif
+
+#include "SFAllocator.h"
+#include "SFFontCache.h"
+#include "SFFont.h"
+
+#define SF_CACHE_MAGIC          0x53464354
+#define SF_CACHE_VERSION        5
+
+#define SF_HASH_OFFSET          0xCBF29CE484222325ULL
+#define SF_HASH_PRIME           0x100000001B3ULL
+
+//A snapshot consists of a header, an image of the parsed tables and the relocations
+//of the pointers in the image. Pointers either refer to the image itself or to the
+//table bytes, which are not part of the snapshot.
+typedef struct SFCacheHeader {
+    SFUInt magic;
+    SFUInt version;
+    SFUInt layout;                      //Signature of the structures the image was written with
+    SFUInt availableTables;
+    uint64_t key;                       //Hash of the table bytes
+    uint64_t checksum;                  //Hash of the image and the relocations
+    SFUInt tableLengths[tiCount];
+    SFUInt imageLength;
+    SFUInt relocationCount;
+} SFCacheHeader;
+
+typedef struct SFCacheRelocation {
+    SFUInt offset;                      //Offset of the pointer in the image
+    SFUInt region;                      //Index of the table the pointer refers to, or
+                                        //tiCount if it refers to the image
+    SFUInt target;                      //Offset of the pointed data in its region
+} SFCacheRelocation;
+
+//Top level tables, which are followed by the arena chunks in the image.
+typedef struct SFCacheRoots {
+    SFTableCMAP cmap;
+    SFTableGDEF gdef;
+    SFTableGSUB gsub;
+    SFTableGPOS gpos;
+    size_t tableSizes[tiCount];
+} SFCacheRoots;
+
+typedef struct SFCacheParse {
+    SFFontTables tables;
+    SFArena *arena;
+    SFTableSlice slices[tiCount];
+    
+    SFUByte *image;
+    SFUInt imageLength;
+    SFUInt *chunkOffsets;
+} SFCacheParse;
+
+//Guards the directory, which may be changed while other threads are reading tables, and the
+//count of temporary files.
+static pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static char *cacheDirectory = NULL;
+static SFUInt temporaryCount = 0;
+
+void SFFontSetCacheDirectory(const char *path) {
+    char *newDirectory = NULL;
+    char *oldDirectory;
+    
+    if (path) {
+        newDirectory = SFAllocate(SFSubsystemCache, strlen(path) + 1);
+        strcpy(newDirectory, path);
+    }
+    
+    pthread_mutex_lock(&cacheMutex);
+    oldDirectory = cacheDirectory;
+    cacheDirectory = newDirectory;
+    pthread_mutex_unlock(&cacheMutex);
+    
+    SFFree(SFSubsystemCache, oldDirectory);
+}
+
+//Returns a copy of the cache directory, or NULL if there is none.
+static char *copyCacheDirectory() {
+    char *directory = NULL;
+    
+    pthread_mutex_lock(&cacheMutex);
+    
+    if (cacheDirectory) {
+        directory = SFAllocate(SFSubsystemCache, strlen(cacheDirectory) + 1);
+        strcpy(directory, cacheDirectory);
+    }
+    
+    pthread_mutex_unlock(&cacheMutex);
+    
+    return directory;
+}
+
+static uint64_t hashBytes(uint64_t hash, const SFUByte *bytes, size_t length) {
+    uint64_t word;
+    
+    //Whole words are hashed at once so that large tables can be keyed cheaply on every open.
+    while (length >= sizeof(word)) {
+        memcpy(&word, bytes, sizeof(word));
+        
+        hash = (hash ^ word) * SF_HASH_PRIME;
+        hash ^= hash >> 32;
+        
+        bytes += sizeof(word);
+        length -= sizeof(word);
+    }
+    
+    while (length) {
+        hash = (hash ^ *bytes) * SF_HASH_PRIME;
+        
+        bytes++;
+        length--;
+    }
+    
+    return hash;
+}
+
+static SFUInt layoutSignature() {
+    const size_t sizes[] = {
+        sizeof(void *),
+        sizeof(SFCacheRoots),
+        sizeof(LookupTable),
+        sizeof(CoverageTable),
+        sizeof(ClassDefTable),
+#ifdef SF_TABLE_VIEWS
+        1,
+#else
+        0,
+#endif
+    };
+    
+    return (SFUInt)hashBytes(SF_HASH_OFFSET, (const SFUByte *)sizes, sizeof(sizes));
+}
+
+uint64_t SFFontCacheMakeKey(const SFTableSlice *slices) {
+    uint64_t key = SF_HASH_OFFSET;
+    int i;
+    
+    for (i = 0; i < tiCount; i++) {
+        key = hashBytes(key, (const SFUByte *)&slices[i].length, sizeof(SFUInt));
+        
+        if (slices[i].data)
+            key = hashBytes(key, slices[i].data, slices[i].length);
+    }
+    
+    return key;
+}
+
+static void *mapSnapshot(const char *path, size_t *length) {
+#ifdef SF_MMAP_SNAPSHOTS
+    struct stat fileStat;
+    void *data;
+    int fd;
+    
+    fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(SFCacheHeader)) {
+        close(fd);
+        return NULL;
+    }
+    
+    //The mapping is private, so relocations only touch the pages of this process.
+    data = mmap(NULL, fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    
+    if (data == MAP_FAILED)
+        return NULL;
+    
+    *length = fileStat.st_size;
+    
+    return data;
+#else
+    FILE *file;
+    SFUByte *data;
+    long size;
+    
+    file = fopen(path, "rb");
+    if (!file)
+        return NULL;
+    
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < (long)sizeof(SFCacheHeader) || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+    
+    data = SFAllocate(SFSubsystemCache, size);
+    if (fread(data, 1, size, file) != (size_t)size) {
+        SFFree(SFSubsystemCache, data);
+        fclose(file);
+        return NULL;
+    }
+    
+    fclose(file);
+    
+    *length = size;
+    
+    return data;
+#endif
+}
+
+void SFFontCacheReleaseSnapshot(void *snapshot, size_t length) {
+#ifdef SF_MMAP_SNAPSHOTS
+    munmap(snapshot, length);
+#else
+    SFFree(SFSubsystemCache, snapshot);
+#endif
+}
+
+static SFBool applySnapshot(SFFontTablesRef sfFontTables, const SFTableSlice *slices, uint64_t key, SFUByte *snapshot, size_t length) {
+    const SFCacheHeader *header = (const SFCacheHeader *)snapshot;
+    const SFCacheRelocation *relocations;
+    const SFCacheRoots *roots;
+    SFUByte *image;
+    
+    size_t bodyLength;
+    SFUInt i;
+    
+    if (header->magic != SF_CACHE_MAGIC || header->version != SF_CACHE_VERSION
+        || header->layout != layoutSignature() || header->key != key)
+        return SFFalse;
+    
+    for (i = 0; i < tiCount; i++) {
+        if (header->tableLengths[i] != slices[i].length)
+            return SFFalse;
+    }
+    
+    bodyLength = length - sizeof(SFCacheHeader);
+    if (header->imageLength < sizeof(SFCacheRoots) || header->imageLength > bodyLength
+        || header->relocationCount != (bodyLength - header->imageLength) / sizeof(SFCacheRelocation)
+        || (bodyLength - header->imageLength) % sizeof(SFCacheRelocation))
+        return SFFalse;
+    
+    //A snapshot that was cut short or overwritten in the middle is caught here and written again.
+    if (hashBytes(SF_HASH_OFFSET, snapshot + sizeof(SFCacheHeader), bodyLength) != header->checksum)
+        return SFFalse;
+    
+    image = snapshot + sizeof(SFCacheHeader);
+    relocations = (const SFCacheRelocation *)(image + header->imageLength);
+    
+    for (i = 0; i < header->relocationCount; i++) {
+        const SFCacheRelocation *relocation = &relocations[i];
+        const SFUByte *base;
+        SFUInt limit;
+        
+        if (relocation->region == tiCount) {
+            base = image;
+            limit = header->imageLength;
+        } else if (relocation->region < tiCount && slices[relocation->region].data) {
+            base = slices[relocation->region].data;
+            limit = slices[relocation->region].length;
+        } else {
+            return SFFalse;
+        }
+        
+        if (relocation->offset % sizeof(void *) || relocation->offset > header->imageLength - sizeof(void *)
+            || relocation->target > limit)
+            return SFFalse;
+        
+        *(const SFUByte **)&image[relocation->offset] = base + relocation->target;
+    }
+    
+    roots = (const SFCacheRoots *)image;
+    
+    sfFontTables->_cmap = roots->cmap;
+    sfFontTables->_gdef = roots->gdef;
+    sfFontTables->_gsub = roots->gsub;
+    sfFontTables->_gpos = roots->gpos;
+    memcpy(sfFontTables->_tableSizes, roots->tableSizes, sizeof(roots->tableSizes));
+    sfFontTables->_availableTables = header->availableTables;
+    
+    return SFTrue;
+}
+
+static SFBool loadSnapshot(SFFontTablesRef sfFontTables, const SFTableSlice *slices, uint64_t key, const char *path) {
+    SFUByte *snapshot;
+    size_t length;
+    
+    snapshot = mapSnapshot(path, &length);
+    if (!snapshot)
+        return SFFalse;
+    
+    if (!applySnapshot(sfFontTables, slices, key, snapshot, length)) {
+        SFFontCacheReleaseSnapshot(snapshot, length);
+        return SFFalse;
+    }
+    
+    sfFontTables->_snapshot = snapshot;
+    sfFontTables->_snapshotLength = length;
+    
+    return SFTrue;
+}
+
+static void parseForSnapshot(SFCacheParse *parse, const SFTableSlice *slices, SFArena *arena) {
+    SFArenaChunk *chunk;
+    SFCacheRoots roots;
+    
+    SFUInt chunkCount;
+    SFUInt offset;
+    SFUInt i;
+    
+    memset(&parse->tables, 0, sizeof(SFFontTables));
+    memcpy(parse->slices, slices, sizeof(parse->slices));
+    
+    parse->arena = arena;
+    SFFontParseTables(&parse->tables, slices, arena);
+    
+    offset = SF_ARENA_ALIGN(sizeof(SFCacheRoots));
+    chunkCount = 0;
+    
+    for (chunk = arena->firstChunk; chunk; chunk = chunk->next) {
+        offset += chunk->used;
+        chunkCount++;
+    }
+    
+    parse->imageLength = offset;
+    parse->image = SFAllocateZeroed(SFSubsystemCache, offset);
+    parse->chunkOffsets = SFAllocate(SFSubsystemCache, sizeof(SFUInt) * (chunkCount + 1));
+    
+    memset(&roots, 0, sizeof(SFCacheRoots));
+    roots.cmap = parse->tables._cmap;
+    roots.gdef = parse->tables._gdef;
+    roots.gsub = parse->tables._gsub;
+    roots.gpos = parse->tables._gpos;
+    memcpy(roots.tableSizes, parse->tables._tableSizes, sizeof(roots.tableSizes));
+    
+    memcpy(parse->image, &roots, sizeof(SFCacheRoots));
+    
+    offset = SF_ARENA_ALIGN(sizeof(SFCacheRoots));
+    
+    for (chunk = arena->firstChunk, i = 0; chunk; chunk = chunk->next, i++) {
+        memcpy(&parse->image[offset], SFArenaGetChunkBytes(chunk), chunk->used);
+        
+        parse->chunkOffsets[i] = offset;
+        offset += chunk->used;
+    }
+}
+
+static void freeParse(SFCacheParse *parse) {
+    SFFree(SFSubsystemCache, parse->image);
+    SFFree(SFSubsystemCache, parse->chunkOffsets);
+}
+
+static SFBool findTarget(const SFCacheParse *parse, uintptr_t address, SFUInt *region, SFUInt *target) {
+    SFArenaChunk *chunk;
+    SFUInt i;
+    
+    for (chunk = parse->arena->firstChunk, i = 0; chunk; chunk = chunk->next, i++) {
+        uintptr_t start = (uintptr_t)SFArenaGetChunkBytes(chunk);
+        
+        if (address >= start && address <= start + chunk->used) {
+            *region = tiCount;
+            *target = parse->chunkOffsets[i] + (SFUInt)(address - start);
+            return SFTrue;
+        }
+    }
+    
+    for (i = 0; i < tiCount; i++) {
+        uintptr_t start = (uintptr_t)parse->slices[i].data;
+        
+        if (start && address >= start && address <= start + parse->slices[i].length) {
+            *region = i;
+            *target = (SFUInt)(address - start);
+            return SFTrue;
+        }
+    }
+    
+    return SFFalse;
+}
+
+//Both parses produce the same data at different addresses, so every word that differs
+//between the two images is a pointer, which must refer to the same place in both. The
+//pointers are cleared in the first image, as they are set again while loading it.
+static SFBool findRelocations(SFCacheParse *first, const SFCacheParse *second, SFCacheRelocation **relocations, SFUInt *count) {
+    SFUInt capacity = 0;
+    SFUInt offset;
+    
+    *relocations = NULL;
+    *count = 0;
+    
+    if (first->imageLength != second->imageLength)
+        return SFFalse;
+    
+    for (offset = 0; offset + sizeof(uintptr_t) <= first->imageLength; offset += sizeof(uintptr_t)) {
+        uintptr_t firstWord;
+        uintptr_t secondWord;
+        
+        SFUInt firstRegion, firstTarget;
+        SFUInt secondRegion, secondTarget;
+        SFBool firstFound, secondFound;
+        
+        memcpy(&firstWord, &first->image[offset], sizeof(uintptr_t));
+        memcpy(&secondWord, &second->image[offset], sizeof(uintptr_t));
+        
+        if (firstWord == secondWord)
+            continue;
+        
+        firstFound = findTarget(first, firstWord, &firstRegion, &firstTarget);
+        secondFound = findTarget(second, secondWord, &secondRegion, &secondTarget);
+        
+        //Words that differ without being pointers are left over padding of copied structures.
+        if (!firstFound && !secondFound)
+            continue;
+        
+        if (!firstFound || !secondFound || firstRegion != secondRegion || firstTarget != secondTarget) {
+            SFFree(SFSubsystemCache, *relocations);
+            *relocations = NULL;
+            
+            return SFFalse;
+        }
+        
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            *relocations = SFReallocate(SFSubsystemCache, *relocations, sizeof(SFCacheRelocation) * capacity);
+        }
+        
+        (*relocations)[*count].offset = offset;
+        (*relocations)[*count].region = firstRegion;
+        (*relocations)[*count].target = firstTarget;
+        (*count)++;
+        
+        memset(&first->image[offset], 0, sizeof(uintptr_t));
+    }
+    
+    return SFTrue;
+}
+
+static void writeSnapshot(const char *path, const SFCacheHeader *header, const SFUByte *image, const SFCacheRelocation *relocations) {
+    char *temporaryPath;
+    SFUInt count;
+    FILE *file;
+    SFBool written;
+    
+    pthread_mutex_lock(&cacheMutex);
+    count = temporaryCount++;
+    pthread_mutex_unlock(&cacheMutex);
+    
+    //The snapshot is written next to its final path and renamed, so a reader never sees it half
+    //written. Every writer has a file of its own, even across processes sharing the directory.
+    temporaryPath = SFAllocate(SFSubsystemCache, strlen(path) + 40);
+    sprintf(temporaryPath, "%s.%lu.%u.tmp", path, (unsigned long)getpid(), count);
+    
+    file = fopen(temporaryPath, "wb");
+    if (!file) {
+        SFFree(SFSubsystemCache, temporaryPath);
+        return;
+    }
+    
+    written = (fwrite(header, sizeof(SFCacheHeader), 1, file) == 1
+               && fwrite(image, 1, header->imageLength, file) == header->imageLength
+               && fwrite(relocations, sizeof(SFCacheRelocation), header->relocationCount, file) == header->relocationCount);
+    written = (fclose(file) == 0 && written);
+    
+    if (written) {
+#ifdef _WIN32
+        remove(path);
+#endif
+        written = (rename(temporaryPath, path) == 0);
+    }
+    
+    if (!written)
+        remove(temporaryPath);
+    
+    SFFree(SFSubsystemCache, temporaryPath);
+}
+
+static void createSnapshot(SFFontTablesRef sfFontTables, const SFTableSlice *slices, uint64_t key, const char *path) {
+    SFCacheParse first;
+    SFCacheParse second;
+    SFArena secondArena;
+    SFTableSlice copies[tiCount];
+    
+    SFCacheRelocation *relocations;
+    SFUInt relocationCount;
+    int i;
+    
+    //The tables are parsed once more from copies of their bytes, so that pointers can be
+    //told apart from plain data without knowing the layout of every parsed structure.
+    parseForSnapshot(&first, slices, &sfFontTables->_arena);
+    
+    for (i = 0; i < tiCount; i++) {
+        copies[i].length = slices[i].length;
+        copies[i].data = NULL;
+        
+        if (slices[i].data) {
+            SFUByte *copy = SFAllocate(SFSubsystemCache, slices[i].length ? slices[i].length : 1);
+            memcpy(copy, slices[i].data, slices[i].length);
+            
+            copies[i].data = copy;
+        }
+    }
+    
+    SFArenaInitialize(&secondArena);
+    parseForSnapshot(&second, copies, &secondArena);
+    
+    if (findRelocations(&first, &second, &relocations, &relocationCount)) {
+        SFCacheHeader header;
+        
+        memset(&header, 0, sizeof(SFCacheHeader));
+        header.magic = SF_CACHE_MAGIC;
+        header.version = SF_CACHE_VERSION;
+        header.layout = layoutSignature();
+        header.availableTables = first.tables._availableTables;
+        header.key = key;
+        header.imageLength = first.imageLength;
+        header.relocationCount = relocationCount;
+        
+        for (i = 0; i < tiCount; i++)
+            header.tableLengths[i] = slices[i].length;
+        
+        //The image length is a multiple of the word size, so hashing both parts one after
+        //another gives the same result as hashing the whole body while loading.
+        header.checksum = hashBytes(SF_HASH_OFFSET, first.image, first.imageLength);
+        header.checksum = hashBytes(header.checksum, (const SFUByte *)relocations, sizeof(SFCacheRelocation) * relocationCount);
+        
+        writeSnapshot(path, &header, first.image, relocations);
+        SFFree(SFSubsystemCache, relocations);
+    }
+    
+    //The first parse refers to the same table bytes as the font and was made in its
+    //arena, so it is kept.
+    sfFontTables->_cmap = first.tables._cmap;
+    sfFontTables->_gdef = first.tables._gdef;
+    sfFontTables->_gsub = first.tables._gsub;
+    sfFontTables->_gpos = first.tables._gpos;
+    memcpy(sfFontTables->_tableSizes, first.tables._tableSizes, sizeof(first.tables._tableSizes));
+    sfFontTables->_availableTables = first.tables._availableTables;
+    
+    freeParse(&first);
+    
+    SFArenaFinalize(&secondArena);
+    freeParse(&second);
+    
+    for (i = 0; i < tiCount; i++)
+        SFFree(SFSubsystemCache, (void *)copies[i].data);
+}
+
+SFBool SFFontCacheReadTables(SFFontTablesRef sfFontTables, const SFTableSlice *slices) {
+    char *directory;
+    uint64_t key;
+    char *path;
+    
+    directory = copyCacheDirectory();
+    if (!directory)
+        return SFFalse;
+    
+    //Tables copied out of a face have already been hashed to register them.
+    if (sfFontTables->_key.type == rkContent)
+        key = sfFontTables->_key.hash;
+    else
+        key = SFFontCacheMakeKey(slices);
+    
+    path = SFAllocate(SFSubsystemCache, strlen(directory) + 24);
+    sprintf(path, "%s/%08X%08X.sfc", directory, (SFUInt)(key >> 32), (SFUInt)key);
+    SFFree(SFSubsystemCache, directory);
+    
+    if (!loadSnapshot(sfFontTables, slices, key, path))
+        createSnapshot(sfFontTables, slices, key, path);
+    
+    SFFree(SFSubsystemCache, path);
+    
+    return SFTrue;
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_FONT_CACHE_H
+#define _SF_FONT_CACHE_H
+
+#include "SFConfig.h"
+#include "SFTypes.h"
+#include "SFFontPrivate.h"
+
+//Loads the tables from their snapshot in the cache directory. If there is no valid
+//snapshot, the tables are parsed and a new snapshot is written for the next time.
+//Returns SFFalse without doing anything if no cache directory has been set.
+SFBool SFFontCacheReadTables(SFFontTablesRef sfFontTables, const SFTableSlice *slices);
+
+//Hashes the bytes of the tables, identifying them both in the cache and in the registry.
+uint64_t SFFontCacheMakeKey(const SFTableSlice *slices);
+void SFFontCacheReleaseSnapshot(void *snapshot, size_t length);
+
+#endif
@@ -38,6 +38,7 @@
 #include "SFGDEFData.h"
 #include "SFGSUBData.h"
 #include "SFGPOSData.h"
+#include "SFShapePlan.h"
 
 typedef enum {
     itCMAP = 1,
@@ -46,8 +47,48 @@ typedef enum {
     itGPOS = 8,
 } SFImplementedTable;
 
+typedef enum {
+    tiCMAP = 0,
+    tiGDEF = 1,
+    tiGSUB = 2,
+    tiGPOS = 3,
+    tiCount = 4
+} SFTableIndex;
+
+#ifdef SF_IOS_CG
+typedef CFDataRef SFTableData;
+#else
+typedef FT_Byte *SFTableData;
+#endif
+
+typedef struct SFTableSlice {
+    const SFUByte *data;
+    SFUInt length;
+} SFTableSlice;
+
+typedef enum {
+    rkContent,                      //Tables copied out of a face, identified by their bytes
+    rkFile,                         //Font file opened by the library
+    rkMemory,                       //Font data owned by the client
+} SFRegistryKeyType;
+
+typedef struct SFRegistryKey {
+    SFRegistryKeyType type;
+    uint64_t hash;                  //Hash of the table bytes for content keys
+    SFUInt lengths[tiCount];        //Lengths of the tables for content keys
+    char *path;                     //Path of the font file for file keys
+    const void *data;               //Address of the font data for memory keys
+    size_t length;                  //Length of the font data for memory keys
+    long faceIndex;                 //Face of the font data for file and memory keys
+} SFRegistryKey;
+
 
 typedef struct SFFontTables {
+    //Set once the tables are read. The tables are not modified afterwards except for
+    //lookups loaded on first use, so they can be shared by any number of threads.
+    volatile int _tablesRead;
+    pthread_mutex_t _readMutex;
+    
     SFImplementedTable _availableTables;
     
     SFTableCMAP _cmap;
@@ -55,6 +96,41 @@ typedef struct SFFontTables {
     SFTableGSUB _gsub;
     SFTableGPOS _gpos;
     
+    //Number of bytes taken by each parsed table when it was read, not counting lookups
+    //loaded on first use.
+    size_t _tableSizes[tiCount];
+    
+    //Memory of the parsed tables and of the lookups read while shaping, which is released
+    //at once with the tables. Tables loaded from a cache snapshot live in the snapshot.
+    SFArena _arena;
+    void *_snapshot;
+    size_t _snapshotLength;
+    
+    //Plans made for shaping with the tables, which live in the arena. A plan is added to the
+    //front of the list once it is complete, so the list can be walked without locking.
+    SFShapePlan *_shapePlans;
+    
+    //Raw bytes of the tables. They point into the font file when it is available, otherwise
+    //into copies of the tables that are owned by the font tables.
+    SFTableSlice _slices[tiCount];
+    SFTableData _tableData[tiCount];
+    
+#ifndef SF_IOS_CG
+    //Whole font file when the font was created with a file or memory. The file is
+    //unmapped along with the tables if it was opened by the library.
+    const SFUByte *_fileData;
+    size_t _fileLength;
+    SFBool _ownsFileData;
+#endif
+    
+    //Entry of the tables in the registry, which shares them between all fonts with the
+    //same key. Tables that are no longer used stay in the registry while they fit in its
+    //memory budget.
+    SFRegistryKey _key;
+    SFUInt _lastUse;
+    struct SFFontTables *_previousEntry;
+    struct SFFontTables *_nextEntry;
+    
     SFUInt _retainCount;
 } SFFontTables;
 
@@ -87,6 +163,14 @@ typedef struct SFFont *SFFontRef;
 
 #endif
 
+void SFFontTablesDestroy(SFFontTablesRef sfFontTables);
+size_t SFFontTablesGetMemoryUsage(SFFontTablesRef sfFontTables);
+
+void SFFontParseTables(SFFontTablesRef sfFontTables, const SFTableSlice *slices, SFArena *arena);
 void SFFontReadTables(SFFontRef sfFont);
 
+//Returns the plan of a script and language, making it the first time it is asked for. The
+//tables of the font must have been read.
+const SFShapePlan *SFFontGetShapePlan(SFFontRef sfFont, SFUInt scriptTag, SFUInt languageTag);
+
 #endif
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "SFAllocator.h"
+#include "SFFontRegistry.h"
+#include "SFFont.h"
+
+static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+static SFFontTablesRef firstEntry = NULL;
+static size_t memoryBudget = 0;
+static SFUInt useCounter = 0;
+
+static SFBool isEqualKey(const SFRegistryKey *key1, const SFRegistryKey *key2) {
+    if (key1->type != key2->type)
+        return SFFalse;
+    
+    switch (key1->type) {
+        case rkContent:
+            return (key1->hash == key2->hash && memcmp(key1->lengths, key2->lengths, sizeof(key1->lengths)) == 0);
+            
+        case rkFile:
+            return (key1->faceIndex == key2->faceIndex && strcmp(key1->path, key2->path) == 0);
+            
+        case rkMemory:
+            return (key1->faceIndex == key2->faceIndex && key1->data == key2->data && key1->length == key2->length);
+    }
+    
+    return SFFalse;
+}
+
+//Data of the client may be freed as soon as its last font is released, so such tables are
+//never kept without a font.
+static SFBool canKeepUnused(SFFontTablesRef sfFontTables) {
+    return (sfFontTables->_key.type != rkMemory);
+}
+
+static void linkEntry(SFFontTablesRef sfFontTables) {
+    sfFontTables->_previousEntry = NULL;
+    sfFontTables->_nextEntry = firstEntry;
+    
+    if (firstEntry)
+        firstEntry->_previousEntry = sfFontTables;
+    
+    firstEntry = sfFontTables;
+}
+
+static void unlinkEntry(SFFontTablesRef sfFontTables) {
+    if (sfFontTables->_previousEntry)
+        sfFontTables->_previousEntry->_nextEntry = sfFontTables->_nextEntry;
+    else
+        firstEntry = sfFontTables->_nextEntry;
+    
+    if (sfFontTables->_nextEntry)
+        sfFontTables->_nextEntry->_previousEntry = sfFontTables->_previousEntry;
+    
+    sfFontTables->_previousEntry = NULL;
+    sfFontTables->_nextEntry = NULL;
+}
+
+static SFFontTablesRef findEntry(const SFRegistryKey *key) {
+    SFFontTablesRef entry;
+    
+    for (entry = firstEntry; entry; entry = entry->_nextEntry) {
+        if (isEqualKey(&entry->_key, key))
+            return entry;
+    }
+    
+    return NULL;
+}
+
+//Unlinks unused tables, least recently used first, until all registered tables fit in the
+//budget. The unlinked tables are chained through their next entry so that they can be
+//destroyed after the registry is unlocked.
+static SFFontTablesRef trimEntries(void) {
+    SFFontTablesRef evicted = NULL;
+    SFFontTablesRef entry;
+    size_t usage = 0;
+    
+    for (entry = firstEntry; entry; entry = entry->_nextEntry)
+        usage += SFFontTablesGetMemoryUsage(entry);
+    
+    while (usage > memoryBudget) {
+        SFFontTablesRef oldest = NULL;
+        
+        for (entry = firstEntry; entry; entry = entry->_nextEntry) {
+            if (!entry->_retainCount && (!oldest || entry->_lastUse < oldest->_lastUse))
+                oldest = entry;
+        }
+        
+        if (!oldest)
+            break;
+        
+        usage -= SFFontTablesGetMemoryUsage(oldest);
+        
+        unlinkEntry(oldest);
+        oldest->_nextEntry = evicted;
+        evicted = oldest;
+    }
+    
+    return evicted;
+}
+
+static void destroyEntries(SFFontTablesRef entry) {
+    while (entry) {
+        SFFontTablesRef next = entry->_nextEntry;
+        SFFontTablesDestroy(entry);
+        
+        entry = next;
+    }
+}
+
+static void copyKey(SFRegistryKey *destination, const SFRegistryKey *source) {
+    *destination = *source;
+    
+    if (source->path) {
+        destination->path = SFAllocate(SFSubsystemFont, strlen(source->path) + 1);
+        strcpy(destination->path, source->path);
+    }
+}
+
+SFFontTablesRef SFFontRegistryFindTables(const SFRegistryKey *key) {
+    SFFontTablesRef entry;
+    
+    pthread_mutex_lock(&registryMutex);
+    
+    entry = findEntry(key);
+    if (entry)
+        entry->_retainCount++;
+    
+    pthread_mutex_unlock(&registryMutex);
+    
+    return entry;
+}
+
+SFFontTablesRef SFFontRegistryAddTables(SFFontTablesRef sfFontTables, const SFRegistryKey *key) {
+    SFFontTablesRef entry;
+    
+    pthread_mutex_lock(&registryMutex);
+    
+    entry = findEntry(key);
+    if (entry) {
+        entry->_retainCount++;
+    } else {
+        copyKey(&sfFontTables->_key, key);
+        linkEntry(sfFontTables);
+        
+        entry = sfFontTables;
+    }
+    
+    pthread_mutex_unlock(&registryMutex);
+    
+    return entry;
+}
+
+SFFontTablesRef SFFontRegistryRetainTables(SFFontTablesRef sfFontTables) {
+    if (sfFontTables) {
+        pthread_mutex_lock(&registryMutex);
+        
+        sfFontTables->_retainCount++;
+        
+        pthread_mutex_unlock(&registryMutex);
+    }
+    
+    return sfFontTables;
+}
+
+void SFFontRegistryReleaseTables(SFFontTablesRef sfFontTables) {
+    SFFontTablesRef evicted = NULL;
+    
+    if (!sfFontTables)
+        return;
+    
+    pthread_mutex_lock(&registryMutex);
+    
+    sfFontTables->_retainCount--;
+    
+    if (sfFontTables->_retainCount == 0) {
+        if (canKeepUnused(sfFontTables)) {
+            sfFontTables->_lastUse = ++useCounter;
+            evicted = trimEntries();
+        } else {
+            unlinkEntry(sfFontTables);
+            evicted = sfFontTables;
+        }
+    }
+    
+    pthread_mutex_unlock(&registryMutex);
+    
+    destroyEntries(evicted);
+}
+
+void SFFontSetMemoryBudget(size_t budget) {
+    SFFontTablesRef evicted;
+    
+    pthread_mutex_lock(&registryMutex);
+    
+    memoryBudget = budget;
+    evicted = trimEntries();
+    
+    pthread_mutex_unlock(&registryMutex);
+    
+    destroyEntries(evicted);
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_FONT_REGISTRY_H
+#define _SF_FONT_REGISTRY_H
+
+#include "SFConfig.h"
+#include "SFTypes.h"
+#include "SFFontPrivate.h"
+
+//Returns the registered tables with the given key after retaining them, or NULL if there
+//are none.
+SFFontTablesRef SFFontRegistryFindTables(const SFRegistryKey *key);
+
+//Registers the new tables, which must be retained only by the caller. If tables with the
+//same key were registered in the meantime, they are retained and returned instead, and
+//the caller has to destroy its own.
+SFFontTablesRef SFFontRegistryAddTables(SFFontTablesRef sfFontTables, const SFRegistryKey *key);
+
+SFFontTablesRef SFFontRegistryRetainTables(SFFontTablesRef sfFontTables);
+void SFFontRegistryReleaseTables(SFFontTablesRef sfFontTables);
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "SFAllocator.h"
+#include "SFShaperPrivate.h"
+#include "SFShaper.h"
+
+static pthread_key_t currentShaperKey;
+static pthread_once_t currentShaperOnce = PTHREAD_ONCE_INIT;
+
+static void releaseCurrentShaper(void *sfShaper) {
+    SFShaperRelease(sfShaper);
+}
+
+static void createCurrentShaperKey(void) {
+    pthread_key_create(&currentShaperKey, releaseCurrentShaper);
+}
+
+SFShaperRef SFShaperCreate(void) {
+    SFShaperRef sfShaper = SFAllocate(SFSubsystemShaper, sizeof(SFShaper));
+    
+    SFScratchInitialize(&sfShaper->_scratch);
+    
+    pthread_mutex_init(&sfShaper->_retainMutex, NULL);
+    sfShaper->_retainCount = 1;
+    
+    return sfShaper;
+}
+
+void SFShaperSetCurrent(SFShaperRef sfShaper) {
+    SFShaperRef previous;
+    
+    pthread_once(&currentShaperOnce, createCurrentShaperKey);
+    
+    previous = pthread_getspecific(currentShaperKey);
+    pthread_setspecific(currentShaperKey, SFShaperRetain(sfShaper));
+    
+    SFShaperRelease(previous);
+}
+
+SFShaperRef SFShaperGetCurrent(void) {
+    SFShaperRef sfShaper;
+    
+    pthread_once(&currentShaperOnce, createCurrentShaperKey);
+    
+    sfShaper = pthread_getspecific(currentShaperKey);
+    if (!sfShaper) {
+        sfShaper = SFShaperCreate();
+        pthread_setspecific(currentShaperKey, sfShaper);
+    }
+    
+    return sfShaper;
+}
+
+size_t SFShaperGetMemoryUsage(SFShaperRef sfShaper) {
+    return sizeof(SFShaper) + SFScratchGetSize(&sfShaper->_scratch);
+}
+
+SFShaperRef SFShaperRetain(SFShaperRef sfShaper) {
+    if (sfShaper) {
+        pthread_mutex_lock(&sfShaper->_retainMutex);
+        
+        sfShaper->_retainCount++;
+        
+        pthread_mutex_unlock(&sfShaper->_retainMutex);
+    }
+    
+    return sfShaper;
+}
+
+void SFShaperRelease(SFShaperRef sfShaper) {
+    if (sfShaper) {
+        pthread_mutex_lock(&sfShaper->_retainMutex);
+        
+        sfShaper->_retainCount--;
+        
+        pthread_mutex_unlock(&sfShaper->_retainMutex);
+        
+        if (sfShaper->_retainCount == 0) {
+            SFScratchFinalize(&sfShaper->_scratch);
+            pthread_mutex_destroy(&sfShaper->_retainMutex);
+            SFFree(SFSubsystemShaper, sfShaper);
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_SHAPER_H
+#define _SF_SHAPER_H
+
+#include <stddef.h>
+
+#include "SFConfig.h"
+#include "SFTypes.h"
+
+#ifndef _SF_SHAPER_REF
+#define _SF_SHAPER_REF
+
+typedef void *SFShaperRef;
+
+#endif
+
+//A shaper owns the temporary memory needed for shaping and drawing texts, and keeps it for
+//the next calls, so that nothing is allocated once it has grown to fit the texts. A shaper
+//must be used by one thread at a time.
+SFShaperRef SFShaperCreate(void);
+SFShaperRef SFShaperRetain(SFShaperRef sfShaper);
+void SFShaperRelease(SFShaperRef sfShaper);
+
+//Makes the shaper used by the texts on the calling thread. Passing NULL lets the thread get
+//a new shaper of its own on next use.
+void SFShaperSetCurrent(SFShaperRef sfShaper);
+
+//Returns the shaper of the calling thread, creating it on first use. It is released when the
+//thread exits.
+SFShaperRef SFShaperGetCurrent(void);
+
+//Number of bytes of temporary memory kept by a shaper.
+size_t SFShaperGetMemoryUsage(SFShaperRef sfShaper);
+
+#endif
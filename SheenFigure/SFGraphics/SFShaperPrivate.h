@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_SHAPER_PRIVATE_H
+#define _SF_SHAPER_PRIVATE_H
+
+#include <pthread.h>
+
+#include "SFConfig.h"
+#include "SFTypes.h"
+#include "SFScratch.h"
+
+typedef struct SFShaper {
+    SFScratch _scratch;
+    
+    pthread_mutex_t _retainMutex;
+    SFUInt _retainCount;
+} SFShaper;
+
+#ifndef _SF_SHAPER_REF
+#define _SF_SHAPER_REF
+
+typedef struct SFShaper *SFShaperRef;
+
+#endif
+
+#endif
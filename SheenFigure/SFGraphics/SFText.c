@@ -19,6 +19,7 @@
 #include <math.h>
 
 #include "bidi.h"
+#include "SFAllocator.h"
 #include "SFCMAPUtilization.h"
 #include "SFGDEFUtilization.h"
 #include "SFGSUBUtilization.h"
@@ -28,6 +29,9 @@
 #include "SFFontPrivate.h"
 #include "SFFont.h"
 
+#include "SFShaperPrivate.h"
+#include "SFShaper.h"
+
 #include "SFTextPrivate.h"
 #include "SFText.h"
 
@@ -40,22 +44,20 @@ typedef struct SFMeasuredLine {
 typedef struct VaryingYGlyph {
     SFGlyph glyph;
     SFPoint position;
-    
-    struct VaryingYGlyph *next;
 } VaryingYGlyph;
 
 
-static int getAdvance(SFFontRef sfFont, SFStringRecord *record, int recordIndex, int glyphIndex) {
+static int getAdvance(SFFontRef sfFont, SFStringRecord *record, int glyphIndex) {
 #ifdef SF_IOS_CG
     int adv;
 #else
     FT_Fixed adv;
 #endif
     
-    SFGlyph glyph = record->charRecord[recordIndex].gRec[glyphIndex].glyph;
+    SFGlyph glyph = record->glyphs[glyphIndex];
     
-    if (record->charRecord[recordIndex].gRec[glyphIndex].glyphProp & gpAdvance) {
-        return record->charRecord[recordIndex].gRec[glyphIndex].advance;
+    if (record->glyphProps[glyphIndex] & gpAdvance) {
+        return record->fontAdvances[glyphIndex];
     }
     
 #ifdef SF_IOS_CG
@@ -64,8 +66,8 @@ static int getAdvance(SFFontRef sfFont, SFStringRecord *record, int recordIndex,
     FT_Get_Advance(SFFontGetFTFace(sfFont), glyph, FT_LOAD_NO_SCALE, &adv);
 #endif
     
-    record->charRecord[recordIndex].gRec[glyphIndex].advance = adv;
-    record->charRecord[recordIndex].gRec[glyphIndex].glyphProp |= gpAdvance;
+    record->fontAdvances[glyphIndex] = adv;
+    record->glyphProps[glyphIndex] |= gpAdvance;
     
     return adv;
 }
@@ -80,6 +82,9 @@ static SFStringRecord *applyFontTables(SFFontRef sfFont, SFStringRecord *record)
     internal.gdef = &sfFont->_tables->_gdef;
     internal.gsub = &sfFont->_tables->_gsub;
     internal.gpos = &sfFont->_tables->_gpos;
+    internal.arena = &sfFont->_tables->_arena;
+    internal.plan = SFFontGetShapePlan(sfFont, SF_TAG_ARAB, SF_TAG_DEFAULT_LANGUAGE);
+    internal.scratch = &((SFShaper *)SFShaperGetCurrent())->_scratch;
     
     if (sfFont->_tables->_availableTables & itCMAP) {
         SFApplyCMAP(&internal);
@@ -109,7 +114,6 @@ static SFMeasuredLine getLine(SFFontRef sfFont, SFStringRecord *record, SFFloat
     SFFloat prevWidth = 0;
     
     SFGlyph glyph;
-    SFPositionRecord crntPosRecord;
     SFMeasuredLine line;
 
     SFUnichar ch;
@@ -127,7 +131,7 @@ static SFMeasuredLine getLine(SFFontRef sfFont, SFStringRecord *record, SFFloat
     line.endIndex = startIndex;
     
     for (i = startIndex; i < record->charCount; i++) {
-        int j, count;
+        int j, end;
 
         ch = record->chars[i];
         if (ch == ' ' || ch == '\n') {
@@ -139,26 +143,25 @@ static SFMeasuredLine getLine(SFFontRef sfFont, SFStringRecord *record, SFFloat
             }
         }
         
-        count = record->charRecord[i].glyphCount;
+        end = record->charGlyphs[i + 1];
         
         prevWidth = width;
         
-        for (j = 0; j < count; j++) {
+        for (j = record->charGlyphs[i]; j < end; j++) {
             SFAnchorType aType;
             
-            glyph = record->charRecord[i].gRec[j].glyph;
+            glyph = record->glyphs[j];
             if (!glyph) {
                 continue;
             }
             
-            crntPosRecord = record->charRecord[i].gRec[j].posRec;
-            aType = crntPosRecord.anchorType;
+            aType = record->anchorTypes[j];
             if (glyph && !(aType & atMark)) {
                 if (aType & atEntry)
-                    width -= crntPosRecord.anchor.x * SFFontGetSizeByEm(sfFont);
+                    width -= record->xAnchors[j] * SFFontGetSizeByEm(sfFont);
                 else {
-                    int adv = getAdvance(sfFont, record, i, j);
-                    width += (crntPosRecord.advance.x + adv - crntPosRecord.placement.x) * SFFontGetSizeByEm(sfFont);
+                    int adv = getAdvance(sfFont, record, j);
+                    width += (record->xAdvances[j] + adv - record->xPlacements[j]) * SFFontGetSizeByEm(sfFont);
                 }
             }
             
@@ -183,45 +186,40 @@ static SFMeasuredLine getLine(SFFontRef sfFont, SFStringRecord *record, SFFloat
     return line;
 }
 
-static void saveVaryingYGlyph(VaryingYGlyph **head, SFGlyph glyph, SFPoint position) {
-    VaryingYGlyph *current = malloc(sizeof(VaryingYGlyph));
-    current->glyph = glyph;
-    current->position = position;
-    current->next = *head;
-    *head = current;
+static void saveVaryingYGlyph(VaryingYGlyph *glyphs, int *count, SFGlyph glyph, SFPoint position) {
+    glyphs[*count].glyph = glyph;
+    glyphs[*count].position = position;
+    (*count)++;
 }
 
-static void drawVaryingYGlyphs(VaryingYGlyph **head, SFFloat varyingY, void *resObj, SFGlyphRenderFunction func) {
-    VaryingYGlyph *current = *head;
-    while (current) {
-        VaryingYGlyph *previous;
-        
+//Draws the saved glyphs, the last saved one first.
+static void drawVaryingYGlyphs(VaryingYGlyph *glyphs, int *count, SFFloat varyingY, void *resObj, SFGlyphRenderFunction func) {
+    while (*count > 0) {
+        VaryingYGlyph *current = &glyphs[--(*count)];
         (*func)(current->glyph, current->position.x, current->position.y - varyingY, resObj);
-        
-        previous = current;
-        current = current->next;
-        
-        free(previous);
     }
-    
-    *head = NULL;
 }
 
-static void drawLine(SFFontRef sfFont, SFStringRecord *record, int baselevel, SFMeasuredLine line, SFPoint *position, void *resObj, SFGlyphRenderFunction func) {
+static void drawLine(SFFontRef sfFont, SFStringRecord *record, SFScratch *scratch, int baselevel, SFMeasuredLine line, SFPoint *position, void *resObj, SFGlyphRenderFunction func) {
     if (line.endIndex - line.startIndex >= 0) {
+        SFScratchMark mark = SFScratchGetMark(scratch);
+        
         int length = line.endIndex - line.startIndex + 1;
-        int *levels = malloc(length * sizeof(int));
-        int *visOrder = malloc(length * sizeof(int));
+        int glyphCount = record->charGlyphs[line.endIndex + 1] - record->charGlyphs[line.startIndex];
+        SFUByte *levels = SFScratchPush(scratch, length * sizeof(SFUByte));
+        int *visOrder = SFScratchPush(scratch, length * sizeof(int));
         
         SFGlyph crntGlyph;
         
         SFBool hasExitAnchor = SFFalse;
-        VaryingYGlyph *varyingYGlyphs = NULL;
+        VaryingYGlyph *varyingYGlyphs = SFScratchPush(scratch, glyphCount * sizeof(VaryingYGlyph));
+        int varyingYCount = 0;
 
         int i, j, k;
 
-        SFMirroredChar *mchars;
-        SFMirroredChar *crntmchar;
+        SFMirroredChar *mchars = SFScratchPush(scratch, length * sizeof(SFMirroredChar));
+        int mcharCount;
+        int mcharIndex = 0;
         
         SFFloat sizeByEm = SFFontGetSizeByEm(sfFont);
         SFFloat leading = position->y;
@@ -232,80 +230,77 @@ static void drawLine(SFFontRef sfFont, SFStringRecord *record, int baselevel, SF
         }
         
         generateBidiVisualOrder(baselevel, record->types + line.startIndex, levels, visOrder, length);
-        mchars = generateMirroredChars(record->chars + line.startIndex, levels, length);
-        crntmchar = mchars->next;
-        
-        free(levels);
+        mcharCount = generateMirroredChars(record->chars + line.startIndex, levels, length, mchars);
 
         for (i = line.startIndex, j = 0; i <= line.endIndex; i++, j++) {
             int vi = visOrder[j];
-            int count = record->charRecord[vi].glyphCount;
+            int end = record->charGlyphs[vi + 1];
             
-            for (k = 0; k < count; k++) {
-                SFPositionRecord pos;
+            for (k = record->charGlyphs[vi]; k < end; k++) {
                 SFAnchorType aType;
                 
                 SFBool isMark;
                 SFBool isCursive;
                 
-                if (crntmchar && crntmchar->index == (vi - line.startIndex)) {
-                    SFMirroredChar *nextmchar = crntmchar->next;
-                    crntGlyph = SFCharToGlyph(&sfFont->_tables->_cmap, crntmchar->ch);
-                    free(crntmchar);
-                    crntmchar = nextmchar;
+                if (mcharIndex < mcharCount && mchars[mcharIndex].index == (vi - line.startIndex)) {
+                    if (sfFont->_tables->_availableTables & itCMAP)
+                        crntGlyph = SFGetCharGlyph(&sfFont->_tables->_cmap, mchars[mcharIndex].ch, &sfFont->_tables->_arena);
+                    else
+                        crntGlyph = 0;
+                    
+                    mcharIndex++;
                 } else {
-                    crntGlyph = record->charRecord[vi].gRec[k].glyph;
+                    crntGlyph = record->glyphs[k];
                 }
                 
                 if (!crntGlyph) {
                     continue;
                 }
                 
-                pos = record->charRecord[vi].gRec[k].posRec;
-                aType = pos.anchorType;
+                aType = record->anchorTypes[k];
                 
                 isMark = (aType & atMark);
                 isCursive = (aType & atEntry);
                 
                 if (isMark || (aType & atCursiveIgnored)) {
-                    SFFloat markX = position->x - ((pos.anchor.x - pos.placement.x) * sizeByEm);
-                    SFFloat markY = position->y + ((pos.anchor.y - pos.placement.y) * sizeByEm);
+                    SFFloat markX = position->x - ((record->xAnchors[k] - record->xPlacements[k]) * sizeByEm);
+                    SFFloat markY = position->y + ((record->yAnchors[k] - record->yPlacements[k]) * sizeByEm);
                     
                     if (hasExitAnchor) {
                         SFPoint p;
                         p.x = markX;
                         p.y = markY;
                         
-                        saveVaryingYGlyph(&varyingYGlyphs, crntGlyph, p);
+                        saveVaryingYGlyph(varyingYGlyphs, &varyingYCount, crntGlyph, p);
                     } else {
                         (*func)(crntGlyph, markX, markY, resObj);
                     }
                 } else {
                     if (isCursive) {
-                        position->x += pos.anchor.x * sizeByEm;
-                        position->y -= pos.anchor.y * sizeByEm;
+                        position->x += record->xAnchors[k] * sizeByEm;
+                        position->y -= record->yAnchors[k] * sizeByEm;
                         
                         hasExitAnchor = (aType & atExit);
                         if (hasExitAnchor) {
-                            saveVaryingYGlyph(&varyingYGlyphs, crntGlyph, *position);
+                            saveVaryingYGlyph(varyingYGlyphs, &varyingYCount, crntGlyph, *position);
                         } else {
-                            drawVaryingYGlyphs(&varyingYGlyphs, position->y - leading, resObj, func);
+                            drawVaryingYGlyphs(varyingYGlyphs, &varyingYCount, position->y - leading, resObj, func);
                             position->y = leading;
                             
                             (*func)(crntGlyph, position->x, position->y, resObj);
                         }
                     } else {
-                        int adv = getAdvance(sfFont, record, vi, k);
+                        int adv = getAdvance(sfFont, record, k);
                         
-                        position->x -= (pos.advance.x + adv - pos.placement.x) * sizeByEm;
-                        position->y -= pos.placement.y * sizeByEm;
+                        position->x -= (record->xAdvances[k] + adv - record->xPlacements[k]) * sizeByEm;
+                        position->y -= record->yPlacements[k] * sizeByEm;
                         
                         if (aType & atExit) {
-                            saveVaryingYGlyph(&varyingYGlyphs, crntGlyph, *position);
+                            saveVaryingYGlyph(varyingYGlyphs, &varyingYCount, crntGlyph, *position);
                             hasExitAnchor = SFTrue;
                         } else {
                             if (hasExitAnchor) {
-                                drawVaryingYGlyphs(&varyingYGlyphs, position->y - leading, resObj, func);
+                                drawVaryingYGlyphs(varyingYGlyphs, &varyingYCount, position->y - leading, resObj, func);
                                 position->y = leading;
                             }
                             
@@ -317,12 +312,11 @@ static void drawLine(SFFontRef sfFont, SFStringRecord *record, int baselevel, SF
             }
         }
         
-        free(mchars);
-        free(visOrder);
+        SFScratchRewind(scratch, mark);
     }
 }
 
-static int drawText(SFFontRef sfFont, SFStringRecord *record, int baselevel, SFTextAlignment align, SFFloat frameWidth, SFPoint *position, int *lines, int startIndex, void *resObj, SFGlyphRenderFunction func) {
+static int drawText(SFFontRef sfFont, SFStringRecord *record, SFScratch *scratch, int baselevel, SFTextAlignment align, SFFloat frameWidth, SFPoint *position, int *lines, int startIndex, void *resObj, SFGlyphRenderFunction func) {
     SFFloat initialX = position->x;
     
     SFMeasuredLine line;
@@ -341,7 +335,7 @@ static int drawText(SFFontRef sfFont, SFStringRecord *record, int baselevel, SFT
             position->x += line.width;
         }
         
-        drawLine(sfFont, record, baselevel, line, position, resObj, func);
+        drawLine(sfFont, record, scratch, baselevel, line, position, resObj, func);
         
         position->x = initialX;
         position->y += SFFontGetLeading(sfFont);
@@ -400,7 +394,7 @@ static int measureLines(SFFontRef sfFont, SFStringRecord *record, SFFloat frameW
 }
 
 SFTextRef SFTextCreateWithString(SFUnichar *str, int length, SFFontRef sfFont) {
-    SFTextRef sfText = malloc(sizeof(SFText));
+    SFTextRef sfText = SFAllocate(SFSubsystemText, sizeof(SFText));
 
     sfText->_sfFont = SFFontRetain(sfFont);
     sfText->_writingDirection = SFWritingDirectionRTL;
@@ -492,6 +486,34 @@ void SFTextSetWritingDirection(SFTextRef sfText, SFWritingDirection writingDirec
     }
 }
 
+void SFTextGetMemoryUsage(SFTextRef sfText, SFTextMemoryUsage *usage) {
+    SFStringRecord *record = SFRetainStringRecord(sfText->_record);
+    
+    usage->chars = 0;
+    usage->types = 0;
+    usage->levels = 0;
+    usage->charGlyphs = 0;
+    usage->glyphRecords = 0;
+    
+    if (record) {
+        //Characters that have been handed over to a newer record are counted there.
+        if (!record->retainChars)
+            usage->chars = sizeof(SFUnichar) * record->charCount;
+        
+        usage->types = sizeof(SFUByte) * record->charCount;
+        usage->levels = sizeof(SFUByte) * record->charCount;
+        usage->charGlyphs = sizeof(int) * (record->charCount + 1);
+        usage->glyphRecords = SF_GLYPH_STORAGE_SIZE * record->glyphCapacity;
+    }
+    
+    usage->total = sizeof(SFText) + usage->chars + usage->types + usage->levels + usage->charGlyphs + usage->glyphRecords;
+    
+    if (record)
+        usage->total += sizeof(SFStringRecord);
+    
+    SFReleaseStringRecord(record);
+}
+
 int SFTextGetNextLineCharIndex(SFTextRef sfText, SFFloat frameWidth, int startIndex, int *countLines) {
     int retIndex = -1;
     SFFontRef font = SFFontRetain(sfText->_sfFont);
@@ -551,7 +573,7 @@ int SFTextShowString(SFTextRef sfText, SFFloat frameWidth, SFPoint position, int
         }
         
         position.y += sfText->_sfFont->_ascender;
-        retIndex = drawText(font, record, getBaseLevel(sfText), sfText->_txtAlign, frameWidth, &position, lines, startIndex, resObj, func);
+        retIndex = drawText(font, record, &((SFShaper *)SFShaperGetCurrent())->_scratch, getBaseLevel(sfText), sfText->_txtAlign, frameWidth, &position, lines, startIndex, resObj, func);
     } else {
         if (lines) {
             *lines = 0;
@@ -588,7 +610,7 @@ void SFTextRelease(SFTextRef sfText) {
             SFReleaseStringRecord(sfText->_record);
             SFFontRelease(sfText->_sfFont);
             pthread_mutex_destroy(&sfText->_retainMutex);
-            free(sfText);
+            SFFree(SFSubsystemText, sfText);
         }
     }
 }
@@ -17,6 +17,8 @@
 #ifndef _SF_TEXT_H
 #define _SF_TEXT_H
 
+#include <stddef.h>
+
 #include "SFConfig.h"
 #include "SFTypes.h"
 
@@ -50,6 +52,18 @@ void SFTextSetFont(SFTextRef sfText, SFFontRef sfFont);
 void SFTextSetAlignment(SFTextRef sfText, SFTextAlignment alignment);
 void SFTextSetWritingDirection(SFTextRef sfText, SFWritingDirection writingDirection);
 
+//Number of bytes taken by a text, not counting its font.
+typedef struct SFTextMemoryUsage {
+    size_t chars;                   //Characters owned by the text
+    size_t types;                   //Bidi types of the characters
+    size_t levels;                  //Bidi levels of the characters
+    size_t charGlyphs;              //First glyph of every character
+    size_t glyphRecords;            //Glyphs produced for the characters
+    size_t total;                   //Everything above including bookkeeping
+} SFTextMemoryUsage;
+
+void SFTextGetMemoryUsage(SFTextRef sfText, SFTextMemoryUsage *usage);
+
 int SFTextGetNextLineCharIndex(SFTextRef sfText, SFFloat frameWidth, int startIndex, int *countLines);
 int SFTextMeasureLines(SFTextRef sfText, SFFloat frameWidth);
 SFFloat SFTextMeasureHeight(SFTextRef sfText, SFFloat frameWidth);
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "SFAllocator.h"
+
+//Every allocation starts with a header recording its size, so that freeing it can update
+//the counters. The header keeps the memory after it aligned for any type.
+#ifdef SF_ALLOCATION_STATS
+#define SF_ALLOCATION_HEADER_SIZE   16
+#else
+#define SF_ALLOCATION_HEADER_SIZE   0
+#endif
+
+static void *defaultAllocate(size_t size, void *userData) {
+    return malloc(size);
+}
+
+static void *defaultReallocate(void *ptr, size_t size, void *userData) {
+    return realloc(ptr, size);
+}
+
+static void defaultFree(void *ptr, void *userData) {
+    free(ptr);
+}
+
+static SFAllocateFunction allocateFunction = defaultAllocate;
+static SFReallocateFunction reallocateFunction = defaultReallocate;
+static SFFreeFunction freeFunction = defaultFree;
+static void *allocatorUserData = NULL;
+
+#ifdef SF_ALLOCATION_STATS
+static SFAllocationStats allocationStats[SFSubsystemCount];
+static pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+void SFSetAllocator(SFAllocateFunction allocate, SFReallocateFunction reallocate, SFFreeFunction deallocate, void *userData) {
+    if (allocate && reallocate && deallocate) {
+        allocateFunction = allocate;
+        reallocateFunction = reallocate;
+        freeFunction = deallocate;
+        allocatorUserData = userData;
+    } else {
+        allocateFunction = defaultAllocate;
+        reallocateFunction = defaultReallocate;
+        freeFunction = defaultFree;
+        allocatorUserData = NULL;
+    }
+}
+
+#ifdef SF_ALLOCATION_STATS
+
+static void updateStats(SFSubsystem subsystem, size_t oldSize, size_t newSize, SFBool allocated) {
+    SFAllocationStats *stats = &allocationStats[subsystem];
+    
+    pthread_mutex_lock(&statsMutex);
+    
+    if (allocated)
+        stats->allocations++;
+    
+    stats->bytes += newSize;
+    stats->bytes -= oldSize;
+    
+    if (stats->bytes > stats->peakBytes)
+        stats->peakBytes = stats->bytes;
+    
+    pthread_mutex_unlock(&statsMutex);
+}
+
+#endif
+
+void SFGetAllocationStats(SFSubsystem subsystem, SFAllocationStats *stats) {
+#ifdef SF_ALLOCATION_STATS
+    pthread_mutex_lock(&statsMutex);
+    *stats = allocationStats[subsystem];
+    pthread_mutex_unlock(&statsMutex);
+#else
+    memset(stats, 0, sizeof(SFAllocationStats));
+#endif
+}
+
+void SFResetAllocationStats(void) {
+#ifdef SF_ALLOCATION_STATS
+    int i;
+    
+    pthread_mutex_lock(&statsMutex);
+    
+    for (i = 0; i < SFSubsystemCount; i++) {
+        allocationStats[i].allocations = 0;
+        allocationStats[i].peakBytes = allocationStats[i].bytes;
+    }
+    
+    pthread_mutex_unlock(&statsMutex);
+#endif
+}
+
+void *SFAllocate(SFSubsystem subsystem, size_t size) {
+    SFUByte *memory = (*allocateFunction)(SF_ALLOCATION_HEADER_SIZE + size, allocatorUserData);
+    
+    if (!memory)
+        return NULL;
+    
+#ifdef SF_ALLOCATION_STATS
+    *(size_t *)memory = size;
+    updateStats(subsystem, 0, size, SFTrue);
+#endif
+    
+    return memory + SF_ALLOCATION_HEADER_SIZE;
+}
+
+void *SFAllocateZeroed(SFSubsystem subsystem, size_t size) {
+    void *memory = SFAllocate(subsystem, size);
+    
+    if (memory)
+        memset(memory, 0, size);
+    
+    return memory;
+}
+
+void *SFReallocate(SFSubsystem subsystem, void *ptr, size_t size) {
+    SFUByte *memory;
+    
+    if (!ptr)
+        return SFAllocate(subsystem, size);
+    
+    memory = (SFUByte *)ptr - SF_ALLOCATION_HEADER_SIZE;
+    
+#ifdef SF_ALLOCATION_STATS
+    {
+        size_t oldSize = *(size_t *)memory;
+        
+        memory = (*reallocateFunction)(memory, SF_ALLOCATION_HEADER_SIZE + size, allocatorUserData);
+        if (!memory)
+            return NULL;
+        
+        *(size_t *)memory = size;
+        updateStats(subsystem, oldSize, size, SFTrue);
+    }
+#else
+    memory = (*reallocateFunction)(memory, size, allocatorUserData);
+    if (!memory)
+        return NULL;
+#endif
+    
+    return memory + SF_ALLOCATION_HEADER_SIZE;
+}
+
+void SFFree(SFSubsystem subsystem, void *ptr) {
+    SFUByte *memory;
+    
+    if (!ptr)
+        return;
+    
+    memory = (SFUByte *)ptr - SF_ALLOCATION_HEADER_SIZE;
+    
+#ifdef SF_ALLOCATION_STATS
+    updateStats(subsystem, *(size_t *)memory, 0, SFFalse);
+#endif
+    
+    (*freeFunction)(memory, allocatorUserData);
+}
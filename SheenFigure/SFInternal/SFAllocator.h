@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_ALLOCATOR_H
+#define _SF_ALLOCATOR_H
+
+#include <stddef.h>
+
+#include "SFConfig.h"
+#include "SFTypes.h"
+
+typedef void *(*SFAllocateFunction)(size_t size, void *userData);
+typedef void *(*SFReallocateFunction)(void *ptr, size_t size, void *userData);
+typedef void (*SFFreeFunction)(void *ptr, void *userData);
+
+//Makes the library take all of its memory from the given functions. It must be called before
+//any other function of the library, since memory has to be given back to the functions it
+//was taken from. Passing NULL functions goes back to malloc, realloc and free.
+void SFSetAllocator(SFAllocateFunction allocate, SFReallocateFunction reallocate, SFFreeFunction deallocate, void *userData);
+
+typedef enum {
+    SFSubsystemText = 0,            //Texts and their string records
+    SFSubsystemFont = 1,            //Fonts along with the bytes of their tables
+    SFSubsystemTables = 2,          //Parsed tables of the fonts
+    SFSubsystemCache = 3,           //Snapshots of parsed tables
+    SFSubsystemShaper = 4,          //Shapers along with their temporary memory
+    SFSubsystemCount = 5
+} SFSubsystem;
+
+typedef struct SFAllocationStats {
+    size_t allocations;             //Number of allocations made, including reallocations
+    size_t bytes;                   //Number of bytes currently allocated
+    size_t peakBytes;               //Highest number of bytes allocated at once
+} SFAllocationStats;
+
+//Gives the allocation counters of a subsystem, which are only kept with SF_ALLOCATION_STATS.
+void SFGetAllocationStats(SFSubsystem subsystem, SFAllocationStats *stats);
+
+//Sets the number of allocations of every subsystem to zero and their peaks to the bytes
+//allocated right now.
+void SFResetAllocationStats(void);
+
+void *SFAllocate(SFSubsystem subsystem, size_t size);
+void *SFAllocateZeroed(SFSubsystem subsystem, size_t size);
+void *SFReallocate(SFSubsystem subsystem, void *ptr, size_t size);
+void SFFree(SFSubsystem subsystem, void *ptr);
+
+#endif
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "SFAllocator.h"
+#include "SFArena.h"
+
+#define SF_ARENA_MIN_CHUNK_SIZE     (16 * 1024)
+#define SF_ARENA_MAX_CHUNK_SIZE     (256 * 1024)
+#define SF_ARENA_HEADER_SIZE        SF_ARENA_ALIGN(sizeof(SFArenaChunk))
+
+void SFArenaInitialize(SFArena *arena) {
+    arena->firstChunk = NULL;
+    arena->lastChunk = NULL;
+    
+    pthread_mutex_init(&arena->lock, NULL);
+}
+
+static SFArenaChunk *SFArenaAddChunk(SFArena *arena, size_t size) {
+    SFArenaChunk *chunk;
+    size_t chunkSize;
+    
+    //Every chunk is twice as big as the previous one, so that large tables need only a few of them.
+    chunkSize = arena->lastChunk ? arena->lastChunk->size * 2 : SF_ARENA_MIN_CHUNK_SIZE;
+    if (chunkSize > SF_ARENA_MAX_CHUNK_SIZE)
+        chunkSize = SF_ARENA_MAX_CHUNK_SIZE;
+    if (chunkSize < size)
+        chunkSize = size;
+    
+    chunk = SFAllocateZeroed(SFSubsystemTables, SF_ARENA_HEADER_SIZE + chunkSize);
+    chunk->next = NULL;
+    chunk->size = chunkSize;
+    chunk->used = 0;
+    
+    if (arena->lastChunk)
+        arena->lastChunk->next = chunk;
+    else
+        arena->firstChunk = chunk;
+    
+    arena->lastChunk = chunk;
+    
+    return chunk;
+}
+
+void *SFArenaAllocate(SFArena *arena, size_t size) {
+    SFArenaChunk *chunk;
+    void *memory;
+    
+    size = SF_ARENA_ALIGN(size);
+    
+    chunk = arena->lastChunk;
+    if (!chunk || chunk->size - chunk->used < size)
+        chunk = SFArenaAddChunk(arena, size);
+    
+    memory = SFArenaGetChunkBytes(chunk) + chunk->used;
+    chunk->used += size;
+    
+    return memory;
+}
+
+SFUByte *SFArenaGetChunkBytes(SFArenaChunk *chunk) {
+    return (SFUByte *)chunk + SF_ARENA_HEADER_SIZE;
+}
+
+size_t SFArenaGetSize(SFArena *arena) {
+    SFArenaChunk *chunk;
+    size_t size = 0;
+    
+    for (chunk = arena->firstChunk; chunk; chunk = chunk->next)
+        size += SF_ARENA_HEADER_SIZE + chunk->size;
+    
+    return size;
+}
+
+size_t SFArenaGetUsedSize(SFArena *arena) {
+    SFArenaChunk *chunk;
+    size_t size = 0;
+    
+    for (chunk = arena->firstChunk; chunk; chunk = chunk->next)
+        size += chunk->used;
+    
+    return size;
+}
+
+void SFArenaMerge(SFArena *arena, SFArena *other) {
+    if (other->firstChunk) {
+        if (arena->lastChunk)
+            arena->lastChunk->next = other->firstChunk;
+        else
+            arena->firstChunk = other->firstChunk;
+        
+        arena->lastChunk = other->lastChunk;
+        
+        other->firstChunk = NULL;
+        other->lastChunk = NULL;
+    }
+    
+    SFArenaFinalize(other);
+}
+
+void SFArenaLock(SFArena *arena) {
+    pthread_mutex_lock(&arena->lock);
+}
+
+void SFArenaUnlock(SFArena *arena) {
+    pthread_mutex_unlock(&arena->lock);
+}
+
+void SFArenaFinalize(SFArena *arena) {
+    SFArenaChunk *chunk = arena->firstChunk;
+    
+    while (chunk) {
+        SFArenaChunk *next = chunk->next;
+        SFFree(SFSubsystemTables, chunk);
+        
+        chunk = next;
+    }
+    
+    arena->firstChunk = NULL;
+    arena->lastChunk = NULL;
+    
+    pthread_mutex_destroy(&arena->lock);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_ARENA_H
+#define _SF_ARENA_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "SFConfig.h"
+#include "SFTypes.h"
+
+#define SF_ARENA_ALIGNMENT      8
+#define SF_ARENA_ALIGN(size)    (((size) + (SF_ARENA_ALIGNMENT - 1)) & ~(size_t)(SF_ARENA_ALIGNMENT - 1))
+
+typedef struct SFArenaChunk {
+    struct SFArenaChunk *next;
+    size_t size;                    //Number of bytes that can be handed out from the chunk
+    size_t used;                    //Number of bytes already handed out
+} SFArenaChunk;
+
+typedef struct SFArena {
+    SFArenaChunk *firstChunk;
+    SFArenaChunk *lastChunk;
+    pthread_mutex_t lock;           //Held by threads allocating once the arena is shared
+} SFArena;
+
+void SFArenaInitialize(SFArena *arena);
+
+//Returns zeroed memory that lives as long as the arena.
+void *SFArenaAllocate(SFArena *arena, size_t size);
+
+SFUByte *SFArenaGetChunkBytes(SFArenaChunk *chunk);
+
+//Returns the number of bytes taken by the chunks of the arena.
+size_t SFArenaGetSize(SFArena *arena);
+
+//Returns the number of bytes handed out by the arena.
+size_t SFArenaGetUsedSize(SFArena *arena);
+
+//Moves the chunks of other arena to the end of the arena and finalizes the other one.
+void SFArenaMerge(SFArena *arena, SFArena *other);
+
+void SFArenaLock(SFArena *arena);
+void SFArenaUnlock(SFArena *arena);
+
+void SFArenaFinalize(SFArena *arena);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_ATOMIC_H
+#define _SF_ATOMIC_H
+
+//Loads with acquire and stores with release semantics, used to publish data that is
+//written once and afterwards read by any thread without locking.
+
+#ifdef _MSC_VER
+
+#include <windows.h>
+
+static __inline void *SFAtomicLoadPointerValue(void * volatile *ptr) {
+    void *value = *ptr;
+    MemoryBarrier();
+    
+    return value;
+}
+
+static __inline void SFAtomicStorePointerValue(void * volatile *ptr, void *value) {
+    MemoryBarrier();
+    *ptr = value;
+}
+
+static __inline int SFAtomicLoadIntValue(volatile int *ptr) {
+    int value = *ptr;
+    MemoryBarrier();
+    
+    return value;
+}
+
+static __inline void SFAtomicStoreIntValue(volatile int *ptr, int value) {
+    MemoryBarrier();
+    *ptr = value;
+}
+
+#define SFAtomicLoadPointer(ptr)            SFAtomicLoadPointerValue((void * volatile *)(ptr))
+#define SFAtomicStorePointer(ptr, value)    SFAtomicStorePointerValue((void * volatile *)(ptr), (void *)(value))
+#define SFAtomicLoadInt(ptr)                SFAtomicLoadIntValue(ptr)
+#define SFAtomicStoreInt(ptr, value)        SFAtomicStoreIntValue(ptr, value)
+
+#else
+
+#define SFAtomicLoadPointer(ptr)            __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define SFAtomicStorePointer(ptr, value)    __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+#define SFAtomicLoadInt(ptr)                __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define SFAtomicStoreInt(ptr, value)        __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+
+#endif
+
+#endif
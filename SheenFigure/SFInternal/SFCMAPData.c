@@ -16,26 +16,76 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "SFCommonData.h"
 #include "SFCMAPData.h"
 
-static SFBool SFReadEncodingFormat(const SFUByte * const efTable, long tableLength, EncodingFormat *tablePtr) {
+//Subtables that cover all of Unicode are preferred over ones limited to the BMP, and
+//many-to-one mappings are only used as a last resort.
+static int SFGetEncodingFormatRank(SFUShort formatNumber) {
+    switch (formatNumber) {
+        case 12:
+            return 3;
+            
+        case 4:
+            return 2;
+            
+        case 13:
+            return 1;
+    }
+    
+    return 0;
+}
+
+static SFBool SFReadEncodingFormat(const SFUByte * const efTable, long tableLength, EncodingFormat *tablePtr, SFArena *arena) {
     SFUShort formatNumber = SFReadUShort(efTable, 0);
     
-    if (formatNumber == 4) {
-        SFUShort segCount;
-        SFUShort *startCount;
-        SFUShort *endCount;
+    if ((formatNumber == 12 || formatNumber == 13) && tableLength >= 16) {
+        SFUInt numGroups;
         
-        SFUShort *idDelta;
-        SFUShort *idRangeOffset;
+#ifdef CMAP_TEST
+        SFUInt i;
+#endif
+        
+        tablePtr->formatNumber = formatNumber;
+        tablePtr->format.format12.length = SFReadUInt(efTable, 4);
+        tablePtr->format.format12.language = SFReadUInt(efTable, 8);
+        
+        //Groups that lie outside of the table are dropped.
+        numGroups = SFReadUInt(efTable, 12);
+        if (numGroups > (SFUInt)((tableLength - 16) / 12))
+            numGroups = (SFUInt)((tableLength - 16) / 12);
+        
+        tablePtr->format.format12.numGroups = numGroups;
+        tablePtr->format.format12.groups = SFReadUIntArray(efTable, 16, numGroups * 3, arena);
+        
+#ifdef CMAP_TEST
+        printf("\n   Format Number: %d", formatNumber);
+        printf("\n   Length: %u", tablePtr->format.format12.length);
+        printf("\n   Language: %u", tablePtr->format.format12.language);
+        printf("\n   Number of Groups: %u", numGroups);
+        
+        for (i = 0; i < numGroups; i++) {
+            printf("\n   Group At Index %u:", i);
+            printf("\n    Start Char Code: %u", SFUIntArrayGet(tablePtr->format.format12.groups, i * 3));
+            printf("\n    End Char Code: %u", SFUIntArrayGet(tablePtr->format.format12.groups, i * 3 + 1));
+            printf("\n    Glyph ID: %u", SFUIntArrayGet(tablePtr->format.format12.groups, i * 3 + 2));
+        }
+#endif
         
+        return SFTrue;
+    }
+    
+    if (formatNumber == 4) {
+        SFUShort segCount;
         SFUShort glyphArrLength;
-        SFUShort *glyphIdArray;
         
         SFUShort beginOffset;
+        
+#ifdef CMAP_TEST
         SFUShort i;
+#endif
         
         tablePtr->formatNumber = formatNumber;
         tablePtr->format.format4.length = SFReadUShort(efTable, 2);
@@ -56,82 +106,45 @@ static SFBool SFReadEncodingFormat(const SFUByte * const efTable, long tableLeng
 #endif
         
         segCount = tablePtr->format.format4.segCountX2 / 2;
-        endCount = malloc(sizeof(SFUShort) * segCount);
         
         beginOffset = 14;
-        for (i = 0; i < segCount; i++) {
-            endCount[i] = SFReadUShort(efTable, beginOffset);
-            
-#ifdef CMAP_TEST
-            printf("\n   End Code At Index %d: %d", i, endCount[i]);
-#endif
-            
-            beginOffset += 2;
-        }
+        tablePtr->format.format4.endCount = SFReadUShortArray(efTable, beginOffset, segCount, arena);
+        beginOffset += segCount * 2;
         
         tablePtr->format.format4.reservedPad = SFReadUShort(efTable, beginOffset);
         beginOffset += 2;
         
-        tablePtr->format.format4.endCount = endCount;
+        tablePtr->format.format4.startCount = SFReadUShortArray(efTable, beginOffset, segCount, arena);
+        beginOffset += segCount * 2;
         
-        startCount = malloc(sizeof(SFUShort) * segCount);
-        for (i = 0; i < segCount; i++) {
-            startCount[i] = SFReadUShort(efTable, beginOffset);
-            
-#ifdef CMAP_TEST
-            printf("\n   Start Code At Index %d: %d", i, startCount[i]);
-#endif
-            
-            beginOffset += 2;
-        }
+        tablePtr->format.format4.idDelta = SFReadUShortArray(efTable, beginOffset, segCount, arena);
+        beginOffset += segCount * 2;
         
-        tablePtr->format.format4.startCount = startCount;
+        tablePtr->format.format4.idRangeOffset = SFReadUShortArray(efTable, beginOffset, segCount, arena);
+        beginOffset += segCount * 2;
         
-        idDelta = malloc(sizeof(SFUShort) * segCount);
-        for (i = 0; i < segCount; i++) {
-            idDelta[i] = SFReadUShort(efTable, beginOffset);
-            
 #ifdef CMAP_TEST
-            printf("\n   ID Delta At Index %d: %d", i, idDelta[i]);
-#endif
-            
-            beginOffset += 2;
-        }
-        
-        tablePtr->format.format4.idDelta = idDelta;
-        
-        idRangeOffset = malloc(sizeof(SFUShort) * segCount);
         for (i = 0; i < segCount; i++) {
-            idRangeOffset[i] = SFReadUShort(efTable, beginOffset);
-            
-#ifdef CMAP_TEST
-            printf("\n   ID Range Offset At Index %d: %d", i, idRangeOffset[i]);
-#endif
-            
-            beginOffset += 2;
+            printf("\n   Segment At Index %d:", i);
+            printf("\n    End Code: %d", SFUShortArrayGet(tablePtr->format.format4.endCount, i));
+            printf("\n    Start Code: %d", SFUShortArrayGet(tablePtr->format.format4.startCount, i));
+            printf("\n    ID Delta: %d", SFUShortArrayGet(tablePtr->format.format4.idDelta, i));
+            printf("\n    ID Range Offset: %d", SFUShortArrayGet(tablePtr->format.format4.idRangeOffset, i));
         }
-        
-        tablePtr->format.format4.idRangeOffset = idRangeOffset;
+#endif
         
         if (tablePtr->format.format4.length > tableLength)
             glyphArrLength = (tableLength - beginOffset);
         else
             glyphArrLength = (tablePtr->format.format4.length - beginOffset);
         
-        glyphIdArray = malloc(glyphArrLength);
-        
         glyphArrLength /= sizeof(SFUShort);
-        for (i = 0; i < glyphArrLength; i++) {
-            glyphIdArray[i] = SFReadUShort(efTable, beginOffset);
-            
+        tablePtr->format.format4.glyphIdArray = SFReadUShortArray(efTable, beginOffset, glyphArrLength, arena);
+        
 #ifdef CMAP_TEST
-            printf("\n   Glyph ID At Index %d: %d", i, glyphIdArray[i]);
+        for (i = 0; i < glyphArrLength; i++)
+            printf("\n   Glyph ID At Index %d: %d", i, SFUShortArrayGet(tablePtr->format.format4.glyphIdArray, i));
 #endif
-            
-            beginOffset += 2;
-        }
-        
-        tablePtr->format.format4.glyphIdArray = glyphIdArray;
         
         return SFTrue;
     }
@@ -139,25 +152,29 @@ static SFBool SFReadEncodingFormat(const SFUByte * const efTable, long tableLeng
     return SFFalse;
 }
 
-static void SFFreeEncodingFormat(EncodingFormat *tablePtr) {
-    free(tablePtr->format.format4.endCount);
-    free(tablePtr->format.format4.startCount);
-    free(tablePtr->format.format4.idDelta);
-    free(tablePtr->format.format4.idRangeOffset);
-    free(tablePtr->format.format4.glyphIdArray);
-}
-
 
-void SFReadCMAP(const SFUByte * const table, SFTableCMAP *tablePtr, long cmapLength) {
+void SFReadCMAP(const SFUByte * const table, SFTableCMAP *tablePtr, long cmapLength, SFArena *arena) {
 	SFUShort i;
     int beginOffset = 0;
     
+    int bestRank = 0;
+    SFUShort bestPlatformID = 0;
+    SFUShort bestEncodingID = 0;
+    SFUInt bestOffset = 0;
+    
     tablePtr->version = SFReadUShort(table, beginOffset);
     beginOffset += 2;
     
     tablePtr->numTables = SFReadUShort(table, beginOffset);
     beginOffset += 2;
     
+    tablePtr->encodingSubtable.encodingFormat.formatNumber = 0;
+    tablePtr->encodingSubtable.encodingFormat.format.format4.segCountX2 = 0;
+    
+    memset(tablePtr->glyphPages, 0, sizeof(tablePtr->glyphPages));
+    memset(tablePtr->planePages, 0, sizeof(tablePtr->planePages));
+    tablePtr->loadedSize = 0;
+    
 #ifdef CMAP_TEST
     printf("\nCMAP:");
     printf("\n Version: %d", tablePtr->version);
@@ -170,8 +187,6 @@ void SFReadCMAP(const SFUByte * const table, SFTableCMAP *tablePtr, long cmapLen
         SFUShort encodingID = SFReadUShort(table, beginOffset + 2);
         SFUInt formatOffset = SFReadUInt(table, beginOffset + 4);
         
-        SFUShort previousEncodingID = 0;
-        
         beginOffset += 8;
         
 #ifdef CMAP_TEST
@@ -180,26 +195,33 @@ void SFReadCMAP(const SFUByte * const table, SFTableCMAP *tablePtr, long cmapLen
         printf("\n  Encoding ID: %d", encodingID);
 #endif
         
-        if ((platformID == piUnicode && encodingID >= previousEncodingID)
-            || (platformID == piMicrosoft && (encodingID == msSymbol || encodingID == msUnicodeBMP_UCS_2))) {
-            EncodingFormat eFormat;
-            if (SFReadEncodingFormat(&table[formatOffset], cmapLength - formatOffset, &eFormat)) {
+        if ((platformID == piUnicode)
+            || (platformID == piMicrosoft && (encodingID == msSymbol || encodingID == msUnicodeBMP_UCS_2 || encodingID == msUnicode_UCS_4))) {
+            if (formatOffset + 2 <= cmapLength) {
+                int rank = SFGetEncodingFormatRank(SFReadUShort(table, formatOffset));
                 
+                if (rank > bestRank) {
+                    bestRank = rank;
+                    bestPlatformID = platformID;
+                    bestEncodingID = encodingID;
+                    bestOffset = formatOffset;
+                }
+            }
+        }
+    }
+    
+    if (bestRank) {
+        EncodingFormat eFormat;
+        if (SFReadEncodingFormat(&table[bestOffset], cmapLength - bestOffset, &eFormat, arena)) {
+            
 #ifdef CMAP_TEST
-                printf("\n  Format Table:");
-                printf("\n   Offset: %u", formatOffset);
+            printf("\n  Format Table:");
+            printf("\n   Offset: %u", bestOffset);
 #endif
-                
-                tablePtr->encodingSubtable.platformID = platformID;
-                tablePtr->encodingSubtable.encodingID.unicodeEncodingID = encodingID;
-                tablePtr->encodingSubtable.encodingFormat = eFormat;
-                
-                break;
-            }
+            
+            tablePtr->encodingSubtable.platformID = bestPlatformID;
+            tablePtr->encodingSubtable.encodingID.unicodeEncodingID = bestEncodingID;
+            tablePtr->encodingSubtable.encodingFormat = eFormat;
         }
     }
 }
-
-void SFFreeCMAP(SFTableCMAP *tablePtr) {
-    SFFreeEncodingFormat(&tablePtr->encodingSubtable.encodingFormat);
-}
@@ -19,6 +19,11 @@
 
 #include "SFConfig.h"
 #include "SFTypes.h"
+#include "SFCommonData.h"
+
+#define SF_CMAP_PAGE_SIZE           256
+#define SF_CMAP_PAGE_COUNT          (0x10000 / SF_CMAP_PAGE_SIZE)
+#define SF_CMAP_PLANE_COUNT         16
 
 typedef enum {
     piUnicode = 0,                      //Indicates Unicode version.
@@ -94,13 +99,23 @@ typedef struct EncodingFormat {
             SFUShort searchRange;       //2 * (2**floor(log2(segCount)))	 
             SFUShort entrySelector;     //log2(searchRange/2)	 
             SFUShort rangeShift;        //(2 * segCount) - searchRange	 
-            SFUShort *endCount;         //Ending character code for each segment, last = 0xFFFF.	
+            SFUShortArray endCount;     //Ending character code for each segment, last = 0xFFFF.	
             SFUShort reservedPad;       //This value should be zero	
-            SFUShort *startCount;       //Starting character code for each segment	
-            SFUShort *idDelta;          //Delta for all character codes in segment	 
-            SFUShort *idRangeOffset;    //Offset in bytes to glyph indexArray, or 0	 
-            SFUShort *glyphIdArray;     //Glyph index array
+            SFUShortArray startCount;   //Starting character code for each segment	
+            SFUShortArray idDelta;      //Delta for all character codes in segment	 
+            SFUShortArray idRangeOffset;//Offset in bytes to glyph indexArray, or 0	 
+            SFUShortArray glyphIdArray; //Glyph index array
         } format4;
+        
+        //Format 13 has the same layout, but every character of a group maps to its glyph.
+        struct {
+            SFUInt length;              //Byte length of this subtable (including the header)
+            SFUInt language;            //Language code for this encoding subtable, or zero
+                                        //if language-independent
+            SFUInt numGroups;           //Number of groupings which follow
+            SFUIntArray groups;         //Triplets of start character code, end character code
+                                        //and start glyph ID (or glyph ID for format 13)
+        } format12;
     } format;
 } EncodingFormat;
 
@@ -119,9 +134,14 @@ typedef struct SFTableCMAP {
     SFUShort version;                   //Table version number (0).
     SFUShort numTables;                 //Number of encoding tables that follow.
     EncodingSubtable encodingSubtable;
+    
+    SFGlyph *glyphPages[SF_CMAP_PAGE_COUNT];//Glyphs of every block of characters, filled when
+                                        //a character of the block is mapped for the first time
+    SFGlyph **planePages[SF_CMAP_PLANE_COUNT];//Blocks of the supplementary planes, allocated
+                                        //when a character of the plane is mapped
+    size_t loadedSize;                  //Number of bytes taken by the filled blocks
 } SFTableCMAP;
 
-void SFReadCMAP(const SFUByte * const table, SFTableCMAP *tablePtr, long cmapLength);
-void SFFreeCMAP(SFTableCMAP *tablePtr);
+void SFReadCMAP(const SFUByte * const table, SFTableCMAP *tablePtr, long cmapLength, SFArena *arena);
 
 #endif
@@ -14,34 +14,79 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
+#include <string.h>
+
+#include "SFAtomic.h"
 #include "SFCMAPUtilization.h"
 
-SFGlyph SFCharToGlyph(SFTableCMAP *cmap, SFUnichar ch) {
+#define SFHasEncodingGroups(cmap)   \
+    ((cmap)->encodingSubtable.encodingFormat.formatNumber == 12 || (cmap)->encodingSubtable.encodingFormat.formatNumber == 13)
+
+static SFGlyph SFGroupCharToGlyph(EncodingFormat *format, SFCodepoint ch) {
+    SFUIntArray groups = format->format.format12.groups;
+    SFUInt low = 0;
+    SFUInt high = format->format.format12.numGroups;
+    
+    //Groups are sorted by their start codes and do not overlap.
+    while (low < high) {
+        SFUInt mid = low + (high - low) / 2;
+        
+        if (SFUIntArrayGet(groups, mid * 3 + 1) < ch) {
+            low = mid + 1;
+        } else if (SFUIntArrayGet(groups, mid * 3) > ch) {
+            high = mid;
+        } else {
+            SFUInt glyph = SFUIntArrayGet(groups, mid * 3 + 2);
+            
+            if (format->formatNumber == 12)
+                glyph += ch - SFUIntArrayGet(groups, mid * 3);
+            
+            return (glyph > 0xFFFF ? 0 : glyph);
+        }
+    }
+    
+    return 0;
+}
+
+SFGlyph SFCharToGlyph(SFTableCMAP *cmap, SFCodepoint ch) {
     SFUShort segCount = cmap->encodingSubtable.encodingFormat.format.format4.segCountX2 / 2;
     
     SFGlyph charGlyph;
     SFUShort i;
+    SFUShort high;
     
-    for (i = 0; i < segCount; i++) {
-        if (cmap->encodingSubtable.encodingFormat.format.format4.endCount[i] >= ch) {
-            break;
-        }
+    if (SFHasEncodingGroups(cmap))
+        return SFGroupCharToGlyph(&cmap->encodingSubtable.encodingFormat, ch);
+    
+    //Segments are sorted by their end codes, so the first one ending at or after the
+    //character is searched for.
+    i = 0;
+    high = segCount;
+    
+    while (i < high) {
+        SFUShort mid = (i + high) / 2;
+        
+        if (SFUShortArrayGet(cmap->encodingSubtable.encodingFormat.format.format4.endCount, mid) < ch)
+            i = mid + 1;
+        else
+            high = mid;
     }
     
     if (i < segCount) {
-        SFUShort startCount = cmap->encodingSubtable.encodingFormat.format.format4.startCount[i];
+        SFUShort startCount = SFUShortArrayGet(cmap->encodingSubtable.encodingFormat.format.format4.startCount, i);
         if (startCount > ch) {
             charGlyph = 0;
         } else {
-            SFUShort idRangeOffset = cmap->encodingSubtable.encodingFormat.format.format4.idRangeOffset[i];
+            SFUShort idRangeOffset = SFUShortArrayGet(cmap->encodingSubtable.encodingFormat.format.format4.idRangeOffset, i);
             
             if (idRangeOffset == 0)
-                charGlyph = (cmap->encodingSubtable.encodingFormat.format.format4.idDelta[i] + ch) % 0x10000;
+                charGlyph = (SFUShortArrayGet(cmap->encodingSubtable.encodingFormat.format.format4.idDelta, i) + ch) % 0x10000;
             else {
                 SFUShort idIndex = (idRangeOffset / 2) - segCount + i + (ch - startCount);
-                SFGlyph glyph = cmap->encodingSubtable.encodingFormat.format.format4.glyphIdArray[idIndex];
+                SFGlyph glyph = SFUShortArrayGet(cmap->encodingSubtable.encodingFormat.format.format4.glyphIdArray, idIndex);
                 if (glyph) {
-                    glyph += cmap->encodingSubtable.encodingFormat.format.format4.idDelta[i];
+                    glyph += SFUShortArrayGet(cmap->encodingSubtable.encodingFormat.format.format4.idDelta, i);
                 }
                 
                 charGlyph = glyph;
@@ -54,9 +99,104 @@ SFGlyph SFCharToGlyph(SFTableCMAP *cmap, SFUnichar ch) {
     return charGlyph;
 }
 
-void SFApplyCMAP(SFInternal *internal) {
-    SFGlyphIndex index = SFMakeGlyphIndex(0, 0);
-    for (; index.record < SFGetCharCount(internal); index.record++) {
-        SFGetGlyph(internal, index) = SFCharToGlyph(internal->cmap, SFGetChar(internal, index.record));
+static SFGlyph *SFLoadGlyphPage(SFTableCMAP *cmap, SFGlyph **pagePtr, SFCodepoint firstChar, SFArena *arena) {
+    SFGlyph *page = SFAtomicLoadPointer(pagePtr);
+    
+    //Pages are published after they are completely filled, so only the first use of a
+    //page has to take the lock.
+    if (page)
+        return page;
+    
+    SFArenaLock(arena);
+    
+    page = *pagePtr;
+    
+    if (!page) {
+        int i;
+        
+        page = SFArenaAllocate(arena, sizeof(SFGlyph) * SF_CMAP_PAGE_SIZE);
+        
+        for (i = 0; i < SF_CMAP_PAGE_SIZE; i++)
+            page[i] = SFCharToGlyph(cmap, firstChar + i);
+        
+        cmap->loadedSize += sizeof(SFGlyph) * SF_CMAP_PAGE_SIZE;
+        SFAtomicStorePointer(pagePtr, page);
     }
+    
+    SFArenaUnlock(arena);
+    
+    return page;
+}
+
+static SFGlyph **SFLoadPlanePages(SFTableCMAP *cmap, int planeIndex, SFArena *arena) {
+    SFGlyph **pages = SFAtomicLoadPointer(&cmap->planePages[planeIndex]);
+    
+    if (pages)
+        return pages;
+    
+    SFArenaLock(arena);
+    
+    pages = cmap->planePages[planeIndex];
+    
+    if (!pages) {
+        pages = SFArenaAllocate(arena, sizeof(SFGlyph *) * SF_CMAP_PAGE_COUNT);
+        memset(pages, 0, sizeof(SFGlyph *) * SF_CMAP_PAGE_COUNT);
+        
+        cmap->loadedSize += sizeof(SFGlyph *) * SF_CMAP_PAGE_COUNT;
+        SFAtomicStorePointer(&cmap->planePages[planeIndex], pages);
+    }
+    
+    SFArenaUnlock(arena);
+    
+    return pages;
+}
+
+SFGlyph SFGetCharGlyph(SFTableCMAP *cmap, SFCodepoint ch, SFArena *arena) {
+    SFGlyph **pages;
+    SFGlyph *page;
+    
+    if (ch <= 0xFFFF) {
+        pages = cmap->glyphPages;
+    } else {
+        //Only subtables made of groups map characters outside of the BMP.
+        if (ch > 0x10FFFF || !SFHasEncodingGroups(cmap))
+            return 0;
+        
+        pages = SFLoadPlanePages(cmap, (ch >> 16) - 1, arena);
+    }
+    
+    page = SFLoadGlyphPage(cmap, &pages[(ch & 0xFFFF) / SF_CMAP_PAGE_SIZE], ch - (ch % SF_CMAP_PAGE_SIZE), arena);
+    return page[ch % SF_CMAP_PAGE_SIZE];
+}
+
+void SFCharsToGlyphs(SFTableCMAP *cmap, const SFUnichar *chars, int count, SFGlyph *glyphs, SFArena *arena) {
+    const SFGlyph *page = NULL;
+    int pageIndex = -1;
+    int i;
+    
+    for (i = 0; i < count; i++) {
+        SFUnichar ch = chars[i];
+        
+        if (SFIsSurrogatePair(chars, count, i)) {
+            //The glyph of a surrogate pair is kept by its first unit and the second one is
+            //left empty like a component of a ligature.
+            glyphs[i] = SFGetCharGlyph(cmap, SFMakeCodepoint(ch, chars[i + 1]), arena);
+            glyphs[++i] = 0;
+        } else {
+            //Text mostly comes from a few blocks, so the page of the previous character is
+            //kept until a character of another block shows up.
+            if (ch / SF_CMAP_PAGE_SIZE != pageIndex) {
+                pageIndex = ch / SF_CMAP_PAGE_SIZE;
+                page = SFLoadGlyphPage(cmap, &cmap->glyphPages[pageIndex], ch - (ch % SF_CMAP_PAGE_SIZE), arena);
+            }
+            
+            glyphs[i] = page[ch % SF_CMAP_PAGE_SIZE];
+        }
+    }
+}
+
+//Applied to a cleared record, in which every character has a single glyph at its own index, so
+//the glyphs are looked up right into the glyph array.
+void SFApplyCMAP(SFInternal *internal) {
+    SFCharsToGlyphs(internal->cmap, internal->record->chars, SFGetCharCount(internal), internal->record->glyphs, internal->arena);
 }
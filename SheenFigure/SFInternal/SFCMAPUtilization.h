@@ -19,7 +19,9 @@
 
 #include "SFInternal.h"
 
-SFGlyph SFCharToGlyph(SFTableCMAP *cmap, SFUnichar ch);
+SFGlyph SFCharToGlyph(SFTableCMAP *cmap, SFCodepoint ch);
+SFGlyph SFGetCharGlyph(SFTableCMAP *cmap, SFCodepoint ch, SFArena *arena);
+void SFCharsToGlyphs(SFTableCMAP *cmap, const SFUnichar *chars, int count, SFGlyph *glyphs, SFArena *arena);
 void SFApplyCMAP(SFInternal *internal);
 
 #endif
\ No newline at end of file
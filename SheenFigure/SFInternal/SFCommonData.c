@@ -16,7 +16,18 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SF_DECODE_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SF_DECODE_NEON
+#endif
+
+#include "SFAtomic.h"
 #include "SFCommonData.h"
 
 SFUShort SFReadUShort(const SFUByte *base, uintptr_t offset) {
@@ -27,12 +38,71 @@ SFUInt SFReadUInt(const SFUByte *base, uintptr_t offset) {
     return ((((SFUInt)base[offset] << 24) | base[offset + 1] << 16) | base[offset + 2] << 8) | base[offset + 3];
 }
 
-void SFReadLangSysTable(const SFUByte * const lsTable, LangSysTable *tablePtr) {
-    SFUShort *featureIndexes;
-    SFUShort i;
+void SFDecodeUShorts(SFUShort *dst, const SFUByte *src, size_t count) {
+    size_t i = 0;
+    
+    //Eight values are swapped at a time where the vector unit is always available, the
+    //remaining ones are read one by one.
+#if defined(SF_DECODE_SSE2)
+    for (; i + 8 <= count; i += 8) {
+        __m128i values = _mm_loadu_si128((const __m128i *)&src[i * 2]);
+        values = _mm_or_si128(_mm_slli_epi16(values, 8), _mm_srli_epi16(values, 8));
+        _mm_storeu_si128((__m128i *)&dst[i], values);
+    }
+#elif defined(SF_DECODE_NEON)
+    for (; i + 8 <= count; i += 8)
+        vst1q_u16(&dst[i], vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(&src[i * 2]))));
+#endif
+    
+    for (; i < count; i++)
+        dst[i] = SFReadUShort(src, i * 2);
+}
+
+void SFDecodeUInts(SFUInt *dst, const SFUByte *src, size_t count) {
+    size_t i = 0;
+    
+#if defined(SF_DECODE_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        __m128i values = _mm_loadu_si128((const __m128i *)&src[i * 4]);
+        values = _mm_or_si128(_mm_slli_epi16(values, 8), _mm_srli_epi16(values, 8));
+        values = _mm_shufflehi_epi16(_mm_shufflelo_epi16(values, 0xB1), 0xB1);
+        _mm_storeu_si128((__m128i *)&dst[i], values);
+    }
+#elif defined(SF_DECODE_NEON)
+    for (; i + 4 <= count; i += 4)
+        vst1q_u32(&dst[i], vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&src[i * 4]))));
+#endif
+    
+    for (; i < count; i++)
+        dst[i] = SFReadUInt(src, i * 4);
+}
+
+SFUShortArray SFReadUShortArray(const SFUByte *base, uintptr_t offset, SFUInt count, SFArena *arena) {
+#ifdef SF_TABLE_VIEWS
+    return &base[offset];
+#else
+    SFUShort *array = SFArenaAllocate(arena, sizeof(SFUShort) * count);
+    SFDecodeUShorts(array, &base[offset], count);
     
+    return array;
+#endif
+}
+
+SFUIntArray SFReadUIntArray(const SFUByte *base, uintptr_t offset, SFUInt count, SFArena *arena) {
+#ifdef SF_TABLE_VIEWS
+    return &base[offset];
+#else
+    SFUInt *array = SFArenaAllocate(arena, sizeof(SFUInt) * count);
+    SFDecodeUInts(array, &base[offset], count);
+    
+    return array;
+#endif
+}
+
+void SFReadLangSysTable(const SFUByte * const lsTable, LangSysTable *tablePtr, SFArena *arena) {
 #ifdef SCRIPT_TEST
     SFUShort lookupOrderOffset = SFReadUShort(lsTable, 0);
+    SFUShort i;
 #endif
     
     tablePtr->reqFeatureIndex = SFReadUShort(lsTable, 2);
@@ -45,25 +115,16 @@ void SFReadLangSysTable(const SFUByte * const lsTable, LangSysTable *tablePtr) {
     printf("\n     Feature Indexes:");
 #endif
     
-    featureIndexes = malloc(2 * tablePtr->featureCount);
+    tablePtr->featureIndex = SFReadUShortArray(lsTable, 6, tablePtr->featureCount, arena);
     
-    for (i = 0; i < tablePtr->featureCount; i++) {
-        featureIndexes[i] = SFReadUShort(lsTable, 6 + (i * 2));
-        
 #ifdef SCRIPT_TEST
-        printf("\n      Index %d: %d", i, featureIndexes[i]);
+    for (i = 0; i < tablePtr->featureCount; i++)
+        printf("\n      Index %d: %d", i, SFUShortArrayGet(tablePtr->featureIndex, i));
 #endif
-    }
-    
-    tablePtr->featureIndex = featureIndexes;
-}
-
-void SFFreeLangSysTable(LangSysTable *tablePtr) {
-    free(tablePtr->featureIndex);
 }
 
 
-void SFReadScriptTable(const SFUByte * const sTable, ScriptTable *tablePtr) {
+void SFReadScriptTable(const SFUByte * const sTable, ScriptTable *tablePtr, SFArena *arena) {
     SFUShort langSysOffset = SFReadUShort(sTable, 0);
     
     SFUShort langSysCount;
@@ -76,7 +137,7 @@ void SFReadScriptTable(const SFUByte * const sTable, ScriptTable *tablePtr) {
     printf("\n     Offset: %d", langSysOffset);
 #endif
     
-    SFReadLangSysTable(&sTable[langSysOffset], &tablePtr->defaultLangSys);
+    SFReadLangSysTable(&sTable[langSysOffset], &tablePtr->defaultLangSys, arena);
     
     langSysCount = SFReadUShort(sTable, 2);
     tablePtr->langSysCount = langSysCount;
@@ -85,7 +146,7 @@ void SFReadScriptTable(const SFUByte * const sTable, ScriptTable *tablePtr) {
     printf("\n    Total Lang Sys: %d", langSysCount);
 #endif
     
-    langSysRecords = malloc(sizeof(LangSysRecord) * langSysCount);
+    langSysRecords = SFArenaAllocate(arena, sizeof(LangSysRecord) * langSysCount);
     
     for (i = 0; i < langSysCount; i++) {
         SFUByte offset = 4 + (i * 4);
@@ -105,25 +166,14 @@ void SFReadScriptTable(const SFUByte * const sTable, ScriptTable *tablePtr) {
         printf("\n      Offset: %d", langSysOffset);
 #endif
         
-        SFReadLangSysTable(&sTable[langSysOffset], &langSysRecords[i].LangSys);
+        SFReadLangSysTable(&sTable[langSysOffset], &langSysRecords[i].LangSys, arena);
     }
     
     tablePtr->langSysRecord = langSysRecords;
 }
 
-void SFFreeScriptTable(ScriptTable *tablePtr) {
-	int i;
 
-    SFFreeLangSysTable(&tablePtr->defaultLangSys);
-    
-    for (i = 0; i < tablePtr->langSysCount; i++)
-        SFFreeLangSysTable(&tablePtr->langSysRecord[i].LangSys);
-    
-    free(tablePtr->langSysRecord);
-}
-
-
-void SFReadScriptListTable(const SFUByte * const slTable, ScriptListTable *tablePtr) {
+void SFReadScriptListTable(const SFUByte * const slTable, ScriptListTable *tablePtr, SFArena *arena) {
     ScriptRecord *scriptRecords;
     SFUShort scriptOffset;
     
@@ -135,7 +185,7 @@ void SFReadScriptListTable(const SFUByte * const slTable, ScriptListTable *table
     printf("\n  Total Scripts: %d", tablePtr->scriptCount);
 #endif
     
-    scriptRecords = malloc(sizeof(ScriptRecord) * tablePtr->scriptCount);
+    scriptRecords = SFArenaAllocate(arena, sizeof(ScriptRecord) * tablePtr->scriptCount);
     
     for (i = 0; i < tablePtr->scriptCount; i++) {
         SFUShort offset = 2 + (i * 6);
@@ -155,31 +205,19 @@ void SFReadScriptListTable(const SFUByte * const slTable, ScriptListTable *table
         printf("\n    Offset: %d", scriptOffset);
 #endif
         
-        SFReadScriptTable(&slTable[scriptOffset], &scriptRecords[i].script);
+        SFReadScriptTable(&slTable[scriptOffset], &scriptRecords[i].script, arena);
     }
     
     tablePtr->scriptRecord = scriptRecords;
 }
 
-void SFFreeScriptListTable(ScriptListTable *tablePtr) {
-	int i;
-    for (i = 0; i < tablePtr->scriptCount; i++)
-        SFFreeScriptTable(&tablePtr->scriptRecord[i].script);
-    
-    free(tablePtr->scriptRecord);
-}
 
 
-
-void SFReadFeatureTable(const SFUByte * const fTable, FeatureTable *tablePtr) {
+void SFReadFeatureTable(const SFUByte * const fTable, FeatureTable *tablePtr, SFArena *arena) {
 #ifdef FEATURE_TEST
     SFUShort featureParams;
-#endif
-    
-    SFUShort *lookupListIndexes;
     SFUShort i;
     
-#ifdef FEATURE_TEST
     featureParams = SFReadUShort(fTable, 0);
 #endif
     
@@ -191,25 +229,16 @@ void SFReadFeatureTable(const SFUByte * const fTable, FeatureTable *tablePtr) {
     printf("\n    Lookup Indexes:");
 #endif
     
-    lookupListIndexes = malloc(sizeof(SFUShort) * tablePtr->lookupCount);
+    tablePtr->lookupListIndex = SFReadUShortArray(fTable, 4, tablePtr->lookupCount, arena);
     
-    for (i = 0; i < tablePtr->lookupCount; i++) {
-        lookupListIndexes[i] = SFReadUShort(fTable, 4 + (i * 2));
-        
 #ifdef FEATURE_TEST
-        printf("\n     Index %d: %d", i, lookupListIndexes[i]);
+    for (i = 0; i < tablePtr->lookupCount; i++)
+        printf("\n     Index %d: %d", i, SFUShortArrayGet(tablePtr->lookupListIndex, i));
 #endif
-    }
-    
-    tablePtr->lookupListIndex = lookupListIndexes;
-}
-
-void SFFreeFeatureTable(FeatureTable *tablePtr) {
-    free(tablePtr->lookupListIndex);
 }
 
 
-void SFReadFeatureListTable(const SFUByte * const flTable, FeatureListTable *tablePtr) {
+void SFReadFeatureListTable(const SFUByte * const flTable, FeatureListTable *tablePtr, SFArena *arena) {
     FeatureRecord *featureRecords;
     SFUShort i;
     
@@ -219,7 +248,7 @@ void SFReadFeatureListTable(const SFUByte * const flTable, FeatureListTable *tab
     printf("\n  Total Feature: %d", tablePtr->featureCount);
 #endif
     
-    featureRecords = malloc(sizeof(FeatureRecord) * tablePtr->featureCount);
+    featureRecords = SFArenaAllocate(arena, sizeof(FeatureRecord) * tablePtr->featureCount);
     
     for (i = 0; i < tablePtr->featureCount; i++) {
         SFUShort currentOffset;
@@ -242,46 +271,32 @@ void SFReadFeatureListTable(const SFUByte * const flTable, FeatureListTable *tab
         printf("\n    Offset: %d", featureOffset);
 #endif
         
-        SFReadFeatureTable(&flTable[featureOffset], &featureRecords[i].feature);
+        SFReadFeatureTable(&flTable[featureOffset], &featureRecords[i].feature, arena);
     }
     
     tablePtr->featureRecord = featureRecords;
 }
 
-void SFFreeFeatureListTable(FeatureListTable *tablePtr) {
-	int i;
-    for (i = 0; i < tablePtr->featureCount; i++)
-        SFFreeFeatureTable(&tablePtr->featureRecord[i].feature);
-    
-    free(tablePtr->featureRecord);
-}
-
-void SFReadLookupTable(const SFUByte * const llTable, LookupTable *tablePtr, SubtableFunction func) {
+static void SFReadLookupSubtables(const SFUByte * const llTable, LookupTable *tablePtr, SubtableFunction func, SFArena *arena) {
     LookupType lookupType;
-    LookupFlag lookupFlag;
     SFUShort subTableCount;
     
     void **subtables;
+    SFGlyphDigest *subtableDigests;
     
     LookupType tmpLookup;
     SFUShort i, offset;
     
     lookupType = SFReadUShort(llTable, 0);
-    lookupFlag = SFReadUShort(llTable, 2);
-    subTableCount = SFReadUShort(llTable, 4);
+    subTableCount = tablePtr->subTableCount;
     
-    tablePtr->subTableCount = subTableCount;
-    
-#ifdef LOOKUP_TEST
-    printf("\n    Lookup Type: %d", lookupType);
-    printf("\n    Lookup Flag: %d", lookupFlag);
-    printf("\n    Total Subtables: %d", subTableCount);
-#endif
-    
-    subtables = malloc(sizeof(void *) * subTableCount);
+    subtables = SFArenaAllocate(arena, sizeof(void *) * subTableCount);
+    subtableDigests = SFArenaAllocate(arena, sizeof(SFGlyphDigest) * subTableCount);
     tmpLookup = lookupType;
     
-    for (i = 0, offset = 0; i < subTableCount; i++) {
+    SFClearGlyphDigest(&tablePtr->digest);
+    
+    for (i = 0; i < subTableCount; i++) {
         offset = SFReadUShort(llTable, 6 + (i * 2));
         
 #ifdef LOOKUP_TEST
@@ -289,37 +304,168 @@ void SFReadLookupTable(const SFUByte * const llTable, LookupTable *tablePtr, Sub
         printf("\n     Offset: %d", offset);
 #endif
         
+        //Extension subtables are replaced with the subtables they point to.
         tmpLookup = lookupType;
-        subtables[i] = (*func)(&llTable[offset], &tmpLookup);
+        SFClearGlyphDigest(&subtableDigests[i]);
+        
+        subtables[i] = (*func)(&llTable[offset], &tmpLookup, &subtableDigests[i], arena);
+        SFMergeGlyphDigest(&tablePtr->digest, &subtableDigests[i]);
     }
     
     tablePtr->lookupType = tmpLookup;
+    tablePtr->subtableDigests = subtableDigests;
+    SFAtomicStorePointer(&tablePtr->subtables, subtables);
+}
+
+void SFReadLookupTable(const SFUByte * const llTable, LookupTable *tablePtr, SubtableFunction func, SFArena *arena) {
+    LookupType lookupType;
+    LookupFlag lookupFlag;
+    SFUShort subTableCount;
+    
+    lookupType = SFReadUShort(llTable, 0);
+    lookupFlag = SFReadUShort(llTable, 2);
+    subTableCount = SFReadUShort(llTable, 4);
+    
+    tablePtr->lookupType = lookupType;
     tablePtr->lookupFlag = lookupFlag;
+    tablePtr->subTableCount = subTableCount;
+    tablePtr->subtables = NULL;
+    tablePtr->subtableDigests = NULL;
+    SFClearGlyphDigest(&tablePtr->digest);
+    
+#ifdef LOOKUP_TEST
+    printf("\n    Lookup Type: %d", lookupType);
+    printf("\n    Lookup Flag: %d", lookupFlag);
+    printf("\n    Total Subtables: %d", subTableCount);
+#endif
     
-    tablePtr->subtables = subtables;
+#ifdef SF_LAZY_LOOKUPS
+    tablePtr->lookupData = llTable;
+#else
+    SFReadLookupSubtables(llTable, tablePtr, func, arena);
+#endif
     
-    if ((lookupFlag >> 4) == 1)
-        tablePtr->markFilteringSet = SFReadUShort(llTable, offset + 2);
-    else
+    //The mark filtering set follows the array of subtable offsets.
+    if (lookupFlag & lfUseMarkFilteringSet) {
+        tablePtr->markFilteringSet = SFReadUShort(llTable, 6 + (subTableCount * 2));
+        tablePtr->lookupFlag = (LookupFlag)(lookupFlag | ((SFUInt)tablePtr->markFilteringSet << SF_MARK_FILTERING_SET_SHIFT));
+    } else {
         tablePtr->markFilteringSet = 0;
+    }
     
 #ifdef LOOKUP_TEST
     printf("\n    Mark Filtering Set: %d", tablePtr->markFilteringSet);
 #endif
 }
 
-void SFFreeLookupTable(LookupTable *tablePtr, FreeSubtableFunction func) {
-	int i;
-    for (i = 0; i < tablePtr->subTableCount; i++)
-        (*func)(tablePtr->subtables[i], tablePtr->lookupType);
+#ifdef SF_LAZY_LOOKUPS
+
+void SFLoadLookupTable(LookupListTable *listPtr, LookupTable *tablePtr, SubtableFunction func, SFArena *arena) {
+    //The subtables are published after they are completely read, so only the first use
+    //of a lookup has to take the lock.
+    if (SFAtomicLoadPointer(&tablePtr->subtables))
+        return;
+    
+    SFArenaLock(arena);
+    
+    if (!tablePtr->subtables) {
+        size_t usedSize = SFArenaGetUsedSize(arena);
+        
+        SFReadLookupSubtables(tablePtr->lookupData, tablePtr, func, arena);
+        listPtr->loadedSize += SFArenaGetUsedSize(arena) - usedSize;
+    }
+    
+    SFArenaUnlock(arena);
+}
+
+#endif
+
+
+static void SFReadLookupRange(const SFUByte * const llTable, LookupTable *lookupTables, SFUShort start, SFUShort end, SubtableFunction func, SFArena *arena) {
+    SFUShort i;
+    
+    for (i = start; i < end; i++) {
+        SFUShort offset = SFReadUShort(llTable, 2 + (i * 2));
+        
+#ifdef LOOKUP_TEST
+        printf("\n  Lookup Table At Index %d:", i);
+        printf("\n   Offset: %d", offset);
+#endif
+        
+        SFReadLookupTable(&llTable[offset], &lookupTables[i], func, arena);
+    }
+}
+
+#ifdef SF_PARALLEL_TABLES
+
+#define SF_LOOKUP_WORKER_COUNT          4
+#define SF_LOOKUP_WORKER_MIN_LOOKUPS    16
+
+typedef struct SFLookupRange {
+    const SFUByte *llTable;
+    LookupTable *lookupTables;
+    SFUShort start;
+    SFUShort end;
+    SubtableFunction func;
+    SFArena arena;
+} SFLookupRange;
+
+static void *SFReadLookupRangeTask(void *param) {
+    SFLookupRange *range = param;
+    SFReadLookupRange(range->llTable, range->lookupTables, range->start, range->end, range->func, &range->arena);
+    
+    return NULL;
+}
+
+//Splits the lookups among worker threads, each reading into an arena of its own. The arenas
+//are merged in the order of the lookups, so the layout of the memory does not depend on
+//the order in which the workers finish.
+static SFBool SFReadLookupRangesInParallel(const SFUByte * const llTable, LookupTable *lookupTables, SFUShort lookupCount, SubtableFunction func, SFArena *arena) {
+    SFLookupRange ranges[SF_LOOKUP_WORKER_COUNT];
+    pthread_t threads[SF_LOOKUP_WORKER_COUNT];
+    SFBool started[SF_LOOKUP_WORKER_COUNT];
+    int workerCount;
+    int i;
+    
+    workerCount = lookupCount / SF_LOOKUP_WORKER_MIN_LOOKUPS;
+    if (workerCount > SF_LOOKUP_WORKER_COUNT)
+        workerCount = SF_LOOKUP_WORKER_COUNT;
+    
+    if (workerCount < 2)
+        return SFFalse;
+    
+    for (i = 0; i < workerCount; i++) {
+        ranges[i].llTable = llTable;
+        ranges[i].lookupTables = lookupTables;
+        ranges[i].start = (SFUShort)((lookupCount * i) / workerCount);
+        ranges[i].end = (SFUShort)((lookupCount * (i + 1)) / workerCount);
+        ranges[i].func = func;
+        SFArenaInitialize(&ranges[i].arena);
+    }
     
-    free(tablePtr->subtables);
+    //The first range is read by the calling thread.
+    for (i = 1; i < workerCount; i++)
+        started[i] = (pthread_create(&threads[i], NULL, &SFReadLookupRangeTask, &ranges[i]) == 0);
+    
+    SFReadLookupRangeTask(&ranges[0]);
+    
+    for (i = 1; i < workerCount; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            SFReadLookupRangeTask(&ranges[i]);
+    }
+    
+    for (i = 0; i < workerCount; i++)
+        SFArenaMerge(arena, &ranges[i].arena);
+    
+    return SFTrue;
 }
 
+#endif
 
-void SFReadLookupListTable(const SFUByte * const llTable, LookupListTable *tablePtr, SubtableFunction func) {
+void SFReadLookupListTable(const SFUByte * const llTable, LookupListTable *tablePtr, SubtableFunction func, SFArena *arena) {
     LookupTable *lookupTables;
-    SFUShort i = 0;
     
     tablePtr->lookupCount = SFReadUShort(llTable, 0);
     
@@ -327,31 +473,90 @@ void SFReadLookupListTable(const SFUByte * const llTable, LookupListTable *table
     printf("\n  Total Lookup Tables: %d", tablePtr->lookupCount);
 #endif
     
-    lookupTables = malloc(sizeof(LookupTable) * tablePtr->lookupCount);
+    lookupTables = SFArenaAllocate(arena, sizeof(LookupTable) * tablePtr->lookupCount);
     
-    for (i = 0; i < tablePtr->lookupCount; i++) {
-        SFUShort offset = SFReadUShort(llTable, 2 + (i * 2));
-        
-#ifdef LOOKUP_TEST
-        printf("\n  Lookup Table At Index %d:", i);
-        printf("\n   Offset: %d", offset);
+#ifdef SF_LAZY_LOOKUPS
+    tablePtr->loadedSize = 0;
 #endif
-        
-        SFReadLookupTable(&llTable[offset], &lookupTables[i], func);
-    }
+    
+#ifdef SF_PARALLEL_TABLES
+    if (!SFReadLookupRangesInParallel(llTable, lookupTables, tablePtr->lookupCount, func, arena))
+#endif
+        SFReadLookupRange(llTable, lookupTables, 0, tablePtr->lookupCount, func, arena);
     
     tablePtr->lookupTables = lookupTables;
 }
 
-void SFFreeLookupListTable(LookupListTable *tablePtr, FreeSubtableFunction func) {
-	int i;
-    for (i = 0; i < tablePtr->lookupCount; i++)
-        SFFreeLookupTable(&tablePtr->lookupTables[i], func);
+#define SF_CLASS_BYTES_MAX_SPREAD       8
+
+//Copies the classes into bytes, which are indexed directly, and checks whether the ranges of
+//format 2 can be searched. The ranges are only expanded when they are sorted and do not
+//leave too many glyphs out.
+static void SFPrepareClassDefTable(ClassDefTable *tablePtr, SFArena *arena) {
+    SFUShort i;
     
-    free(tablePtr->lookupTables);
+    tablePtr->firstGlyph = 0;
+    tablePtr->byteCount = 0;
+    tablePtr->classBytes = NULL;
+    tablePtr->isSorted = SFFalse;
+    
+    if (tablePtr->classFormat == 1) {
+        SFUShort glyphCount = tablePtr->format.format1.glyphCount;
+        
+        for (i = 0; i < glyphCount; i++) {
+            if (SFUShortArrayGet(tablePtr->format.format1.classValueArray, i) > 0xFF)
+                return;
+        }
+        
+        tablePtr->firstGlyph = tablePtr->format.format1.startGlyph;
+        tablePtr->byteCount = glyphCount;
+        tablePtr->classBytes = SFArenaAllocate(arena, glyphCount ? glyphCount : 1);
+        
+        for (i = 0; i < glyphCount; i++)
+            tablePtr->classBytes[i] = (SFUByte)SFUShortArrayGet(tablePtr->format.format1.classValueArray, i);
+    } else if (tablePtr->classFormat == 2) {
+        SFUShort classRangeCount = tablePtr->format.format2.classRangeCount;
+        SFUShortArray classRangeRecord = tablePtr->format.format2.classRangeRecord;
+        
+        SFUInt classifiedCount = 0;
+        SFUInt glyphSpan;
+        SFBool fitsBytes = SFTrue;
+        
+        tablePtr->isSorted = SFTrue;
+        
+        for (i = 0; i < classRangeCount && tablePtr->isSorted; i++) {
+            SFGlyph start = SFGetRangeStart(classRangeRecord, i);
+            SFGlyph end = SFGetRangeEnd(classRangeRecord, i);
+            
+            tablePtr->isSorted = (start <= end && (i == 0 || SFGetRangeEnd(classRangeRecord, i - 1) < start));
+            fitsBytes = (fitsBytes && SFGetRangeValue(classRangeRecord, i) < SF_NO_CLASS_BYTE);
+            
+            classifiedCount += end - start + 1;
+        }
+        
+        if (!tablePtr->isSorted || !fitsBytes || !classRangeCount)
+            return;
+        
+        glyphSpan = (SFUInt)SFGetRangeEnd(classRangeRecord, classRangeCount - 1) - SFGetRangeStart(classRangeRecord, 0) + 1;
+        if (glyphSpan > 0xFFFF || glyphSpan > classifiedCount * SF_CLASS_BYTES_MAX_SPREAD)
+            return;
+        
+        tablePtr->firstGlyph = SFGetRangeStart(classRangeRecord, 0);
+        tablePtr->byteCount = glyphSpan;
+        tablePtr->classBytes = SFArenaAllocate(arena, glyphSpan);
+        memset(tablePtr->classBytes, SF_NO_CLASS_BYTE, glyphSpan);
+        
+        for (i = 0; i < classRangeCount; i++) {
+            SFUInt offset = SFGetRangeStart(classRangeRecord, i) - tablePtr->firstGlyph;
+            SFUInt last = SFGetRangeEnd(classRangeRecord, i) - tablePtr->firstGlyph;
+            
+            for (; offset <= last; offset++)
+                tablePtr->classBytes[offset] = (SFUByte)SFGetRangeValue(classRangeRecord, i);
+        }
+    }
 }
 
-void SFReadClassDefTable(const SFUByte * const cdTable, ClassDefTable *tablePtr) {
+void SFReadClassDefTable(const SFUByte * const cdTable, ClassDefTable *tablePtr, SFArena *arena) {
     SFUShort format = SFReadUShort(cdTable, 0);
     tablePtr->classFormat = format;
     
@@ -363,9 +568,10 @@ void SFReadClassDefTable(const SFUByte * const cdTable, ClassDefTable *tablePtr)
         case 1:
         {
             SFUShort glyphCount;
-            SFUShort *classValueArray;
             
+#ifdef LOOKUP_TEST
 			SFUShort i;
+#endif
 
             tablePtr->format.format1.startGlyph = SFReadUShort(cdTable, 2);
             
@@ -380,24 +586,21 @@ void SFReadClassDefTable(const SFUByte * const cdTable, ClassDefTable *tablePtr)
             printf("\n         Total Class Values: %d", glyphCount);
 #endif
             
-            classValueArray = malloc(sizeof(SFUShort) * glyphCount);
-            for (i = 0; i < glyphCount; i++) {
-                classValueArray[i] = SFReadUShort(cdTable, 6 + (i * 2));
-                
+            tablePtr->format.format1.classValueArray = SFReadUShortArray(cdTable, 6, glyphCount, arena);
+            
 #ifdef LOOKUP_TEST
-                printf("\n         Class Value At Index %d: %d",i , glyphCount);
+            for (i = 0; i < glyphCount; i++)
+                printf("\n         Class Value At Index %d: %d", i, SFUShortArrayGet(tablePtr->format.format1.classValueArray, i));
 #endif
-            }
-            
-            tablePtr->format.format1.classValueArray = classValueArray;
         }
             break;
         case 2:
         {
             SFUShort classRangeCount;
-            ClassRangeRecord *classRangeRecords;
             
+#ifdef LOOKUP_TEST
             SFUShort i;
+#endif
             
             classRangeCount = SFReadUShort(cdTable, 2);
             tablePtr->format.format2.classRangeCount = classRangeCount;
@@ -406,43 +609,151 @@ void SFReadClassDefTable(const SFUByte * const cdTable, ClassDefTable *tablePtr)
             printf("\n         Total Class Ranges: %d", classRangeCount);
 #endif
             
-            classRangeRecords = malloc(sizeof(ClassRangeRecord) * classRangeCount);
+            tablePtr->format.format2.classRangeRecord = SFReadUShortArray(cdTable, 4, (SFUInt)classRangeCount * 3, arena);
             
-            for (i = 0; i < classRangeCount; i++) {
-                SFUShort offset = 4 + (i * 6);
-                
-                classRangeRecords[i].start = SFReadUShort(cdTable, offset);
-                classRangeRecords[i].end = SFReadUShort(cdTable, offset + 2);
-                classRangeRecords[i].cls = SFReadUShort(cdTable, offset + 4);
-                
 #ifdef LOOKUP_TEST
+            for (i = 0; i < classRangeCount; i++) {
                 printf("\n         Class At Index %d:", i);
-                printf("\n          Start Glyph: %d", classRangeRecords[i].start);
-                printf("\n          End Glyph: %d", classRangeRecords[i].end);
-                printf("\n          Class: %d", classRangeRecords[i].cls);
-#endif
+                printf("\n          Start Glyph: %d", SFGetRangeStart(tablePtr->format.format2.classRangeRecord, i));
+                printf("\n          End Glyph: %d", SFGetRangeEnd(tablePtr->format.format2.classRangeRecord, i));
+                printf("\n          Class: %d", SFGetRangeValue(tablePtr->format.format2.classRangeRecord, i));
             }
-            
-            tablePtr->format.format2.classRangeRecord = classRangeRecords;
+#endif
         }
             break;
     }
+    
+    SFPrepareClassDefTable(tablePtr, arena);
 }
 
-void SFFreeClassDefTable(ClassDefTable *tablePtr) {
-    switch (tablePtr->classFormat) {
-        case 1:
-            free(tablePtr->format.format1.classValueArray);
-            break;
-            
-        case 2:
-            free(tablePtr->format.format2.classRangeRecord);
-            break;
+
+#ifdef SF_COVERAGE_BITMAPS
+
+#define SF_COVERAGE_BITMAP_MIN_GLYPHS   32
+#define SF_COVERAGE_BITMAP_MAX_SPREAD   8
+
+static void SFSetCoverageBits(CoverageTable *tablePtr, SFGlyph start, SFGlyph end) {
+    SFUInt offset = start - tablePtr->firstGlyph;
+    SFUInt last = end - tablePtr->firstGlyph;
+    
+    for (; offset <= last; offset++)
+        tablePtr->bitmap[offset / 32] |= (SFUInt)1 << (offset % 32);
+}
+
+static int SFCountBits(SFUInt bits) {
+#ifdef __GNUC__
+    return __builtin_popcount(bits);
+#else
+    bits = bits - ((bits >> 1) & 0x55555555);
+    bits = (bits & 0x33333333) + ((bits >> 2) & 0x33333333);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F;
+    
+    return (bits * 0x01010101) >> 24;
+#endif
+}
+
+//The bitmap is only made for tables that cover enough glyphs close to each other, and whose
+//coverage indices follow the order of the glyphs, as all well formed tables do.
+static void SFMakeCoverageBitmap(CoverageTable *tablePtr, SFGlyph firstGlyph, SFGlyph lastGlyph, SFUInt coveredCount, SFArena *arena) {
+    SFUInt glyphSpan = (SFUInt)lastGlyph - firstGlyph + 1;
+    SFUShort count;
+    SFUShort i;
+    
+    if (coveredCount < SF_COVERAGE_BITMAP_MIN_GLYPHS || coveredCount > 0xFFFF
+        || glyphSpan > coveredCount * SF_COVERAGE_BITMAP_MAX_SPREAD)
+        return;
+    
+    tablePtr->firstGlyph = firstGlyph;
+    tablePtr->wordCount = (glyphSpan + 31) / 32;
+    
+    tablePtr->bitmap = SFArenaAllocate(arena, sizeof(SFUInt) * tablePtr->wordCount);
+    tablePtr->wordRanks = SFArenaAllocate(arena, sizeof(SFUShort) * tablePtr->wordCount);
+    memset(tablePtr->bitmap, 0, sizeof(SFUInt) * tablePtr->wordCount);
+    
+    if (tablePtr->coverageFormat == 1) {
+        count = tablePtr->format.format1.glyphCount;
+        
+        for (i = 0; i < count; i++) {
+            SFGlyph glyph = SFUShortArrayGet(tablePtr->format.format1.glyphArray, i);
+            SFSetCoverageBits(tablePtr, glyph, glyph);
+        }
+    } else {
+        count = tablePtr->format.format2.rangeCount;
+        
+        for (i = 0; i < count; i++)
+            SFSetCoverageBits(tablePtr, SFGetRangeStart(tablePtr->format.format2.rangeRecord, i), SFGetRangeEnd(tablePtr->format.format2.rangeRecord, i));
+    }
+    
+    coveredCount = 0;
+    
+    for (i = 0; i < tablePtr->wordCount; i++) {
+        tablePtr->wordRanks[i] = coveredCount;
+        coveredCount += SFCountBits(tablePtr->bitmap[i]);
     }
 }
 
+#endif
 
-void SFReadCoverageTable(const SFUByte * const cTable, CoverageTable *tablePtr) {
+//Checks whether the glyphs of the table can be searched, and makes a bitmap of them when
+//it pays off.
+static void SFPrepareCoverageTable(CoverageTable *tablePtr, SFArena *arena) {
+    SFUInt coveredCount = 0;
+    SFBool isSorted = SFTrue;
+    SFBool isConsecutive = SFTrue;
+    
+    SFUShort count = 0;
+    SFUShort i;
+    
+#ifdef SF_COVERAGE_BITMAPS
+    tablePtr->wordCount = 0;
+    tablePtr->bitmap = NULL;
+    tablePtr->wordRanks = NULL;
+#endif
+    
+    if (tablePtr->coverageFormat == 1) {
+        count = tablePtr->format.format1.glyphCount;
+        
+        for (i = 1; i < count && isSorted; i++)
+            isSorted = (SFUShortArrayGet(tablePtr->format.format1.glyphArray, i - 1) < SFUShortArrayGet(tablePtr->format.format1.glyphArray, i));
+        
+        coveredCount = count;
+    } else if (tablePtr->coverageFormat == 2) {
+        count = tablePtr->format.format2.rangeCount;
+        
+        for (i = 0; i < count && isSorted; i++) {
+            SFGlyph start = SFGetRangeStart(tablePtr->format.format2.rangeRecord, i);
+            SFGlyph end = SFGetRangeEnd(tablePtr->format.format2.rangeRecord, i);
+            
+            isSorted = (start <= end && (i == 0 || SFGetRangeEnd(tablePtr->format.format2.rangeRecord, i - 1) < start));
+            isConsecutive = (isConsecutive && SFGetRangeValue(tablePtr->format.format2.rangeRecord, i) == coveredCount);
+            
+            coveredCount += end - start + 1;
+        }
+    } else {
+        isSorted = SFFalse;
+    }
+    
+    tablePtr->isSorted = isSorted;
+    
+#ifdef SF_COVERAGE_BITMAPS
+    if (isSorted && isConsecutive && count) {
+        SFGlyph firstGlyph;
+        SFGlyph lastGlyph;
+        
+        if (tablePtr->coverageFormat == 1) {
+            firstGlyph = SFUShortArrayGet(tablePtr->format.format1.glyphArray, 0);
+            lastGlyph = SFUShortArrayGet(tablePtr->format.format1.glyphArray, count - 1);
+        } else {
+            firstGlyph = SFGetRangeStart(tablePtr->format.format2.rangeRecord, 0);
+            lastGlyph = SFGetRangeEnd(tablePtr->format.format2.rangeRecord, count - 1);
+        }
+        
+        SFMakeCoverageBitmap(tablePtr, firstGlyph, lastGlyph, coveredCount, arena);
+    }
+#endif
+}
+
+void SFReadCoverageTable(const SFUByte * const cTable, CoverageTable *tablePtr, SFArena *arena) {
     SFUShort coverageFormat;
     SFUShort count;
     
@@ -458,8 +769,9 @@ void SFReadCoverageTable(const SFUByte * const cTable, CoverageTable *tablePtr)
     switch (coverageFormat) {
         case 1:
         {
-            SFGlyph *glyphs;
+#ifdef LOOKUP_TEST
             SFUShort glyphIndex;
+#endif
             
             tablePtr->format.format1.glyphCount = count;
             
@@ -467,23 +779,20 @@ void SFReadCoverageTable(const SFUByte * const cTable, CoverageTable *tablePtr)
             printf("\n        Total Glyphs: %d", count);
 #endif
             
-            glyphs = malloc(2 * count);
-            for (glyphIndex = 0; glyphIndex < count; glyphIndex++) {
-                glyphs[glyphIndex] = SFReadUShort(cTable, 4 + (glyphIndex * 2));
-                
+            tablePtr->format.format1.glyphArray = SFReadUShortArray(cTable, 4, count, arena);
+            
 #ifdef LOOKUP_TEST
-                printf("\n        Glyph At Index %d: %d", glyphIndex, glyphs[glyphIndex]);
+            for (glyphIndex = 0; glyphIndex < count; glyphIndex++)
+                printf("\n        Glyph At Index %d: %d", glyphIndex, SFUShortArrayGet(tablePtr->format.format1.glyphArray, glyphIndex));
 #endif
-            }
-            
-            tablePtr->format.format1.glyphArray = glyphs;
         }
             break;
             
         case 2:
         {
-            RangeRecord *rangeRecords;
+#ifdef LOOKUP_TEST
             SFUShort recordIndex;
+#endif
             
             tablePtr->format.format2.rangeCount = count;
             
@@ -491,39 +800,21 @@ void SFReadCoverageTable(const SFUByte * const cTable, CoverageTable *tablePtr)
             printf("\n        Total Ranges: %d", count);
 #endif
             
-            rangeRecords = malloc(sizeof(RangeRecord) * count);
+            tablePtr->format.format2.rangeRecord = SFReadUShortArray(cTable, 4, (SFUInt)count * 3, arena);
             
-            for (recordIndex = 0; recordIndex < count; recordIndex++) {
-                SFUShort offset = 4 + (recordIndex * 6);
-                
-                rangeRecords[recordIndex].start = SFReadUShort(cTable, 0 + offset);
-                rangeRecords[recordIndex].end = SFReadUShort(cTable, 2 + offset);
-                rangeRecords[recordIndex].startCoverageIndex = SFReadUShort(cTable, 4 + offset);
-                
 #ifdef LOOKUP_TEST
+            for (recordIndex = 0; recordIndex < count; recordIndex++) {
                 printf("\n         Range Record At Index %d:", recordIndex);
-                printf("\n          Start: %d", rangeRecords[recordIndex].start);
-                printf("\n          End: %d", rangeRecords[recordIndex].end);
-                printf("\n          Start Coverage Index: %d", rangeRecords[recordIndex].startCoverageIndex);
-#endif
+                printf("\n          Start: %d", SFGetRangeStart(tablePtr->format.format2.rangeRecord, recordIndex));
+                printf("\n          End: %d", SFGetRangeEnd(tablePtr->format.format2.rangeRecord, recordIndex));
+                printf("\n          Start Coverage Index: %d", SFGetRangeValue(tablePtr->format.format2.rangeRecord, recordIndex));
             }
-            
-            tablePtr->format.format2.rangeRecord = rangeRecords;
+#endif
         }
             break;
     }
-}
-
-void SFFreeCoverageTable(CoverageTable *tablePtr) {
-    switch (tablePtr->coverageFormat) {
-        case 1:
-            free(tablePtr->format.format1.glyphArray);
-            break;
-            
-        case 2:
-            free(tablePtr->format.format2.rangeRecord);
-            break;
-    }
+    
+    SFPrepareCoverageTable(tablePtr, arena);
 }
 
 
@@ -545,9 +836,70 @@ int SFGetIndexOfGlyphInCoverage(CoverageTable *tablePtr, SFGlyph glyph) {
     int index = UNDEFINED_INDEX;
 	int j;
     
+#ifdef SF_COVERAGE_BITMAPS
+    if (tablePtr->wordCount) {
+        SFUInt offset = glyph - tablePtr->firstGlyph;
+        SFUInt bits;
+        SFUInt mask;
+        
+        if (glyph < tablePtr->firstGlyph || offset / 32 >= tablePtr->wordCount)
+            return UNDEFINED_INDEX;
+        
+        bits = tablePtr->bitmap[offset / 32];
+        mask = (SFUInt)1 << (offset % 32);
+        
+        if (!(bits & mask))
+            return UNDEFINED_INDEX;
+        
+        return tablePtr->wordRanks[offset / 32] + SFCountBits(bits & (mask - 1));
+    }
+#endif
+    
+    if (tablePtr->isSorted) {
+        int low = 0;
+        int high;
+        
+        if (tablePtr->coverageFormat == 1) {
+            high = tablePtr->format.format1.glyphCount;
+            
+            while (low < high) {
+                SFGlyph inputGlyph;
+                
+                j = (low + high) / 2;
+                inputGlyph = SFUShortArrayGet(tablePtr->format.format1.glyphArray, j);
+                
+                if (inputGlyph < glyph)
+                    low = j + 1;
+                else if (inputGlyph > glyph)
+                    high = j;
+                else
+                    return j;
+            }
+        } else {
+            high = tablePtr->format.format2.rangeCount;
+            
+            while (low < high) {
+                SFGlyph start;
+                
+                j = (low + high) / 2;
+                start = SFGetRangeStart(tablePtr->format.format2.rangeRecord, j);
+                
+                if (glyph < start)
+                    high = j;
+                else if (glyph > SFGetRangeEnd(tablePtr->format.format2.rangeRecord, j))
+                    low = j + 1;
+                else
+                    return SFGetRangeValue(tablePtr->format.format2.rangeRecord, j) + glyph - start;
+            }
+        }
+        
+        return UNDEFINED_INDEX;
+    }
+    
+    //Tables that are not sorted are walked through.
     if (tablePtr->coverageFormat == 1) {
         for (j = 0; j < tablePtr->format.format1.glyphCount; j++) {
-            SFGlyph inputGlyph = tablePtr->format.format1.glyphArray[j];
+            SFGlyph inputGlyph = SFUShortArrayGet(tablePtr->format.format1.glyphArray, j);
             
             if (inputGlyph == glyph) {
                 index = j;
@@ -556,10 +908,10 @@ int SFGetIndexOfGlyphInCoverage(CoverageTable *tablePtr, SFGlyph glyph) {
         }
     } else if (tablePtr->coverageFormat == 2) {
         for (j = 0; j < tablePtr->format.format2.rangeCount; j++) {
-            RangeRecord record = tablePtr->format.format2.rangeRecord[j];
+            SFGlyph start = SFGetRangeStart(tablePtr->format.format2.rangeRecord, j);
             
-            if (glyph >= record.start && glyph <= record.end) {
-                index = record.startCoverageIndex + glyph - record.start;
+            if (glyph >= start && glyph <= SFGetRangeEnd(tablePtr->format.format2.rangeRecord, j)) {
+                index = SFGetRangeValue(tablePtr->format.format2.rangeRecord, j) + glyph - start;
                 break;
             }
         }
@@ -567,3 +919,115 @@ int SFGetIndexOfGlyphInCoverage(CoverageTable *tablePtr, SFGlyph glyph) {
     
     return index;
 }
+
+int SFGetClassOfGlyph(ClassDefTable *tablePtr, SFGlyph glyph) {
+    if (tablePtr->classBytes) {
+        SFUShort offset = glyph - tablePtr->firstGlyph;
+        SFUByte classByte;
+        
+        if (glyph < tablePtr->firstGlyph || offset >= tablePtr->byteCount)
+            return UNDEFINED_INDEX;
+        
+        classByte = tablePtr->classBytes[offset];
+        if (tablePtr->classFormat == 2 && classByte == SF_NO_CLASS_BYTE)
+            return UNDEFINED_INDEX;
+        
+        return classByte;
+    }
+    
+    if (tablePtr->classFormat == 1) {
+        SFUShort offset = glyph - tablePtr->format.format1.startGlyph;
+        
+        if (glyph < tablePtr->format.format1.startGlyph || offset >= tablePtr->format.format1.glyphCount)
+            return UNDEFINED_INDEX;
+        
+        return SFUShortArrayGet(tablePtr->format.format1.classValueArray, offset);
+    }
+    
+    if (tablePtr->classFormat == 2) {
+        SFUShort classRangeCount = tablePtr->format.format2.classRangeCount;
+        int low = 0;
+        int high = classRangeCount;
+        int i;
+        
+        if (tablePtr->isSorted) {
+            while (low < high) {
+                i = (low + high) / 2;
+                
+                if (glyph < SFGetRangeStart(tablePtr->format.format2.classRangeRecord, i))
+                    high = i;
+                else if (glyph > SFGetRangeEnd(tablePtr->format.format2.classRangeRecord, i))
+                    low = i + 1;
+                else
+                    return SFGetRangeValue(tablePtr->format.format2.classRangeRecord, i);
+            }
+        } else {
+            for (i = 0; i < classRangeCount; i++) {
+                if (glyph >= SFGetRangeStart(tablePtr->format.format2.classRangeRecord, i)
+                    && glyph <= SFGetRangeEnd(tablePtr->format.format2.classRangeRecord, i))
+                    return SFGetRangeValue(tablePtr->format.format2.classRangeRecord, i);
+            }
+        }
+    }
+    
+    return UNDEFINED_INDEX;
+}
+
+
+//Glyph ids are shifted by a different amount for each mask of a digest.
+static const int SFDigestShifts[SF_DIGEST_MASK_COUNT] = { 0, 4, 9 };
+
+void SFClearGlyphDigest(SFGlyphDigest *digest) {
+    memset(digest->masks, 0, sizeof(digest->masks));
+}
+
+void SFFillGlyphDigest(SFGlyphDigest *digest) {
+    memset(digest->masks, 0xFF, sizeof(digest->masks));
+}
+
+static void SFAddRangeToDigest(SFGlyphDigest *digest, SFGlyph start, SFGlyph end) {
+    int i;
+    
+    if (start > end)
+        return;
+    
+    for (i = 0; i < SF_DIGEST_MASK_COUNT; i++) {
+        SFUInt first = start >> SFDigestShifts[i];
+        SFUInt last = end >> SFDigestShifts[i];
+        
+        //A range wrapping around the mask sets all of its bits.
+        if (last - first >= 31) {
+            digest->masks[i] = 0xFFFFFFFF;
+            continue;
+        }
+        
+        for (; first <= last; first++)
+            digest->masks[i] |= (SFUInt)1 << (first % 32);
+    }
+}
+
+void SFAddGlyphToDigest(SFGlyphDigest *digest, SFGlyph glyph) {
+    int i;
+    
+    for (i = 0; i < SF_DIGEST_MASK_COUNT; i++)
+        digest->masks[i] |= (SFUInt)1 << ((glyph >> SFDigestShifts[i]) % 32);
+}
+
+void SFAddCoverageToDigest(SFGlyphDigest *digest, CoverageTable *tablePtr) {
+    SFUShort i;
+    
+    if (tablePtr->coverageFormat == 1) {
+        for (i = 0; i < tablePtr->format.format1.glyphCount; i++)
+            SFAddGlyphToDigest(digest, SFUShortArrayGet(tablePtr->format.format1.glyphArray, i));
+    } else if (tablePtr->coverageFormat == 2) {
+        for (i = 0; i < tablePtr->format.format2.rangeCount; i++)
+            SFAddRangeToDigest(digest, SFGetRangeStart(tablePtr->format.format2.rangeRecord, i), SFGetRangeEnd(tablePtr->format.format2.rangeRecord, i));
+    }
+}
+
+void SFMergeGlyphDigest(SFGlyphDigest *digest, const SFGlyphDigest *other) {
+    int i;
+    
+    for (i = 0; i < SF_DIGEST_MASK_COUNT; i++)
+        digest->masks[i] |= other->masks[i];
+}
@@ -19,12 +19,49 @@
 
 #include "SFConfig.h"
 #include "SFTypes.h"
+#include "SFArena.h"
 
 #define UNDEFINED_INDEX     -1
 
 SFUShort SFReadUShort(const SFUByte *base, uintptr_t offset);
 SFUInt SFReadUInt(const SFUByte *base, uintptr_t offset);
 
+//Converts count big endian values of src into dst.
+void SFDecodeUShorts(SFUShort *dst, const SFUByte *src, size_t count);
+void SFDecodeUInts(SFUInt *dst, const SFUByte *src, size_t count);
+
+#ifdef SF_TABLE_VIEWS
+
+//Big endian values pointing directly into the table data.
+typedef const SFUByte *SFUShortArray;
+
+#define SFUShortArrayGet(arr, i)        ((SFUShort)(((arr)[(i) * 2] << 8) | (arr)[(i) * 2 + 1]))
+
+typedef const SFUByte *SFUIntArray;
+
+#define SFUIntArrayGet(arr, i)          SFReadUInt(arr, (i) * 4)
+
+#else
+
+typedef SFUShort *SFUShortArray;
+
+#define SFUShortArrayGet(arr, i)        ((arr)[i])
+
+typedef SFUInt *SFUIntArray;
+
+#define SFUIntArrayGet(arr, i)          ((arr)[i])
+
+#endif
+
+SFUShortArray SFReadUShortArray(const SFUByte *base, uintptr_t offset, SFUInt count, SFArena *arena);
+SFUIntArray SFReadUIntArray(const SFUByte *base, uintptr_t offset, SFUInt count, SFArena *arena);
+
+//Range records of coverage and class definition tables are kept as triplets of
+//start glyph, end glyph and a value (start coverage index or class).
+#define SFGetRangeStart(arr, i)         SFUShortArrayGet(arr, (i) * 3)
+#define SFGetRangeEnd(arr, i)           SFUShortArrayGet(arr, (i) * 3 + 1)
+#define SFGetRangeValue(arr, i)         SFUShortArrayGet(arr, (i) * 3 + 2)
+
 /************************************SCRIPT TABLES***************************************/
 
 typedef struct LangSysTable {
@@ -33,7 +70,7 @@ typedef struct LangSysTable {
                                     //system- if no required features = 0xFFFF
     SFUShort featureCount;          //Number of FeatureIndex values for this language system-excludes
                                     //the required feature
-    SFUShort *featureIndex;         //Array of indices into the FeatureList-in arbitrary order
+    SFUShortArray featureIndex;     //Array of indices into the FeatureList-in arbitrary order
 } LangSysTable;
 
 typedef struct LangSysRecord {
@@ -66,7 +103,7 @@ typedef struct ScriptListTable {
 typedef struct FeatureTable {
     //void *FeatureParams	= NULL; (reserved for offset to FeatureParams)
     SFUShort lookupCount;           //Number of LookupList indices for this feature
-    SFUShort *lookupListIndex;      //Array of LookupList indices for this feature -zero-based
+    SFUShortArray lookupListIndex;  //Array of LookupList indices for this feature -zero-based
                                     //(first lookup is LookupListIndex = 0)
 } FeatureTable;
 
@@ -134,32 +171,56 @@ typedef enum {
                                     //If not zero, skips over all marks of attachment type different from specified.
 } LookupFlag;
 
+//The mark filtering set of a lookup is kept above the bits of its flag, so that it reaches the
+//glyph ignore check along with the flag.
+#define SF_MARK_FILTERING_SET_SHIFT         16
+
+#define SFGetMarkFilteringSetOfFlag(flag)   ((SFUShort)((SFUInt)(flag) >> SF_MARK_FILTERING_SET_SHIFT))
+
+//A digest tells quickly that two sets of glyphs have nothing in common. Every mask has a bit
+//for a different part of the glyph id, so sets sharing a glyph share a bit in all of them.
+#define SF_DIGEST_MASK_COUNT    3
+
+typedef struct SFGlyphDigest {
+    SFUInt masks[SF_DIGEST_MASK_COUNT];
+} SFGlyphDigest;
+
+#define SFDoGlyphDigestsIntersect(d1, d2)           \
+    (((d1)->masks[0] & (d2)->masks[0])              \
+     && ((d1)->masks[1] & (d2)->masks[1])           \
+     && ((d1)->masks[2] & (d2)->masks[2]))
+
 typedef struct LookupTable {
     LookupType lookupType;          //Different enumerations for GSUB and GPOS
-    LookupFlag lookupFlag;          //Lookup qualifiers
+    LookupFlag lookupFlag;          //Lookup qualifiers, along with the mark filtering set if
+                                    //UseMarkFilteringSet is set
     SFUShort subTableCount;         //Number of SubTables for this lookup
     void **subtables;               //Array of offsets to SubTables-from beginning of Lookup table
     SFUShort markFilteringSet;      //Index (base 0) into GDEF mark glyph sets structure.
                                     //This field is only present if bit UseMarkFilteringSet
                                     //of lookup flags is set.
+    SFGlyphDigest digest;           //Digest of the glyphs any of the subtables can start at
+    SFGlyphDigest *subtableDigests; //Digest of the glyphs each subtable can start at
+#ifdef SF_LAZY_LOOKUPS
+    const SFUByte *lookupData;      //Lookup table in the font data. The subtables are read
+                                    //from it when the lookup is applied for the first time
+#endif
 } LookupTable;
 
 typedef struct LookupListTable {
     SFUShort lookupCount;           //Number of lookups in this table
     LookupTable *lookupTables;      //Array of offsets to Lookup tables-from beginning of
                                     //LookupList -zero based (first lookup is Lookup index = 0)
+#ifdef SF_LAZY_LOOKUPS
+    size_t loadedSize;              //Number of bytes taken by the lookups read on first use
+#endif
 } LookupListTable;
 
-typedef void *(*SubtableFunction)(const SFUByte * const, LookupType *type);
-typedef void (*FreeSubtableFunction)(void *subtable, LookupType type);
+typedef void *(*SubtableFunction)(const SFUByte * const, LookupType *type, SFGlyphDigest *digest, SFArena *arena);
 
 /**********************************END LOOKUP TABLES*************************************/
 
-typedef struct ClassRangeRecord {
-    SFGlyph start;                  //First GlyphID in the range
-    SFGlyph end;                    //Last GlyphID in the range
-    SFUShort cls;                   //Applied to all glyphs in the range
-} ClassRangeRecord;
+#define SF_NO_CLASS_BYTE        0xFF
 
 typedef struct ClassDefTable {
     SFUShort classFormat;           //Format identifier
@@ -168,25 +229,26 @@ typedef struct ClassDefTable {
         struct {
             SFUShort startGlyph;    //First GlyphID of the ClassValueArray
             SFUShort glyphCount;    //Size of the ClassValueArray
-            SFUShort *classValueArray;
+            SFUShortArray classValueArray;
                                     //Array of Class Values-one per GlyphID
         } format1;
         
         struct {
             SFUShort classRangeCount;
                                     //Number of ClassRangeRecords
-            ClassRangeRecord *classRangeRecord;
-                                    //Array of ClassRangeRecords-ordered by Start GlyphID
+            SFUShortArray classRangeRecord;
+                                    //Array of ClassRangeRecords (Start, End, Class)-ordered
+                                    //by Start GlyphID
         } format2;
     } format;
-} ClassDefTable;
-
-typedef struct RangeRecord {
-    SFGlyph start;                  //First GlyphID in the range
-    SFGlyph end;                    //Last GlyphID in the range
     
-    SFUShort startCoverageIndex;    //Coverage Index of first GlyphID in range
-} RangeRecord;
+    SFGlyph firstGlyph;             //Glyph of the first class byte
+    SFUShort byteCount;             //Number of class bytes
+    SFUByte *classBytes;            //Class of every glyph from the first one as a byte if all of
+                                    //them fit, with SF_NO_CLASS_BYTE for the glyphs of no range
+    SFBool isSorted;                //Whether the ranges of format 2 are in increasing order, so
+                                    //that they can be searched
+} ClassDefTable;
 
 typedef struct CoverageTable {
     SFUShort coverageFormat;        //Format identifier-format = 1
@@ -194,16 +256,28 @@ typedef struct CoverageTable {
     union {
         struct {
             SFUShort  glyphCount;   //Number of glyphs in the GlyphArray
-            SFGlyph *glyphArray;    //Array of GlyphIDs-in numerical order
+            SFUShortArray glyphArray;
+                                    //Array of GlyphIDs-in numerical order
         } format1;
         
         struct {
             SFUShort	rangeCount; //Number of RangeRecords
-            RangeRecord *rangeRecord;
-                                    //Array of glyph ranges-ordered by Start GlyphID
+            SFUShortArray rangeRecord;
+                                    //Array of glyph ranges (Start, End, StartCoverageIndex)-
+                                    //ordered by Start GlyphID
         } format2;
     } format;
     
+    SFBool isSorted;                //Whether the glyphs are in increasing order, so that they
+                                    //can be searched
+    
+#ifdef SF_COVERAGE_BITMAPS
+    SFGlyph firstGlyph;             //Glyph of the first bit in the bitmap
+    SFUShort wordCount;             //Number of words in the bitmap, or zero if there is none
+    SFUInt *bitmap;                 //Bit for every glyph from the first one that is set if the
+                                    //glyph is covered
+    SFUShort *wordRanks;            //Number of covered glyphs before each word of the bitmap
+#endif
 } CoverageTable;
 
 typedef struct DeviceTable {
@@ -220,23 +294,29 @@ typedef struct DeviceTable {
 } DeviceTable;
 
 
-void SFReadScriptListTable(const SFUByte * const slTable, ScriptListTable *tablePtr);
-void SFFreeScriptListTable(ScriptListTable *tablePtr);
+void SFReadScriptListTable(const SFUByte * const slTable, ScriptListTable *tablePtr, SFArena *arena);
 
-void SFReadFeatureListTable(const SFUByte * const flTable, FeatureListTable *tablePtr);
-void SFFreeFeatureListTable(FeatureListTable *tablePtr);
+void SFReadFeatureListTable(const SFUByte * const flTable, FeatureListTable *tablePtr, SFArena *arena);
 
-void SFReadLookupListTable(const SFUByte * const llTable, LookupListTable *tablePtr, SubtableFunction func);
-void SFFreeLookupListTable(LookupListTable *tablePtr, FreeSubtableFunction func);
+void SFReadLookupListTable(const SFUByte * const llTable, LookupListTable *tablePtr, SubtableFunction func, SFArena *arena);
 
-void SFReadClassDefTable(const SFUByte * const cdTable, ClassDefTable *tablePtr);
-void SFFreeClassDefTable(ClassDefTable *tablePtr);
+#ifdef SF_LAZY_LOOKUPS
+void SFLoadLookupTable(LookupListTable *listPtr, LookupTable *tablePtr, SubtableFunction func, SFArena *arena);
+#endif
+
+void SFReadClassDefTable(const SFUByte * const cdTable, ClassDefTable *tablePtr, SFArena *arena);
 
-void SFReadCoverageTable(const SFUByte * const cTable, CoverageTable *tablePtr);
-void SFFreeCoverageTable(CoverageTable *tablePtr);
+void SFReadCoverageTable(const SFUByte * const cTable, CoverageTable *tablePtr, SFArena *arena);
 
 void SFReadDeviceTable(const SFUByte * const dTable, DeviceTable *tablePtr);
 
 int SFGetIndexOfGlyphInCoverage(CoverageTable *tablePtr, SFGlyph glyph);
+int SFGetClassOfGlyph(ClassDefTable *tablePtr, SFGlyph glyph);
+
+void SFClearGlyphDigest(SFGlyphDigest *digest);
+void SFFillGlyphDigest(SFGlyphDigest *digest);
+void SFAddGlyphToDigest(SFGlyphDigest *digest, SFGlyph glyph);
+void SFAddCoverageToDigest(SFGlyphDigest *digest, CoverageTable *tablePtr);
+void SFMergeGlyphDigest(SFGlyphDigest *digest, const SFGlyphDigest *other);
 
 #endif
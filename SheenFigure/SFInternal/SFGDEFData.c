@@ -16,12 +16,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "SFGDEFData.h"
 
 #ifdef GDEF_ATTACH_LIST
 
-static void SFReadAttachListTable(const SFUByte * const alTable, AttachListTable *tablePtr) {
+static void SFReadAttachListTable(const SFUByte * const alTable, AttachListTable *tablePtr, SFArena *arena) {
     SFUShort coverageOffset;
     SFUShort glyphCount;
     
@@ -36,7 +37,7 @@ static void SFReadAttachListTable(const SFUByte * const alTable, AttachListTable
     printf("\n   Offset: %d", coverageOffset);
 #endif
     
-    SFReadCoverageTable(&alTable[coverageOffset], &tablePtr->coverage);
+    SFReadCoverageTable(&alTable[coverageOffset], &tablePtr->coverage, arena);
     
     glyphCount = SFReadUShort(alTable, 2);
     tablePtr->glyphCount = glyphCount;
@@ -45,16 +46,17 @@ static void SFReadAttachListTable(const SFUByte * const alTable, AttachListTable
     printf("\n   Total Glyphs: %d", glyphCount);
 #endif
     
-    attachPoints = malloc(sizeof(AttachPointTable) * glyphCount);
+    attachPoints = SFArenaAllocate(arena, sizeof(AttachPointTable) * glyphCount);
     
     for (i = 0; i < glyphCount; i++) {
         SFUShort attachPointOffset;
         const SFUByte *apTable;
         
         SFUShort pointCount;
-        SFUShort *pointIndexes;
         
+#ifdef GDEF_TEST
         SFUShort j;
+#endif
         
         attachPointOffset = SFReadUShort(alTable, 4 + (i * 2));
         apTable = &alTable[attachPointOffset];
@@ -71,39 +73,23 @@ static void SFReadAttachListTable(const SFUByte * const alTable, AttachListTable
         printf("\n    Total Points: %d", pointCount);
 #endif
         
-        pointIndexes = malloc(sizeof(SFUShort) * pointCount);
+        attachPoints[i].pointIndex = SFReadUShortArray(apTable, 2, pointCount, arena);
         
-        for (j = 0; j < glyphCount; j++) {
-            pointIndexes[j] = SFReadUShort(apTable, 2 + (j * 2));
-            
 #ifdef GDEF_TEST
-            printf("\n    Point At Index %d: %d", j, pointIndexes[j]);
+        for (j = 0; j < pointCount; j++)
+            printf("\n    Point At Index %d: %d", j, SFUShortArrayGet(attachPoints[i].pointIndex, j));
 #endif
-        }
-        
-        attachPoints[i].pointIndex = pointIndexes;
     }
     
     tablePtr->attachPoint = attachPoints;
 }
 
-static void SFFreeAttachListTable(AttachListTable *tablePtr) {
-	SFUShort i;
-
-    SFFreeCoverageTable(&tablePtr->coverage);
-    
-    for (i = 0; i < tablePtr->glyphCount; i++)
-        free(tablePtr->attachPoint[i].pointIndex);
-    
-    free(tablePtr->attachPoint);
-}
-
 #endif
 
 
 #ifdef GDEF_LIG_CARET_LIST
 
-static void SFReadLigatureGlyphTable(const SFUByte * const lgTable, LigatureGlyphTable *tablePtr) {
+static void SFReadLigatureGlyphTable(const SFUByte * const lgTable, LigatureGlyphTable *tablePtr, SFArena *arena) {
     SFUShort caretCount;
     CaretValuesTable *caretValues;
     
@@ -116,7 +102,7 @@ static void SFReadLigatureGlyphTable(const SFUByte * const lgTable, LigatureGlyp
     printf("\n   Caret Count: %d", caretCount);
 #endif
     
-    caretValues = malloc(sizeof(CaretValuesTable) * caretCount);
+    caretValues = SFArenaAllocate(arena, sizeof(CaretValuesTable) * caretCount);
     
     for (i = 0; i < caretCount; i++) {
         SFUShort caretValueOffset;
@@ -186,12 +172,8 @@ static void SFReadLigatureGlyphTable(const SFUByte * const lgTable, LigatureGlyp
     tablePtr->caretValue = caretValues;
 }
 
-static void SFFreeLigatureGlyphTable(LigatureGlyphTable *tablePtr) {
-    free(tablePtr->caretValue);
-}
-
 
-static void SFReadLigatureCaretListTable(const SFUByte * const lclTable, LigatureCaretListTable *tablePtr) {
+static void SFReadLigatureCaretListTable(const SFUByte * const lclTable, LigatureCaretListTable *tablePtr, SFArena *arena) {
     SFUShort coverageOffset;
     SFUShort ligatureGlyphCount;
     LigatureGlyphTable *ligatureGlyphTables;
@@ -205,7 +187,7 @@ static void SFReadLigatureCaretListTable(const SFUByte * const lclTable, Ligatur
     printf("\n   Offset: %d", coverageOffset);
 #endif
     
-    SFReadCoverageTable(&lclTable[coverageOffset], &tablePtr->coverage);
+    SFReadCoverageTable(&lclTable[coverageOffset], &tablePtr->coverage, arena);
     
     ligatureGlyphCount = SFReadUShort(lclTable, 2);
     tablePtr->ligGlyphCount = ligatureGlyphCount;
@@ -214,7 +196,7 @@ static void SFReadLigatureCaretListTable(const SFUByte * const lclTable, Ligatur
     printf("\n  Total Ligature Glyph Tables: %d", ligatureGlyphCount);
 #endif
     
-    ligatureGlyphTables = malloc(sizeof(LigatureGlyphTable) * ligatureGlyphCount);
+    ligatureGlyphTables = SFArenaAllocate(arena, sizeof(LigatureGlyphTable) * ligatureGlyphCount);
     
     for (i = 0; i < ligatureGlyphCount; i++) {
         SFUShort ligatureGlyphOffset = SFReadUShort(lclTable, 4 + (i * 2));
@@ -224,31 +206,93 @@ static void SFReadLigatureCaretListTable(const SFUByte * const lclTable, Ligatur
         printf("\n   Offset: %d", coverageOffset);
 #endif
         
-        SFReadLigatureGlyphTable(&lclTable[ligatureGlyphOffset], &ligatureGlyphTables[i]);
+        SFReadLigatureGlyphTable(&lclTable[ligatureGlyphOffset], &ligatureGlyphTables[i], arena);
     }
     
     tablePtr->LigGlyph = ligatureGlyphTables;
 }
 
-static void SFFreeLigatureCaretListTable(LigatureCaretListTable *tablePtr) {
-	SFUShort i;
-
-    SFFreeCoverageTable(&tablePtr->coverage);
-    
-    for (i = 0; i < tablePtr->ligGlyphCount; i++)
-        SFFreeLigatureGlyphTable(&tablePtr->LigGlyph[i]);
-    
-    free(tablePtr->LigGlyph);
-}
-
 #endif
 
 
 #ifdef GDEF_MARK_GLYPH_SETS_DEF
 
-static void SFReadMarkGlyphSetsDefTable(const SFUByte * const mgsTable, MarkGlyphSetsDefTable *tablePtr) {
+static void SFSetMarkGlyphSetBits(MarkGlyphSetBits *bitsPtr, SFGlyph start, SFGlyph end) {
+    SFUInt offset = start - bitsPtr->firstGlyph;
+    SFUInt last = end - bitsPtr->firstGlyph;
+    
+    for (; offset <= last; offset++)
+        bitsPtr->words[offset / 32] |= (SFUInt)1 << (offset % 32);
+}
+
+//Compiles the glyphs of a mark set into bits, so that finding whether a glyph is in the set
+//does not depend on the format of its coverage table.
+static void SFMakeMarkGlyphSetBits(CoverageTable *coverage, MarkGlyphSetBits *bitsPtr, SFArena *arena) {
+    SFUShort count = 0;
+    SFGlyph firstGlyph = 0xFFFF;
+    SFGlyph lastGlyph = 0;
+    SFUShort i;
+    
+    bitsPtr->firstGlyph = 0;
+    bitsPtr->wordCount = 0;
+    bitsPtr->words = NULL;
+    
+    if (coverage->coverageFormat == 1) {
+        count = coverage->format.format1.glyphCount;
+        
+        for (i = 0; i < count; i++) {
+            SFGlyph glyph = SFUShortArrayGet(coverage->format.format1.glyphArray, i);
+            
+            if (glyph < firstGlyph)
+                firstGlyph = glyph;
+            if (glyph > lastGlyph)
+                lastGlyph = glyph;
+        }
+    } else if (coverage->coverageFormat == 2) {
+        count = coverage->format.format2.rangeCount;
+        
+        for (i = 0; i < count; i++) {
+            SFGlyph start = SFGetRangeStart(coverage->format.format2.rangeRecord, i);
+            SFGlyph end = SFGetRangeEnd(coverage->format.format2.rangeRecord, i);
+            
+            if (start > end)
+                continue;
+            
+            if (start < firstGlyph)
+                firstGlyph = start;
+            if (end > lastGlyph)
+                lastGlyph = end;
+        }
+    }
+    
+    if (firstGlyph > lastGlyph)
+        return;
+    
+    bitsPtr->firstGlyph = firstGlyph;
+    bitsPtr->wordCount = ((SFUInt)lastGlyph - firstGlyph + 32) / 32;
+    bitsPtr->words = SFArenaAllocate(arena, sizeof(SFUInt) * bitsPtr->wordCount);
+    memset(bitsPtr->words, 0, sizeof(SFUInt) * bitsPtr->wordCount);
+    
+    if (coverage->coverageFormat == 1) {
+        for (i = 0; i < count; i++) {
+            SFGlyph glyph = SFUShortArrayGet(coverage->format.format1.glyphArray, i);
+            SFSetMarkGlyphSetBits(bitsPtr, glyph, glyph);
+        }
+    } else {
+        for (i = 0; i < count; i++) {
+            SFGlyph start = SFGetRangeStart(coverage->format.format2.rangeRecord, i);
+            SFGlyph end = SFGetRangeEnd(coverage->format.format2.rangeRecord, i);
+            
+            if (start <= end)
+                SFSetMarkGlyphSetBits(bitsPtr, start, end);
+        }
+    }
+}
+
+static void SFReadMarkGlyphSetsDefTable(const SFUByte * const mgsTable, MarkGlyphSetsDefTable *tablePtr, SFArena *arena) {
     SFUShort markSetCount;
     CoverageTable *coverages;
+    MarkGlyphSetBits *markSetBits;
 
 	SFUShort i;
     
@@ -265,7 +309,8 @@ static void SFReadMarkGlyphSetsDefTable(const SFUByte * const mgsTable, MarkGlyp
     printf("\n  Mark Set Count: %d", markSetCount);
 #endif
     
-    coverages = malloc(sizeof(CoverageTable) * markSetCount);
+    coverages = SFArenaAllocate(arena, sizeof(CoverageTable) * markSetCount);
+    markSetBits = SFArenaAllocate(arena, sizeof(MarkGlyphSetBits) * markSetCount);
     
     for (i = 0; i < markSetCount; i++) {
         SFUShort coverageOffset = SFReadUShort(mgsTable, 4 + (i * 2));
@@ -275,24 +320,95 @@ static void SFReadMarkGlyphSetsDefTable(const SFUByte * const mgsTable, MarkGlyp
         printf("\n   Offset: %d", coverageOffset);
 #endif
         
-        SFReadCoverageTable(&mgsTable[coverageOffset], &coverages[i]);
+        SFReadCoverageTable(&mgsTable[coverageOffset], &coverages[i], arena);
+        SFMakeMarkGlyphSetBits(&coverages[i], &markSetBits[i], arena);
     }
     
     tablePtr->coverage = coverages;
+    tablePtr->markSetBits = markSetBits;
 }
 
-static void SFFreeMarkGlyphSetsDefTable(MarkGlyphSetsDefTable *tablePtr) {
-	SFUShort i;
-    for (i = 0; i < tablePtr->markSetCount; i++)
-        SFFreeCoverageTable(&tablePtr->coverage[i]);
+#endif
+
+
+#if defined(GDEF_GLYPH_CLASS_DEF) || defined(GDEF_MARK_ATTACH_CLASS_DEF)
+
+static SFUInt SFGetGlyphLimitOfClassDef(ClassDefTable *tablePtr) {
+    SFUInt limit = 0;
+    
+    if (tablePtr->classFormat == 1) {
+        if (tablePtr->format.format1.glyphCount)
+            limit = (SFUInt)tablePtr->format.format1.startGlyph + tablePtr->format.format1.glyphCount;
+    } else if (tablePtr->classFormat == 2) {
+        int i;
+        for (i = 0; i < tablePtr->format.format2.classRangeCount; i++) {
+            SFUInt end = (SFUInt)SFGetRangeEnd(tablePtr->format.format2.classRangeRecord, i) + 1;
+            if (end > limit)
+                limit = end;
+        }
+    }
     
-    free(tablePtr->coverage);
+    if (limit > 0x10000)
+        limit = 0x10000;
+    
+    return limit;
 }
 
 #endif
 
+//Looks the classes of every glyph up once while reading, so that getting the properties of a
+//glyph while shaping takes a single load.
+static void SFReadGlyphEntries(SFTableGDEF *tablePtr, SFArena *arena) {
+    SFUInt glyphCount = 0;
+    SFUInt glyph;
+    
+    tablePtr->glyphCount = 0;
+    tablePtr->glyphEntries = NULL;
+    
+#ifdef GDEF_GLYPH_CLASS_DEF
+    if (tablePtr->hasGlyphClassDef)
+        glyphCount = SFGetGlyphLimitOfClassDef(&tablePtr->glyphClassDef);
+#endif
+    
+#ifdef GDEF_MARK_ATTACH_CLASS_DEF
+    if (tablePtr->hasMarkAttachClassDef) {
+        SFUInt limit = SFGetGlyphLimitOfClassDef(&tablePtr->markAttachClassDef);
+        if (limit > glyphCount)
+            glyphCount = limit;
+    }
+#endif
+    
+    if (!glyphCount)
+        return;
+    
+    tablePtr->glyphEntries = SFArenaAllocate(arena, sizeof(SFUShort) * glyphCount);
+    tablePtr->glyphCount = glyphCount;
+    
+    for (glyph = 0; glyph < glyphCount; glyph++) {
+        SFUShort entry = 0;
+        int cls;
+        
+#ifdef GDEF_GLYPH_CLASS_DEF
+        if (tablePtr->hasGlyphClassDef) {
+            cls = SFGetClassOfGlyph(&tablePtr->glyphClassDef, glyph);
+            if (cls >= gcvBase && cls <= gcvComponent)
+                entry = cls;
+        }
+#endif
+        
+#ifdef GDEF_MARK_ATTACH_CLASS_DEF
+        if (tablePtr->hasMarkAttachClassDef) {
+            cls = SFGetClassOfGlyph(&tablePtr->markAttachClassDef, glyph);
+            if (cls > 0 && cls <= 0xFF)
+                entry |= (cls << 8);
+        }
+#endif
+        
+        tablePtr->glyphEntries[glyph] = entry;
+    }
+}
 
-void SFReadGDEF(const SFUByte * const table, SFTableGDEF *tablePtr) {
+void SFReadGDEF(const SFUByte * const table, SFTableGDEF *tablePtr, SFArena *arena) {
     SFUShort glyphClassDefOffset;
     SFUShort attachListOffset;
     SFUShort ligCaretListOffset;
@@ -316,7 +432,7 @@ void SFReadGDEF(const SFUByte * const table, SFTableGDEF *tablePtr) {
     
     tablePtr->hasGlyphClassDef = (glyphClassDefOffset > 0);
     if (tablePtr->hasGlyphClassDef)
-        SFReadClassDefTable(&table[glyphClassDefOffset], &tablePtr->glyphClassDef);
+        SFReadClassDefTable(&table[glyphClassDefOffset], &tablePtr->glyphClassDef, arena);
     
 #endif
     
@@ -332,7 +448,7 @@ void SFReadGDEF(const SFUByte * const table, SFTableGDEF *tablePtr) {
     
     tablePtr->hasAttachList = (attachListOffset > 0);
     if (tablePtr->hasAttachList)
-        SFReadAttachListTable(&table[attachListOffset], &tablePtr->attachList);
+        SFReadAttachListTable(&table[attachListOffset], &tablePtr->attachList, arena);
     
 #endif
     
@@ -348,7 +464,7 @@ void SFReadGDEF(const SFUByte * const table, SFTableGDEF *tablePtr) {
     
     tablePtr->hasLigCaretList = (ligCaretListOffset > 0);
     if (tablePtr->hasLigCaretList)
-        SFReadLigatureCaretListTable(&table[ligCaretListOffset], &tablePtr->ligCaretList);
+        SFReadLigatureCaretListTable(&table[ligCaretListOffset], &tablePtr->ligCaretList, arena);
     
 #endif
     
@@ -363,7 +479,7 @@ void SFReadGDEF(const SFUByte * const table, SFTableGDEF *tablePtr) {
     
     tablePtr->hasMarkAttachClassDef = (markAttachClassDefOffset > 0);
     if (tablePtr->hasMarkAttachClassDef)
-        SFReadClassDefTable(&table[markAttachClassDefOffset], &tablePtr->markAttachClassDef);
+        SFReadClassDefTable(&table[markAttachClassDefOffset], &tablePtr->markAttachClassDef, arena);
     
 #endif
     
@@ -381,51 +497,10 @@ void SFReadGDEF(const SFUByte * const table, SFTableGDEF *tablePtr) {
         
         tablePtr->hasMarkGlyphSetsDef = (markGlyphSetsDefOffset > 0);
         if (tablePtr->hasMarkGlyphSetsDef)
-            SFReadMarkGlyphSetsDefTable(&table[markGlyphSetsDefOffset], &tablePtr->markGlyphSetsDef);
+            SFReadMarkGlyphSetsDefTable(&table[markGlyphSetsDefOffset], &tablePtr->markGlyphSetsDef, arena);
     }
     
-#endif
-}
-
-void SFFreeGDEF(SFTableGDEF *tablePtr) {
-    
-#ifdef GDEF_GLYPH_CLASS_DEF
-    
-    if (tablePtr->hasGlyphClassDef)
-        SFFreeClassDefTable(&tablePtr->glyphClassDef);
-    
-#endif
-    
-    
-#ifdef GDEF_ATTACH_LIST
-    
-    if (tablePtr->hasAttachList)
-        SFFreeAttachListTable(&tablePtr->attachList);
-    
-#endif
-    
-    
-#ifdef GDEF_LIG_CARET_LIST
-    
-    if (tablePtr->hasLigCaretList)
-        SFFreeLigatureCaretListTable(&tablePtr->ligCaretList);
-    
-#endif
-    
-    
-#ifdef GDEF_MARK_ATTACH_CLASS_DEF
-    
-    if (tablePtr->hasMarkAttachClassDef)
-        SFFreeClassDefTable(&tablePtr->markAttachClassDef);
-    
-#endif
-    
-    
-#ifdef GDEF_MARK_GLYPH_SETS_DEF
-    
-    if (tablePtr->hasMarkGlyphSetsDef)
-        SFFreeMarkGlyphSetsDefTable(&tablePtr->markGlyphSetsDef);
-    
 #endif
     
+    SFReadGlyphEntries(tablePtr, arena);
 }
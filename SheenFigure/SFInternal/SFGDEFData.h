@@ -39,7 +39,7 @@ typedef enum {
 
 typedef struct AttachPointTable {
     SFUShort pointCount;            //Number of attachment points on this glyph
-    SFUShort *pointIndex;           //Array of contour point indices -in increasing numerical order
+    SFUShortArray pointIndex;       //Array of contour point indices -in increasing numerical order
 } AttachPointTable;
 
 typedef struct AttachListTable {
@@ -94,10 +94,18 @@ typedef struct LigatureCaretListTable {
 
 #ifdef GDEF_MARK_ATTACH_CLASS_DEF
 
+typedef struct MarkGlyphSetBits {
+    SFGlyph firstGlyph;             //Glyph of the first bit
+    SFUShort wordCount;             //Number of words in the bits
+    SFUInt *words;                  //Bit for every glyph from the first one that is set if the
+                                    //glyph is in the mark set
+} MarkGlyphSetBits;
+
 typedef struct MarkGlyphSetsDefTable {
     SFUShort markSetTableFormat;    //Format identifier == 1
     SFUShort markSetCount;          //Number of mark sets defined
     CoverageTable *coverage;        //Array of offsets to mark set coverage tables.
+    MarkGlyphSetBits *markSetBits;  //Glyphs of each mark set as bits
 } MarkGlyphSetsDefTable;
 
 #endif
@@ -152,11 +160,20 @@ typedef struct SFTableGDEF {
                                     //of GDEF header (may be NULL)
     
 #endif
+    
+    SFUInt glyphCount;              //Number of glyphs in the glyph entries
+    SFUShort *glyphEntries;         //Glyph class value of every glyph in the low byte and its mark
+                                    //attachment class in the high byte, or zero for either if
+                                    //there is none
 
 } SFTableGDEF;
 
-void SFReadGDEF(const SFUByte * const table, SFTableGDEF *tablePtr);
-void SFFreeGDEF(SFTableGDEF *tablePtr);
+#define SFGetGDEFGlyphEntry(gdef, glyph)                        \
+    ((glyph) < (gdef)->glyphCount ? (gdef)->glyphEntries[glyph] : 0)
+#define SFGetGlyphClassOfEntry(entry)       ((entry) & 0xFF)
+#define SFGetMarkAttachClassOfEntry(entry)  ((entry) >> 8)
+
+void SFReadGDEF(const SFUByte * const table, SFTableGDEF *tablePtr, SFArena *arena);
 
 
 #endif
@@ -16,92 +16,57 @@
 
 #include "SFGDEFUtilization.h"
 
-void SFAddGlyphProperties(SFInternal *internal, SFGlyphIndex index) {
-    SFGetGlyphProperties(internal, index) |= gpReceived;
-    
-    if (internal->gdef->glyphClassDef.classFormat == 1) {
-        SFGlyph startGlyph = internal->gdef->glyphClassDef.format.format1.startGlyph;
-        SFGlyph endGlyph = startGlyph + internal->gdef->glyphClassDef.format.format1.glyphCount;
-        
-        if (SFGetGlyph(internal, index) >= startGlyph && SFGetGlyph(internal, index) <= endGlyph) {
-            int cls = internal->gdef->glyphClassDef.format.format1.classValueArray[SFGetGlyph(internal, index) - startGlyph];
-            switch (cls) {
-                case gcvBase:
-                    SFGetGlyphProperties(internal, index) |= gpBase;
-                    break;
-                    
-                case gcvMark:
-                    SFGetGlyphProperties(internal, index) |= gpMark;
-                    break;
-                    
-                case gcvLigature:
-                    SFGetGlyphProperties(internal, index) |= gpLigature;
-                    break;
-                    
-                case gcvComponent:
-                    SFGetGlyphProperties(internal, index) |= gpComponent;
-                    break;
-            }
-        }
-    } else if (internal->gdef->glyphClassDef.classFormat == 2) {
-        SFUShort classRangeCount = internal->gdef->glyphClassDef.format.format2.classRangeCount;
-        SFUShort i;
+static const SFGlyphProperty SFGlyphClassProperties[] = {
+    gpNotReceived,
+    gpBase,                         //gcvBase
+    gpLigature,                     //gcvLigature
+    gpMark,                         //gcvMark
+    gpComponent,                    //gcvComponent
+};
+
+void SFAddGlyphProperties(SFInternal *internal, int index) {
+    SFUShort entry = SFGetGDEFGlyphEntry(internal->gdef, SFGetGlyph(internal, index));
+    SFGetGlyphProperties(internal, index) |= gpReceived | SFGlyphClassProperties[SFGetGlyphClassOfEntry(entry)];
+}
 
-        for (i = 0; i < classRangeCount; i++) {
-            SFGlyph startGlyph = internal->gdef->glyphClassDef.format.format2.classRangeRecord[i].start;
-            SFGlyph endGlyph = internal->gdef->glyphClassDef.format.format2.classRangeRecord[i].end;
-            
-            if (SFGetGlyph(internal, index) >= startGlyph && SFGetGlyph(internal, index) <= endGlyph) {
-                int cls = internal->gdef->glyphClassDef.format.format2.classRangeRecord[i].cls;
-                switch (cls) {
-                    case gcvBase:
-                        SFGetGlyphProperties(internal, index) |= gpBase;
-                        break;
-                        
-                    case gcvMark:
-                        SFGetGlyphProperties(internal, index) |= gpMark;
-                        break;
-                        
-                    case gcvLigature:
-                        SFGetGlyphProperties(internal, index) |= gpLigature;
-                        break;
-                        
-                    case gcvComponent:
-                        SFGetGlyphProperties(internal, index) |= gpComponent;
-                        break;
-                }
-            }
+void SFAddAllGlyphProperties(SFInternal *internal) {
+    SFGlyph *glyphs = internal->record->glyphs;
+    SFUByte *glyphProps = internal->record->glyphProps;
+    int i;
+    
+    for (i = 0; i < SFGetTotalGlyphCount(internal); i++) {
+        if (glyphProps[i] == gpNotReceived && glyphs[i]) {
+            SFUShort entry = SFGetGDEFGlyphEntry(internal->gdef, glyphs[i]);
+            glyphProps[i] = gpReceived | SFGlyphClassProperties[SFGetGlyphClassOfEntry(entry)];
         }
     }
 }
 
 SFBool SFDoesGlyphExistInGlyphClassDef(ClassDefTable *cls, GlyphClassValue clsValue, SFGlyph glyph) {
-    if (cls->classFormat == 1) {
-        SFGlyph startGlyph = cls->format.format1.startGlyph;
-        SFUShort endGlyph = startGlyph + cls->format.format1.glyphCount;
-        
-        if (glyph >= startGlyph && glyph <= endGlyph && cls->format.format1.classValueArray[glyph - startGlyph] == clsValue)
-            return SFTrue;
-
-    } else if (cls->classFormat == 2) {
-        SFUShort classRangeCount = cls->format.format2.classRangeCount;
-        SFUShort i;
+    return (SFGetClassOfGlyph(cls, glyph) == (int)clsValue);
+}
 
-        for (i = 0; i < classRangeCount; i++) {
-            if (cls->format.format2.classRangeRecord[i].cls == clsValue) {
-                SFGlyph startGlyph = cls->format.format2.classRangeRecord[i].start;
-                SFGlyph endGlyph = cls->format.format2.classRangeRecord[i].end;
-                
-                if (glyph >= startGlyph && glyph <= endGlyph)
-                    return SFTrue;
-            }
-        }
-    }
+SFBool SFIsGlyphInMarkSet(SFTableGDEF *gdef, SFUShort markSet, SFGlyph glyph) {
+#ifdef GDEF_MARK_GLYPH_SETS_DEF
+    MarkGlyphSetBits *bitsPtr;
+    SFUInt offset;
+    
+    if (!gdef->hasMarkGlyphSetsDef || markSet >= gdef->markGlyphSetsDef.markSetCount)
+        return SFFalse;
+    
+    bitsPtr = &gdef->markGlyphSetsDef.markSetBits[markSet];
+    offset = glyph - bitsPtr->firstGlyph;
     
+    if (glyph < bitsPtr->firstGlyph || offset / 32 >= bitsPtr->wordCount)
+        return SFFalse;
+    
+    return ((bitsPtr->words[offset / 32] >> (offset % 32)) & 1);
+#else
     return SFFalse;
+#endif
 }
 
-SFBool SFIsIgnoredGlyph(SFInternal *internal, SFGlyphIndex index, LookupFlag lookupFlag) {
+SFBool SFIsIgnoredGlyph(SFInternal *internal, int index, LookupFlag lookupFlag) {
     SFBool hasMarkProperty;
     
     if (!SFGetGlyph(internal, index))
@@ -121,10 +86,15 @@ SFBool SFIsIgnoredGlyph(SFInternal *internal, SFGlyphIndex index, LookupFlag loo
     if ((lookupFlag & lfIgnoreBaseGlyphs) && (SFGetGlyphProperties(internal, index) & gpBase))
         return SFTrue;
     
+    if (!hasMarkProperty)
+        return SFFalse;
+    
+    if (lookupFlag & lfUseMarkFilteringSet)
+        return !SFIsGlyphInMarkSet(internal->gdef, SFGetMarkFilteringSetOfFlag(lookupFlag), SFGetGlyph(internal, index));
+    
     if (lookupFlag & lfMarkAttachmentType) {
         if (internal->gdef->hasMarkAttachClassDef
-            && hasMarkProperty
-            && !SFDoesGlyphExistInGlyphClassDef(&internal->gdef->markAttachClassDef, lookupFlag >> 8, SFGetGlyph(internal, index)))
+            && SFGetMarkAttachClassOfEntry(SFGetGDEFGlyphEntry(internal->gdef, SFGetGlyph(internal, index))) != ((lookupFlag & lfMarkAttachmentType) >> 8))
             return SFTrue;
     }
     
@@ -19,8 +19,10 @@
 
 #include "SFInternal.h"
 
-void SFAddGlyphProperties(SFInternal *internal, SFGlyphIndex index);
+void SFAddGlyphProperties(SFInternal *internal, int index);
+void SFAddAllGlyphProperties(SFInternal *internal);
 SFBool SFDoesGlyphExistInGlyphClassDef(ClassDefTable *cls, GlyphClassValue clsValue, SFGlyph glyph);
-SFBool SFIsIgnoredGlyph(SFInternal *internal, SFGlyphIndex index, LookupFlag lookupFlag);
+SFBool SFIsGlyphInMarkSet(SFTableGDEF *gdef, SFUShort markSet, SFGlyph glyph);
+SFBool SFIsIgnoredGlyph(SFInternal *internal, int index, LookupFlag lookupFlag);
 
 #endif
\ No newline at end of file
@@ -20,8 +20,6 @@
 #include "SFGSUBGPOSData.h"
 #include "SFGPOSData.h"
 
-void **gposTable;
-
 static DeviceTable nullDevice() {
     DeviceTable device;
     device.startSize = 0;
@@ -35,7 +33,7 @@ static DeviceTable nullDevice() {
 
 #if defined(GPOS_SINGLE) || defined(GPOS_PAIR)
 
-static void SFReadValueRecord(const SFUByte * const table, SFUShort *offset, ValueRecord *tablePtr, ValueFormat format) {
+static void SFReadValueRecord(const SFUByte * const table, SFUShort *offset, const SFUByte * const subtable, ValueRecord *tablePtr, ValueFormat format) {
     DeviceTable nullDev;
     
     if (format & vfXPlacement) {
@@ -93,7 +91,7 @@ static void SFReadValueRecord(const SFUByte * const table, SFUShort *offset, Val
 #endif
         
         if (xPlaDeviceOffset)
-            SFReadDeviceTable(gposTable[xPlaDeviceOffset], &tablePtr->xPlaDevice);
+            SFReadDeviceTable(&subtable[xPlaDeviceOffset], &tablePtr->xPlaDevice);
         
         *offset += 2;
     }
@@ -107,7 +105,7 @@ static void SFReadValueRecord(const SFUByte * const table, SFUShort *offset, Val
 #endif
         
         if (yPlaDeviceOffset)
-            SFReadDeviceTable(gposTable[yPlaDeviceOffset], &tablePtr->yPlaDevice);
+            SFReadDeviceTable(&subtable[yPlaDeviceOffset], &tablePtr->yPlaDevice);
         
         *offset += 2;
     }
@@ -121,7 +119,7 @@ static void SFReadValueRecord(const SFUByte * const table, SFUShort *offset, Val
 #endif
         
         if (xAdvDeviceOffset)
-            SFReadDeviceTable(gposTable[xAdvDeviceOffset], &tablePtr->xAdvDevice);
+            SFReadDeviceTable(&subtable[xAdvDeviceOffset], &tablePtr->xAdvDevice);
         
         *offset += 2;
     }
@@ -135,7 +133,7 @@ static void SFReadValueRecord(const SFUByte * const table, SFUShort *offset, Val
 #endif
         
         if (yAdvDeviceOffset)
-            SFReadDeviceTable(gposTable[yAdvDeviceOffset], &tablePtr->yAdvDevice);
+            SFReadDeviceTable(&subtable[yAdvDeviceOffset], &tablePtr->yAdvDevice);
         
         *offset += 2;
     }
@@ -144,7 +142,7 @@ static void SFReadValueRecord(const SFUByte * const table, SFUShort *offset, Val
 
 #ifdef GPOS_SINGLE
 
-static void SFReadSingleAdjustment(const SFUByte * const saTable, SingleAdjustmentPosSubtable *tablePtr) {
+static void SFReadSingleAdjustment(const SFUByte * const saTable, SingleAdjustmentPosSubtable *tablePtr, SFArena *arena) {
     SFUShort posFormat;
     SFUShort coverageOffset;
     
@@ -160,7 +158,7 @@ static void SFReadSingleAdjustment(const SFUByte * const saTable, SingleAdjustme
     printf("\n        Offset: %d", coverageOffset);
 #endif
     
-    SFReadCoverageTable(&saTable[coverageOffset], &tablePtr->coverage);
+    SFReadCoverageTable(&saTable[coverageOffset], &tablePtr->coverage, arena);
     tablePtr->valueFormat = SFReadUShort(saTable, 4);
     
 #ifdef LOOKUP_TEST
@@ -178,7 +176,7 @@ static void SFReadSingleAdjustment(const SFUByte * const saTable, SingleAdjustme
             printf("\n       Value Record:");
 #endif
             
-            SFReadValueRecord(saTable, &valueOffset, &tablePtr->format.format1.value, tablePtr->valueFormat);
+            SFReadValueRecord(saTable, &valueOffset, saTable, &tablePtr->format.format1.value, tablePtr->valueFormat);
         }
             break;
 #endif
@@ -199,7 +197,7 @@ static void SFReadSingleAdjustment(const SFUByte * const saTable, SingleAdjustme
             printf("\n       Total Values: %d", valueCount);
 #endif
             
-            values = malloc(sizeof(ValueRecord) * valueCount);
+            values = SFArenaAllocate(arena, sizeof(ValueRecord) * valueCount);
             
             nextValueOffset = 8;
             for (i = 0; i < valueCount; i++) {
@@ -207,7 +205,7 @@ static void SFReadSingleAdjustment(const SFUByte * const saTable, SingleAdjustme
                 printf("\n       Value Record At Index %d:", i);
 #endif
                 
-                SFReadValueRecord(saTable, &nextValueOffset, &values[i], tablePtr->valueFormat);
+                SFReadValueRecord(saTable, &nextValueOffset, saTable, &values[i], tablePtr->valueFormat);
             }
             
             tablePtr->format.format2.value = values;
@@ -217,21 +215,12 @@ static void SFReadSingleAdjustment(const SFUByte * const saTable, SingleAdjustme
     }
 }
 
-static void SFFreeSingleAdjustment(SingleAdjustmentPosSubtable *tablePtr) {
-    SFFreeCoverageTable(&tablePtr->coverage);
-    
-#ifdef GPOS_SINGLE_FORMAT2
-    if (tablePtr->posFormat == 2)
-        free(tablePtr->format.format2.value);
-#endif
-}
-
 #endif
 
 
 #ifdef GPOS_PAIR
 
-static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPosSubtable *tablePtr) {
+static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPosSubtable *tablePtr, SFArena *arena) {
     SFUShort posFormat;
     SFUShort coverageOffset;
     
@@ -247,7 +236,7 @@ static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPo
     printf("\n        Offset: %d", coverageOffset);
 #endif
     
-    SFReadCoverageTable(&paTable[coverageOffset], &tablePtr->coverage);
+    SFReadCoverageTable(&paTable[coverageOffset], &tablePtr->coverage, arena);
     
     tablePtr->valueFormat1 = SFReadUShort(paTable, 4);
     tablePtr->valueFormat2 = SFReadUShort(paTable, 6);
@@ -274,7 +263,7 @@ static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPo
             printf("\n       Total Pair Sets: %d", pairSetCount);
 #endif
             
-            pairSetTables = malloc(sizeof(PairSetTable) * pairSetCount);
+            pairSetTables = SFArenaAllocate(arena, sizeof(PairSetTable) * pairSetCount);
             
             for (i = 0; i < pairSetCount; i++) {
                 SFUShort pairSetOffset;
@@ -286,7 +275,7 @@ static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPo
                 SFUShort beginOffset;
                 SFUShort j;
                 
-                pairSetOffset = SFReadUShort(paTable, 10);
+                pairSetOffset = SFReadUShort(paTable, 10 + (i * 2));
                 psTable = &paTable[pairSetOffset];
                 
 #ifdef LOOKUP_TEST
@@ -301,7 +290,7 @@ static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPo
                 printf("\n        Total Pair Values: %d", pairValueCount);
 #endif
                 
-                pairValueRecords = malloc(sizeof(PairValueRecord) * pairValueCount);
+                pairValueRecords = SFArenaAllocate(arena, sizeof(PairValueRecord) * pairValueCount);
                 
                 beginOffset = 2;
                 for (j = 0; j < pairValueCount; j++) {
@@ -314,16 +303,20 @@ static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPo
                     printf("\n         Value 1 Record:");
 #endif
                     
-                    SFReadValueRecord(psTable, &beginOffset, &pairValueRecords[j].value1, tablePtr->valueFormat1);
+                    SFReadValueRecord(psTable, &beginOffset, paTable, &pairValueRecords[j].value1, tablePtr->valueFormat1);
                     
 #ifdef LOOKUP_TEST
                     printf("\n         Value 2 Record:");
 #endif
                     
-                    SFReadValueRecord(psTable, &beginOffset, &pairValueRecords[j].value2, tablePtr->valueFormat2);
+                    SFReadValueRecord(psTable, &beginOffset, paTable, &pairValueRecords[j].value2, tablePtr->valueFormat2);
                 }
                 
                 pairSetTables[i].pairValueRecord = pairValueRecords;
+                pairSetTables[i].isSorted = SFTrue;
+                
+                for (j = 1; j < pairValueCount && pairSetTables[i].isSorted; j++)
+                    pairSetTables[i].isSorted = (pairValueRecords[j - 1].secondGlyph < pairValueRecords[j].secondGlyph);
             }
             
             tablePtr->format.format1.pairSetTable = pairSetTables;
@@ -351,7 +344,7 @@ static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPo
             printf("\n        Offset: %d", classDef1Offset);
 #endif
             
-            SFReadClassDefTable(&paTable[classDef1Offset], &tablePtr->format.format2.classDef1);
+            SFReadClassDefTable(&paTable[classDef1Offset], &tablePtr->format.format2.classDef1, arena);
             
             classDef2Offset = SFReadUShort(paTable, 10);
             
@@ -360,7 +353,7 @@ static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPo
             printf("\n        Offset: %d", classDef2Offset);
 #endif
             
-            SFReadClassDefTable(&paTable[classDef2Offset], &tablePtr->format.format2.classDef2);
+            SFReadClassDefTable(&paTable[classDef2Offset], &tablePtr->format.format2.classDef2, arena);
             
             class1Count = SFReadUShort(paTable, 12);
             class2Count = SFReadUShort(paTable, 14);
@@ -373,9 +366,35 @@ static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPo
             tablePtr->format.format2.class1Count = class1Count;
             tablePtr->format.format2.class2Count = class2Count;
             
-            class1Records = malloc(sizeof(Class1Record) * class1Count);
-            
             beginOffset = 16;
+            
+            //Horizontal values are kept in a single matrix, which is much smaller than the
+            //records and is indexed directly.
+            if (!((tablePtr->valueFormat1 | tablePtr->valueFormat2) & (vfYPlacement | vfYAdvance))) {
+                ClassPairValues *classPairValues = SFArenaAllocate(arena, sizeof(ClassPairValues) * class1Count * class2Count);
+                ValueRecord value1;
+                ValueRecord value2;
+                
+                SFUInt k;
+                
+                for (k = 0; k < (SFUInt)class1Count * class2Count; k++) {
+                    SFReadValueRecord(paTable, &beginOffset, paTable, &value1, tablePtr->valueFormat1);
+                    SFReadValueRecord(paTable, &beginOffset, paTable, &value2, tablePtr->valueFormat2);
+                    
+                    classPairValues[k].xPlacement1 = value1.xPlacement;
+                    classPairValues[k].xAdvance1 = value1.xAdvance;
+                    classPairValues[k].xPlacement2 = value2.xPlacement;
+                    classPairValues[k].xAdvance2 = value2.xAdvance;
+                }
+                
+                tablePtr->format.format2.class1Record = NULL;
+                tablePtr->format.format2.classPairValues = classPairValues;
+                
+                break;
+            }
+            
+            class1Records = SFArenaAllocate(arena, sizeof(Class1Record) * class1Count);
+            
             for (i = 0; i < class1Count; i++) {
                 Class2Record *class2Records;
                 SFUShort j;
@@ -384,7 +403,7 @@ static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPo
                 printf("\n       Class 1 Record At Index %d:", i);
 #endif
                 
-                class2Records = malloc(sizeof(Class2Record) * class2Count);
+                class2Records = SFArenaAllocate(arena, sizeof(Class2Record) * class2Count);
                 
                 for (j = 0; j < class2Count; j++) {
 #ifdef LOOKUP_TEST
@@ -392,53 +411,20 @@ static void SFReadPairAdjustment(const SFUByte * const paTable, PairAdjustmentPo
                     printf("\n         Value 1 Record:");
 #endif
                     
-                    SFReadValueRecord(paTable, &beginOffset, &class2Records[j].value1, tablePtr->valueFormat1);
+                    SFReadValueRecord(paTable, &beginOffset, paTable, &class2Records[j].value1, tablePtr->valueFormat1);
                     
 #ifdef LOOKUP_TEST
                     printf("\n         Value 2 Record:");
 #endif
                     
-                    SFReadValueRecord(paTable, &beginOffset, &class2Records[j].value2, tablePtr->valueFormat2);
+                    SFReadValueRecord(paTable, &beginOffset, paTable, &class2Records[j].value2, tablePtr->valueFormat2);
                 }
                 
                 class1Records[i].class2Record = class2Records;
             }
             
             tablePtr->format.format2.class1Record = class1Records;
-        }
-            break;
-#endif
-    }
-}
-
-static void SFFreePairAdjustment(PairAdjustmentPosSubtable *tablePtr) {
-    SFUShort i = 0;
-    
-    SFFreeCoverageTable(&tablePtr->coverage);
-    
-    switch (tablePtr->posFormat) {
-            
-#ifdef GPOS_PAIR_FORMAT1
-        case 1:
-        {
-            for (; i < tablePtr->format.format1.pairSetCount; i++)
-                free(tablePtr->format.format1.pairSetTable[i].pairValueRecord);
-            
-            free(tablePtr->format.format1.pairSetTable);
-        }
-            break;
-#endif
-            
-#ifdef GPOS_PAIR_FORMAT2
-        case 2:
-        {
-            SFFreeClassDefTable(&tablePtr->format.format2.classDef1);
-            SFFreeClassDefTable(&tablePtr->format.format2.classDef2);
-            
-            for (; i < tablePtr->format.format2.class1Count; i++)
-                free(tablePtr->format.format2.class1Record[i].class2Record);
-            
-            free(tablePtr->format.format2.class1Record);
+            tablePtr->format.format2.classPairValues = NULL;
         }
             break;
 #endif
@@ -502,7 +488,7 @@ static void SFReadAnchorTable(const SFUByte * const aTable, AnchorTable *tablePt
 
 #ifdef GPOS_CURSIVE
 
-static void SFReadCursiveAttachment(const SFUByte * const caTable, CursiveAttachmentPosSubtable *tablePtr) {
+static void SFReadCursiveAttachment(const SFUByte * const caTable, CursiveAttachmentPosSubtable *tablePtr, SFArena *arena) {
     SFUShort posFormat;
     SFUShort coverageOffset;
     
@@ -524,7 +510,7 @@ static void SFReadCursiveAttachment(const SFUByte * const caTable, CursiveAttach
     printf("\n        Offset: %d", coverageOffset);
 #endif
     
-    SFReadCoverageTable(&caTable[coverageOffset], &tablePtr->coverage);
+    SFReadCoverageTable(&caTable[coverageOffset], &tablePtr->coverage, arena);
     
     entryExitCount = SFReadUShort(caTable, 4);
     
@@ -532,7 +518,7 @@ static void SFReadCursiveAttachment(const SFUByte * const caTable, CursiveAttach
     printf("\n       Total Entry Exits: %d", entryExitCount);
 #endif
     
-    entryExitRecords = malloc(sizeof(EntryExitRecord) * entryExitCount);
+    entryExitRecords = SFArenaAllocate(arena, sizeof(EntryExitRecord) * entryExitCount);
     
     beginOffset = 6;
     for (i = 0; i < entryExitCount; i++) {
@@ -569,17 +555,12 @@ static void SFReadCursiveAttachment(const SFUByte * const caTable, CursiveAttach
     tablePtr->entryExitRecord = entryExitRecords;
 }
 
-static void SFFreeCursiveAttachment(CursiveAttachmentPosSubtable *tablePtr) {
-    SFFreeCoverageTable(&tablePtr->coverage);
-    free(tablePtr->entryExitRecord);
-}
-
 #endif
 
 
 #ifdef GPOS_MARK
 
-static void SFReadMarkArray(const SFUByte * const maTable, MarkArrayTable *tablePtr) {
+static void SFReadMarkArray(const SFUByte * const maTable, MarkArrayTable *tablePtr, SFArena *arena) {
     SFUShort markCount;
     MarkRecord *markRecords;
     SFUShort beginOffset;
@@ -593,7 +574,7 @@ static void SFReadMarkArray(const SFUByte * const maTable, MarkArrayTable *table
     printf("\n        Total Mark Records: %d", markCount);
 #endif
     
-    markRecords = malloc(sizeof(MarkRecord) * markCount);
+    markRecords = SFArenaAllocate(arena, sizeof(MarkRecord) * markCount);
     
     beginOffset = 2;
     for (i = 0; i < markCount; i++) {
@@ -622,16 +603,12 @@ static void SFReadMarkArray(const SFUByte * const maTable, MarkArrayTable *table
     tablePtr->markRecord = markRecords;
 }
 
-static void SFFreeMarkArray(MarkArrayTable *tablePtr) {
-    free(tablePtr->markRecord);
-}
-
 #endif
 
 
 #ifdef GPOS_MARK_TO_BASE
 
-static void SFReadMarkToBaseAttachment(const SFUByte * const mtbTable, MarkToBaseAttachmentPosSubtable *tablePtr) {
+static void SFReadMarkToBaseAttachment(const SFUByte * const mtbTable, MarkToBaseAttachmentPosSubtable *tablePtr, SFArena *arena) {
     SFUShort posFormat;
     SFUShort markCoverageOffset;
     SFUShort baseCoverageOffset;
@@ -660,7 +637,7 @@ static void SFReadMarkToBaseAttachment(const SFUByte * const mtbTable, MarkToBas
     printf("\n        Offset: %d", markCoverageOffset);
 #endif
     
-    SFReadCoverageTable(&mtbTable[markCoverageOffset], &tablePtr->markCoverage);
+    SFReadCoverageTable(&mtbTable[markCoverageOffset], &tablePtr->markCoverage, arena);
     
     baseCoverageOffset = SFReadUShort(mtbTable, 4);
     
@@ -669,7 +646,7 @@ static void SFReadMarkToBaseAttachment(const SFUByte * const mtbTable, MarkToBas
     printf("\n        Offset: %d", baseCoverageOffset);
 #endif
     
-    SFReadCoverageTable(&mtbTable[baseCoverageOffset], &tablePtr->baseCoverage);
+    SFReadCoverageTable(&mtbTable[baseCoverageOffset], &tablePtr->baseCoverage, arena);
     
     classCount = SFReadUShort(mtbTable, 6);
     tablePtr->classCount = classCount;
@@ -685,7 +662,7 @@ static void SFReadMarkToBaseAttachment(const SFUByte * const mtbTable, MarkToBas
     printf("\n        Offset: %d", markArrayOffset);
 #endif
     
-    SFReadMarkArray(&mtbTable[markArrayOffset], &tablePtr->markArray);
+    SFReadMarkArray(&mtbTable[markArrayOffset], &tablePtr->markArray, arena);
     
     baseArrayOffset = SFReadUShort(mtbTable, 10);
     
@@ -703,7 +680,7 @@ static void SFReadMarkToBaseAttachment(const SFUByte * const mtbTable, MarkToBas
     printf("\n        Total Base Records: %d", baseCount);
 #endif
     
-    baseRecords = malloc(sizeof(BaseRecord) * baseCount);
+    baseRecords = SFArenaAllocate(arena, sizeof(BaseRecord) * baseCount);
     
     beginOffset = 2;
     for (i = 0; i < baseCount; i++) {
@@ -715,7 +692,7 @@ static void SFReadMarkToBaseAttachment(const SFUByte * const mtbTable, MarkToBas
         printf("\n         Total Base Anchors: %d", classCount);
 #endif
         
-        baseAnchors = malloc(sizeof(AnchorTable) * classCount);
+        baseAnchors = SFArenaAllocate(arena, sizeof(AnchorTable) * classCount);
         
         for (j = 0; j < classCount; j++) {
             SFUShort baseAnchorOffset = SFReadUShort(baTable, beginOffset);
@@ -737,25 +714,12 @@ static void SFReadMarkToBaseAttachment(const SFUByte * const mtbTable, MarkToBas
     tablePtr->baseArray = baseArrayTable;
 }
 
-static void SFFreeMarkToBaseAttachment(MarkToBaseAttachmentPosSubtable *tablePtr) {
-	SFUShort i;
-
-    SFFreeCoverageTable(&tablePtr->markCoverage);
-    SFFreeCoverageTable(&tablePtr->baseCoverage);
-    SFFreeMarkArray(&tablePtr->markArray);
-    
-    for (i = 0; i < tablePtr->baseArray.baseCount; i++)
-        free(tablePtr->baseArray.baseRecord[i].baseAnchor);
-    
-    free(tablePtr->baseArray.baseRecord);
-}
-
 #endif
 
 
 #ifdef GPOS_MARK_TO_LIGATURE
 
-static void SFReadMarkToLigatureAttachment(const SFUByte * const mtlTable, MarkToLigatureAttachmentPosSubtable *tablePtr) {
+static void SFReadMarkToLigatureAttachment(const SFUByte * const mtlTable, MarkToLigatureAttachmentPosSubtable *tablePtr, SFArena *arena) {
     SFUShort posFormat;
     SFUShort markCoverageOffset;
     SFUShort ligatureCoverageOffset;
@@ -783,7 +747,7 @@ static void SFReadMarkToLigatureAttachment(const SFUByte * const mtlTable, MarkT
     printf("\n        Offset: %d", markCoverageOffset);
 #endif
     
-    SFReadCoverageTable(&mtlTable[markCoverageOffset], &tablePtr->markCoverage);
+    SFReadCoverageTable(&mtlTable[markCoverageOffset], &tablePtr->markCoverage, arena);
     
     ligatureCoverageOffset = SFReadUShort(mtlTable, 4);
     
@@ -792,7 +756,7 @@ static void SFReadMarkToLigatureAttachment(const SFUByte * const mtlTable, MarkT
     printf("\n        Offset: %d", ligatureCoverageOffset);
 #endif
     
-    SFReadCoverageTable(&mtlTable[ligatureCoverageOffset], &tablePtr->ligatureCoverage);
+    SFReadCoverageTable(&mtlTable[ligatureCoverageOffset], &tablePtr->ligatureCoverage, arena);
     
     classCount = SFReadUShort(mtlTable, 6);
     tablePtr->classCount = classCount;
@@ -808,7 +772,7 @@ static void SFReadMarkToLigatureAttachment(const SFUByte * const mtlTable, MarkT
     printf("\n        Offset: %d", markArrayOffset);
 #endif
     
-    SFReadMarkArray(&mtlTable[markArrayOffset], &tablePtr->markArray);
+    SFReadMarkArray(&mtlTable[markArrayOffset], &tablePtr->markArray, arena);
     
     ligatureArrayOffset = SFReadUShort(mtlTable, 10);
     
@@ -826,7 +790,7 @@ static void SFReadMarkToLigatureAttachment(const SFUByte * const mtlTable, MarkT
     printf("\n        Total Ligature Attach Tables: %d", ligatureCount);
 #endif
     
-    ligatureAttachTables = malloc(sizeof(LigatureAttachTable) * ligatureCount);
+    ligatureAttachTables = SFArenaAllocate(arena, sizeof(LigatureAttachTable) * ligatureCount);
     
     for (i = 0; i < ligatureCount; i++) {
         SFUShort ligatureAttachOffset;
@@ -854,7 +818,7 @@ static void SFReadMarkToLigatureAttachment(const SFUByte * const mtlTable, MarkT
         printf("\n         Total Component Records: %d", componentCount);
 #endif
         
-        componentRecords = malloc(sizeof(ComponentRecord) * componentCount);
+        componentRecords = SFArenaAllocate(arena, sizeof(ComponentRecord) * componentCount);
         
         beginOffset = 2;
         for (j = 0; j < componentCount; j++) {
@@ -866,7 +830,7 @@ static void SFReadMarkToLigatureAttachment(const SFUByte * const mtlTable, MarkT
             printf("\n          Total Ligature Anchor Tables: %d", classCount);
 #endif
             
-            ligatureAnchors = malloc(sizeof(AnchorTable) * classCount);
+            ligatureAnchors = SFArenaAllocate(arena, sizeof(AnchorTable) * classCount);
             
             for (k = 0; k < classCount; k++) {
                 SFUShort ligatureAnchorOffset = SFReadUShort(latTable, beginOffset);
@@ -890,29 +854,12 @@ static void SFReadMarkToLigatureAttachment(const SFUByte * const mtlTable, MarkT
     tablePtr->ligatureArray = ligatureArrayTable;
 }
 
-static void SFFreeMarkToLigatureAttachment(MarkToLigatureAttachmentPosSubtable *tablePtr) {
-	SFUShort i, j;
-
-    SFFreeCoverageTable(&tablePtr->markCoverage);
-    SFFreeCoverageTable(&tablePtr->ligatureCoverage);
-    SFFreeMarkArray(&tablePtr->markArray);
-    
-    for (i = 0; i < tablePtr->ligatureArray.ligatureCount; i++) {
-        for (j = 0; j < tablePtr->ligatureArray.ligatureAttach[i].componentCount; j++)
-            free(tablePtr->ligatureArray.ligatureAttach[i].componentRecord[j].ligatureAnchor);
-        
-        free(tablePtr->ligatureArray.ligatureAttach[i].componentRecord);
-    }
-    
-    free(tablePtr->ligatureArray.ligatureAttach);
-}
-
 #endif
 
 
 #ifdef GPOS_MARK_TO_MARK
 
-static void SFReadMarkToMarkAttachment(const SFUByte * const mtmTable, MarkToMarkAttachmentPosSubtable *tablePtr) {
+static void SFReadMarkToMarkAttachment(const SFUByte * const mtmTable, MarkToMarkAttachmentPosSubtable *tablePtr, SFArena *arena) {
     SFUShort posFormat;
     SFUShort mark1CoverageOffset;
     SFUShort mark2CoverageOffset;
@@ -941,7 +888,7 @@ static void SFReadMarkToMarkAttachment(const SFUByte * const mtmTable, MarkToMar
     printf("\n        Offset: %d", mark1CoverageOffset);
 #endif
     
-    SFReadCoverageTable(&mtmTable[mark1CoverageOffset], &tablePtr->mark1Coverage);
+    SFReadCoverageTable(&mtmTable[mark1CoverageOffset], &tablePtr->mark1Coverage, arena);
     
     mark2CoverageOffset = SFReadUShort(mtmTable, 4);
     
@@ -950,7 +897,7 @@ static void SFReadMarkToMarkAttachment(const SFUByte * const mtmTable, MarkToMar
     printf("\n        Offset: %d", mark2CoverageOffset);
 #endif
     
-    SFReadCoverageTable(&mtmTable[mark2CoverageOffset], &tablePtr->mark2Coverage);
+    SFReadCoverageTable(&mtmTable[mark2CoverageOffset], &tablePtr->mark2Coverage, arena);
     
     classCount = SFReadUShort(mtmTable, 6);
     tablePtr->classCount = classCount;
@@ -966,7 +913,7 @@ static void SFReadMarkToMarkAttachment(const SFUByte * const mtmTable, MarkToMar
     printf("\n        Offset: %d", mark1ArrayOffset);
 #endif
     
-    SFReadMarkArray(&mtmTable[mark1ArrayOffset], &tablePtr->mark1Array);
+    SFReadMarkArray(&mtmTable[mark1ArrayOffset], &tablePtr->mark1Array, arena);
     
     mark2ArrayOffset = SFReadUShort(mtmTable, 10);
     
@@ -984,7 +931,7 @@ static void SFReadMarkToMarkAttachment(const SFUByte * const mtmTable, MarkToMar
     printf("\n        Total Mark 2 Records: %d", mark2Count);
 #endif
     
-    mark2Records = malloc(sizeof(Mark2Record) * mark2Count);
+    mark2Records = SFArenaAllocate(arena, sizeof(Mark2Record) * mark2Count);
     
     beginOffset = 2;
     for (i = 0; i < mark2Count; i++) {
@@ -996,7 +943,7 @@ static void SFReadMarkToMarkAttachment(const SFUByte * const mtmTable, MarkToMar
         printf("\n         Total Mark 2 Anchor Tables: %d", classCount);
 #endif
         
-        mark2Anchors = malloc(sizeof(AnchorTable) * classCount);
+        mark2Anchors = SFArenaAllocate(arena, sizeof(AnchorTable) * classCount);
         
         for (j = 0; j < classCount; j++) {
             SFUShort mark2AnchorOffset = SFReadUShort(m2aTable, beginOffset);
@@ -1018,23 +965,10 @@ static void SFReadMarkToMarkAttachment(const SFUByte * const mtmTable, MarkToMar
     tablePtr->mark2Array = mark2ArrayTable;
 }
 
-static void SFFreeMarkToMarkAttachment(MarkToMarkAttachmentPosSubtable *tablePtr) {
-	SFUShort i;
-
-    SFFreeCoverageTable(&tablePtr->mark1Coverage);
-    SFFreeCoverageTable(&tablePtr->mark2Coverage);
-    SFFreeMarkArray(&tablePtr->mark1Array);
-    
-    for (i = 0; i < tablePtr->mark2Array.mark2Count; i++)
-        free(tablePtr->mark2Array.mark2Record[i].mark2Anchor);
-    
-    free(tablePtr->mark2Array.mark2Record);
-}
-
 #endif
 
 
-static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
+static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type, SFGlyphDigest *digest, SFArena *arena) {
     void *subtablePtr = NULL;
     
     if (*type == ltpExtensionPositioning) {
@@ -1043,7 +977,7 @@ static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
         *type = SFReadUShort(sTable, 2);
         extensionOffset = SFReadUInt(sTable, 4);
 
-        return SFReadPositioning(&sTable[extensionOffset], type);
+        return SFReadPositioning(&sTable[extensionOffset], type, digest, arena);
     }
     
     switch (*type) {
@@ -1051,8 +985,9 @@ static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
 #ifdef GPOS_SINGLE
         case ltpSingleAdjustment:
         {
-            SingleAdjustmentPosSubtable *subtable = malloc(sizeof(SingleAdjustmentPosSubtable));
-            SFReadSingleAdjustment(sTable, subtable);
+            SingleAdjustmentPosSubtable *subtable = SFArenaAllocate(arena, sizeof(SingleAdjustmentPosSubtable));
+            SFReadSingleAdjustment(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->coverage);
             subtablePtr = subtable;
             break;
         }
@@ -1061,8 +996,9 @@ static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
 #ifdef GPOS_PAIR
         case ltpPairAdjustment:
         {
-            PairAdjustmentPosSubtable *subtable = malloc(sizeof(PairAdjustmentPosSubtable));
-            SFReadPairAdjustment(sTable, subtable);
+            PairAdjustmentPosSubtable *subtable = SFArenaAllocate(arena, sizeof(PairAdjustmentPosSubtable));
+            SFReadPairAdjustment(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->coverage);
             subtablePtr = subtable;
             break;
         }
@@ -1071,8 +1007,9 @@ static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
 #ifdef GPOS_CURSIVE
         case ltpCursiveAttachment:
         {
-            CursiveAttachmentPosSubtable *subtable = malloc(sizeof(CursiveAttachmentPosSubtable));
-            SFReadCursiveAttachment(sTable, subtable);
+            CursiveAttachmentPosSubtable *subtable = SFArenaAllocate(arena, sizeof(CursiveAttachmentPosSubtable));
+            SFReadCursiveAttachment(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->coverage);
             subtablePtr = subtable;
             break;
         }
@@ -1081,8 +1018,9 @@ static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
 #ifdef GPOS_MARK_TO_BASE
         case ltpMarkToBaseAttachment:
         {
-            MarkToBaseAttachmentPosSubtable *subtable = malloc(sizeof(MarkToBaseAttachmentPosSubtable));
-            SFReadMarkToBaseAttachment(sTable, subtable);
+            MarkToBaseAttachmentPosSubtable *subtable = SFArenaAllocate(arena, sizeof(MarkToBaseAttachmentPosSubtable));
+            SFReadMarkToBaseAttachment(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->markCoverage);
             subtablePtr = subtable;
             break;
         }
@@ -1091,8 +1029,9 @@ static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
 #ifdef GPOS_MARK_TO_LIGATURE
         case ltpMarkToLigatureAttachment:
         {
-            MarkToLigatureAttachmentPosSubtable *subtable = malloc(sizeof(MarkToLigatureAttachmentPosSubtable));
-            SFReadMarkToLigatureAttachment(sTable, subtable);
+            MarkToLigatureAttachmentPosSubtable *subtable = SFArenaAllocate(arena, sizeof(MarkToLigatureAttachmentPosSubtable));
+            SFReadMarkToLigatureAttachment(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->markCoverage);
             subtablePtr = subtable;
             break;
         }
@@ -1101,8 +1040,9 @@ static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
 #ifdef GPOS_MARK_TO_MARK
         case ltpMarkToMarkAttachment:
         {
-            MarkToMarkAttachmentPosSubtable *subtable = malloc(sizeof(MarkToMarkAttachmentPosSubtable));
-            SFReadMarkToMarkAttachment(sTable, subtable);
+            MarkToMarkAttachmentPosSubtable *subtable = SFArenaAllocate(arena, sizeof(MarkToMarkAttachmentPosSubtable));
+            SFReadMarkToMarkAttachment(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->mark1Coverage);
             subtablePtr = subtable;
             break;
         }
@@ -1111,8 +1051,9 @@ static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
 #ifdef GSUB_GPOS_CONTEXT
         case ltpContextPositioning:
         {
-            ContextSubPosSubtable *subtable = malloc(sizeof(ContextSubPosSubtable));
-            SFReadContextSubPos(sTable, subtable);
+            ContextSubPosSubtable *subtable = SFArenaAllocate(arena, sizeof(ContextSubPosSubtable));
+            SFReadContextSubPos(sTable, subtable, arena);
+            SFAddContextSubPosToDigest(digest, subtable);
             subtablePtr = subtable;
             break;
         }
@@ -1121,8 +1062,9 @@ static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
 #ifdef GSUB_GPOS_CHAINING_CONTEXT
         case ltpChainedContextPositioning:
         {
-            ChainingContextualSubPosSubtable *subtable = malloc(sizeof(ChainingContextualSubPosSubtable));
-            SFReadChainingContextSubPos(sTable, subtable);
+            ChainingContextualSubPosSubtable *subtable = SFArenaAllocate(arena, sizeof(ChainingContextualSubPosSubtable));
+            SFReadChainingContextSubPos(sTable, subtable, arena);
+            SFAddChainingContextSubPosToDigest(digest, subtable);
             subtablePtr = subtable;
             break;
         }
@@ -1136,72 +1078,12 @@ static void *SFReadPositioning(const SFUByte * const sTable, LookupType *type) {
     return subtablePtr;
 }
 
-static void SFFreePositioning(void *tablePtr, LookupType type) {
-    switch (type) {
-            
-#ifdef GPOS_SINGLE
-        case ltpSingleAdjustment:
-            SFFreeSingleAdjustment(tablePtr);
-            break;
-#endif
-            
-#ifdef GPOS_PAIR
-        case ltpPairAdjustment:
-            SFFreePairAdjustment(tablePtr);
-            break;
-#endif
-            
-#ifdef GPOS_CURSIVE
-        case ltpCursiveAttachment:
-            SFFreeCursiveAttachment(tablePtr);
-            break;
-#endif
-            
-#ifdef GPOS_MARK_TO_BASE
-        case ltpMarkToBaseAttachment:
-            SFFreeMarkToBaseAttachment(tablePtr);
-            break;
-#endif
-            
-#ifdef GPOS_MARK_TO_LIGATURE
-        case ltpMarkToLigatureAttachment:
-            SFFreeMarkToLigatureAttachment(tablePtr);
-            break;
-#endif
-            
-#ifdef GPOS_MARK_TO_MARK
-        case ltpMarkToMarkAttachment:
-            SFFreeMarkToMarkAttachment(tablePtr);
-            break;
-#endif
-            
-#ifdef GSUB_GPOS_CONTEXT
-        case ltpContextPositioning:
-            SFFreeContextSubPos(tablePtr);
-            break;
-#endif
-            
-#ifdef GSUB_GPOS_CHAINING_CONTEXT
-        case ltpChainedContextPositioning:
-            SFFreeChainingContextSubPos(tablePtr);
-            break;
-#endif
-            
-        default:
-            break;
-    }
-    
-    free(tablePtr);
-}
 
-
-void SFReadGPOS(const SFUByte * const table, SFTableGPOS *tablePtr) {
+void SFReadGPOS(const SFUByte * const table, SFTableGPOS *tablePtr, SFArena *arena) {
     SFUShort scriptListOffset;
     SFUShort featureListOffset;
     SFUShort lookupListOffset;
     
-    gposTable = (void **)&table;
-    
     tablePtr->version = SFReadUInt(table, 0);
     
     scriptListOffset = SFReadUShort(table, 4);
@@ -1213,7 +1095,7 @@ void SFReadGPOS(const SFUByte * const table, SFTableGPOS *tablePtr) {
     printf("\n  Offset: %d", scriptListOffset);
 #endif
     
-    SFReadScriptListTable(&table[scriptListOffset], &tablePtr->scriptList);
+    SFReadScriptListTable(&table[scriptListOffset], &tablePtr->scriptList, arena);
     
     featureListOffset = SFReadUShort(table, 6);
     
@@ -1222,7 +1104,7 @@ void SFReadGPOS(const SFUByte * const table, SFTableGPOS *tablePtr) {
     printf("\n  Offset: %d", featureListOffset);
 #endif
     
-    SFReadFeatureListTable(&table[featureListOffset], &tablePtr->featureList);
+    SFReadFeatureListTable(&table[featureListOffset], &tablePtr->featureList, arena);
     
     lookupListOffset = SFReadUShort(table, 8);
     
@@ -1231,11 +1113,15 @@ void SFReadGPOS(const SFUByte * const table, SFTableGPOS *tablePtr) {
     printf("\n  Offset: %d", lookupListOffset);
 #endif
     
-    SFReadLookupListTable(&table[lookupListOffset], &tablePtr->lookupList, &SFReadPositioning);
+    SFReadLookupListTable(&table[lookupListOffset], &tablePtr->lookupList, &SFReadPositioning, arena);
 }
 
-void SFFreeGPOS(SFTableGPOS *tablePtr) {
-    SFFreeScriptListTable(&tablePtr->scriptList);
-    SFFreeFeatureListTable(&tablePtr->featureList);
-    SFFreeLookupListTable(&tablePtr->lookupList, &SFFreePositioning);
+LookupTable *SFGetGPOSLookup(SFTableGPOS *tablePtr, SFUShort lookupIndex, SFArena *arena) {
+    LookupTable *lookup = &tablePtr->lookupList.lookupTables[lookupIndex];
+    
+#ifdef SF_LAZY_LOOKUPS
+    SFLoadLookupTable(&tablePtr->lookupList, lookup, &SFReadPositioning, arena);
+#endif
+    
+    return lookup;
 }
@@ -122,6 +122,8 @@ typedef struct PairSetTable {
     SFUShort pairValueCount;        //Number of PairValueRecords
     PairValueRecord	*pairValueRecord;
                                     //Array of PairValueRecords-ordered by GlyphID of the second glyph
+    SFBool isSorted;                //Whether the second glyphs are in increasing order, so that
+                                    //they can be searched
 } PairSetTable;
 
 #endif
@@ -137,6 +139,13 @@ typedef struct Class1Record {
     Class2Record *class2Record;     //Array of Class2 records-ordered by Class2
 } Class1Record;
 
+typedef struct ClassPairValues {
+    short xPlacement1;              //Horizontal adjustment for placement of the first glyph
+    short xAdvance1;                //Horizontal adjustment for advance of the first glyph
+    short xPlacement2;              //Horizontal adjustment for placement of the second glyph
+    short xAdvance2;                //Horizontal adjustment for advance of the second glyph
+} ClassPairValues;
+
 #endif
 
 #ifdef GPOS_PAIR
@@ -173,6 +182,10 @@ typedef struct PairAdjustmentPosSubtable {
             SFUShort class2Count;   //Number of classes in ClassDef2 table-includes Class0
             Class1Record *class1Record;
                                     //Array of Class1 records-ordered by Class1
+            ClassPairValues *classPairValues;
+                                    //Values of every pair of classes-ordered by Class1, then
+                                    //by Class2-replacing the records if the value formats
+                                    //have nothing but horizontal adjustments
         } format2;
 #endif
     } format;
@@ -313,7 +326,8 @@ typedef struct SFTableGPOS {
     LookupListTable lookupList;     //Offset to LookupList table-from beginning of GPOS table
 } SFTableGPOS;
 
-void SFReadGPOS(const SFUByte * const table, SFTableGPOS *tablePtr);
-void SFFreeGPOS(SFTableGPOS *tablePtr);
+void SFReadGPOS(const SFUByte * const table, SFTableGPOS *tablePtr, SFArena *arena);
+
+LookupTable *SFGetGPOSLookup(SFTableGPOS *tablePtr, SFUShort lookupIndex, SFArena *arena);
 
 #endif
@@ -21,71 +21,43 @@
 #include "SFGSUBGPOSUtilization.h"
 #include "SFGPOSUtilization.h"
 
-#define GPOS_FEATURE_TAGS 4
-static unsigned char gposFeaturesTagOrder[GPOS_FEATURE_TAGS][5] = {
-    "curs",                         //Cursive positioning
-    "kern",                         //Pair kerning
-    "mark",                         //Mark to base positioning
-    "mkmk"                          //Mark to mark positioning
-};
-
-static void SFApplyGPOSLookup(SFInternal *internal, LookupTable lookup, SFGlyphIndex sidx, SFGlyphIndex eidx);
+static void SFApplyGPOSLookupAtIndex(SFInternal *internal, SFUShort lookupIndex, int sidx, int eidx);
 
 #if defined(GPOS_SINGLE) || defined(GPOS_PAIR)
 
-static void createPositioningValues(ValueRecord record, ValueFormat format, SFPosition *pos, SFPosition *advance) {
+static void createPositioningValues(SFInternal *internal, int index, ValueRecord record, ValueFormat format) {
     if (format & vfXPlacement)
-        pos->x = record.xPlacement;
+        SFGetXPlacement(internal, index) = record.xPlacement;
     
     if (format & vfYPlacement)
-        pos->y = record.yPlacement;
+        SFGetYPlacement(internal, index) = record.yPlacement;
     
     if (format & vfXAdvance)
-        advance->x = record.xAdvance;
+        SFGetXAdvance(internal, index) = record.xAdvance;
     
     if (format & vfYAdvance)
-        advance->y = record.yAdvance;
+        SFGetYAdvance(internal, index) = record.yAdvance;
 }
 
 
 #ifdef GPOS_SINGLE
 
-static void SFApplySingleAdjustment(SFInternal *internal, SingleAdjustmentPosSubtable *stable, LookupFlag lookupFlag, SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    int gidx;                   // end glyph index
+static void SFApplySingleAdjustment(SFInternal *internal, SingleAdjustmentPosSubtable *stable, LookupFlag lookupFlag, int sidx, int eidx) {
     int cidx;                   // coverage index
     
-    for (; ;) {
-        if (sidx.record < eidx.record) {
-            gidx = SFGetGlyphCount(internal, sidx.record);
-        } else if (sidx.record == eidx.record) {
-            gidx = eidx.glyph + 1;
-        } else {
-            break;
+    for (; sidx <= eidx; sidx++) {
+        if (SFIsIgnoredGlyph(internal, sidx, lookupFlag)) {
+            continue;
         }
         
-        for (; sidx.glyph < gidx; sidx.glyph++) {
-            if (SFIsIgnoredGlyph(internal, sidx, lookupFlag)) {
-                continue;
-            }
-            
-            cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
-            if (cidx != UNDEFINED_INDEX) {
-                if (stable->posFormat == 1) {
-                    createPositioningValues(stable->format.format1.value,
-                                            stable->valueFormat,
-                                            &SFGetPositionRecord(internal, sidx).placement,
-                                            &SFGetPositionRecord(internal, sidx).advance);
-                } else if (stable->posFormat == 2) {
-                    createPositioningValues(stable->format.format2.value[cidx],
-                                            stable->valueFormat,
-                                            &SFGetPositionRecord(internal, sidx).placement,
-                                            &SFGetPositionRecord(internal, sidx).advance);
-                }
+        cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
+        if (cidx != UNDEFINED_INDEX) {
+            if (stable->posFormat == 1) {
+                createPositioningValues(internal, sidx, stable->format.format1.value, stable->valueFormat);
+            } else if (stable->posFormat == 2) {
+                createPositioningValues(internal, sidx, stable->format.format2.value[cidx], stable->valueFormat);
             }
         }
-        
-        sidx.record++;
-        sidx.glyph = 0;
     }
 }
 
@@ -94,7 +66,28 @@ static void SFApplySingleAdjustment(SFInternal *internal, SingleAdjustmentPosSub
 #ifdef GPOS_PAIR
 
 static int SFGetIndexOfGlyphInPairSet(PairSetTable *pairSet, SFGlyph glyph) {
+    int low = 0;
+    int high = pairSet->pairValueCount;
 	int i;
+    
+    if (pairSet->isSorted) {
+        while (low < high) {
+            SFGlyph inputGlyph;
+            
+            i = (low + high) / 2;
+            inputGlyph = pairSet->pairValueRecord[i].secondGlyph;
+            
+            if (glyph < inputGlyph)
+                high = i;
+            else if (glyph > inputGlyph)
+                low = i + 1;
+            else
+                return i;
+        }
+        
+        return UNDEFINED_INDEX;
+    }
+    
     for (i = 0; i < pairSet->pairValueCount; i++) {
         SFGlyph inputGlyph = pairSet->pairValueRecord[i].secondGlyph;
         
@@ -106,108 +99,78 @@ static int SFGetIndexOfGlyphInPairSet(PairSetTable *pairSet, SFGlyph glyph) {
     return UNDEFINED_INDEX;
 }
 
-static int SFGetClassOfGlyphInClassDef(ClassDefTable *cls, SFGlyph glyph) {
-	SFUShort i;
-
-    if (cls->classFormat == 1) {
-        SFGlyph startGlyph = cls->format.format1.startGlyph;
-        SFUShort glyphCount = cls->format.format1.glyphCount;
-        
-        for (i = 0; i < glyphCount; i++) {
-            if ((startGlyph + i) == glyph)
-                return cls->format.format1.classValueArray[i];
-        }
-    } else if (cls->classFormat == 2) {
-        SFUShort classRangeCount = cls->format.format2.classRangeCount;
-        
-        for (i = 0; i < classRangeCount; i++) {
-            SFGlyph startGlyph = cls->format.format2.classRangeRecord[i].start;
-            SFGlyph endGlyph = cls->format.format2.classRangeRecord[i].end;
-            
-            if (glyph >= startGlyph && glyph <= endGlyph)
-                return cls->format.format2.classRangeRecord[i].cls;
-        }
-    }
-    
-    return UNDEFINED_INDEX;
-}
-
-static void SFApplyPairAdjustment(SFInternal *internal, PairAdjustmentPosSubtable *stable, LookupFlag lookupFlag, SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    int gidx;                   // end glyph index
+static void SFApplyPairAdjustment(SFInternal *internal, PairAdjustmentPosSubtable *stable, LookupFlag lookupFlag, int sidx, int eidx) {
     int cidx;                   // coverage index
     
-    for (; ;) {
-        if (sidx.record < eidx.record) {
-            gidx = SFGetGlyphCount(internal, sidx.record);
-        } else if (sidx.record == eidx.record) {
-            gidx = eidx.glyph + 1;
-        } else {
-            break;
+    for (; sidx <= eidx; sidx++) {
+        if (SFIsIgnoredGlyph(internal, sidx, lookupFlag)) {
+            continue;
         }
         
-        for (; sidx.glyph < gidx; sidx.glyph++) {
-            if (SFIsIgnoredGlyph(internal, sidx, lookupFlag)) {
-                continue;
+        cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
+        if (cidx != UNDEFINED_INDEX) {
+            int nidx = sidx;
+            SFGlyph nglyph;
+
+            if (!SFGetNextValidGlyphIndex(internal, &nidx, lookupFlag)
+                || nidx > eidx) {
+                return;     // if there is no next glyph or if index of next glyph is greater
+                            // than end index then there is no need to perform any action
             }
+
+            nglyph = SFGetGlyph(internal, nidx);
             
-            cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
-            if (cidx != UNDEFINED_INDEX) {
-                SFGlyphIndex nidx = sidx;
-                SFGlyph nglyph;
-
-                if (!SFGetNextValidGlyphIndex(internal, &nidx, lookupFlag)
-                    || SFCompareGlyphIndex(nidx, eidx) == 1) {
-                    return;     // if there is no next glyph or if index of next glyph is greater
-                                // than end index then there is no need to perform any action
+            if (stable->posFormat == 1) {
+                PairSetTable *pairSet;
+                int pairValueIndex = UNDEFINED_INDEX;
+                
+                if (cidx < stable->format.format1.pairSetCount) {
+                    pairSet = &stable->format.format1.pairSetTable[cidx];
+                    pairValueIndex = SFGetIndexOfGlyphInPairSet(pairSet, nglyph);
                 }
-
-                nglyph = SFGetGlyph(internal, nidx);
                 
-                if (stable->posFormat == 1) {
-                    int pairSetIndex = SFGetIndexOfGlyphInPairSet(stable->format.format1.pairSetTable, nglyph);
+                if (pairValueIndex != UNDEFINED_INDEX) {
+                    createPositioningValues(internal, sidx, pairSet->pairValueRecord[pairValueIndex].value1, stable->valueFormat1);
                     
-                    if (pairSetIndex != UNDEFINED_INDEX) {
-                        createPositioningValues(
-                                                stable->format.format1.pairSetTable[cidx].pairValueRecord[pairSetIndex].value1,
-                                                stable->valueFormat1,
-                                                &SFGetPositionRecord(internal, sidx).placement,
-                                                &SFGetPositionRecord(internal, sidx).advance);
-                        
-                        createPositioningValues(
-                                                stable->format.format1.pairSetTable[cidx].pairValueRecord[pairSetIndex].value2,
-                                                stable->valueFormat2,
-                                                &SFGetPositionRecord(internal, nidx).placement,
-                                                &SFGetPositionRecord(internal, nidx).advance);
-                    }
-                } else if (stable->posFormat == 2) {
-                    int class1Index;
-                    int class2Index;
-                    
-                    class2Index = SFGetClassOfGlyphInClassDef(&stable->format.format2.classDef2, nglyph);
-                    if (class2Index == UNDEFINED_INDEX)
-                        continue;
+                    createPositioningValues(internal, nidx, pairSet->pairValueRecord[pairValueIndex].value2, stable->valueFormat2);
+                }
+            } else if (stable->posFormat == 2) {
+                int class1Index;
+                int class2Index;
+                
+                //Glyphs missing from either class definition are in class 0.
+                class1Index = SFGetClassOfGlyph(&stable->format.format2.classDef1, SFGetGlyph(internal, sidx));
+                if (class1Index == UNDEFINED_INDEX)
+                    class1Index = 0;
+                
+                class2Index = SFGetClassOfGlyph(&stable->format.format2.classDef2, nglyph);
+                if (class2Index == UNDEFINED_INDEX)
+                    class2Index = 0;
+                
+                if (class1Index >= stable->format.format2.class1Count || class2Index >= stable->format.format2.class2Count)
+                    continue;
+                
+                if (stable->format.format2.classPairValues) {
+                    ClassPairValues *values = &stable->format.format2.classPairValues[class1Index * stable->format.format2.class2Count + class2Index];
                     
-                    class1Index = SFGetClassOfGlyphInClassDef(&stable->format.format2.classDef1, SFGetGlyph(internal, sidx));
+                    if (stable->valueFormat1 & vfXPlacement)
+                        SFGetXPlacement(internal, sidx) = values->xPlacement1;
+                    if (stable->valueFormat1 & vfXAdvance)
+                        SFGetXAdvance(internal, sidx) = values->xAdvance1;
                     
-                    createPositioningValues(
-                                            stable->format.format2.class1Record[class1Index].class2Record[class2Index].value1,
-                                            stable->valueFormat1,
-                                            &SFGetPositionRecord(internal, sidx).placement,
-                                            &SFGetPositionRecord(internal, sidx).advance);
+                    if (stable->valueFormat2 & vfXPlacement)
+                        SFGetXPlacement(internal, nidx) = values->xPlacement2;
+                    if (stable->valueFormat2 & vfXAdvance)
+                        SFGetXAdvance(internal, nidx) = values->xAdvance2;
+                } else {
+                    createPositioningValues(internal, sidx, stable->format.format2.class1Record[class1Index].class2Record[class2Index].value1, stable->valueFormat1);
                     
-                    createPositioningValues(
-                                            stable->format.format2.class1Record[class1Index].class2Record[class2Index].value2,
-                                            stable->valueFormat2,
-                                            &SFGetPositionRecord(internal, nidx).placement,
-                                            &SFGetPositionRecord(internal, nidx).advance);
+                    createPositioningValues(internal, nidx, stable->format.format2.class1Record[class1Index].class2Record[class2Index].value2, stable->valueFormat2);
                 }
-                
-                sidx = nidx;
             }
+            
+            sidx = nidx;
         }
-        
-        sidx.record++;
-        sidx.glyph = 0;
     }
 }
 
@@ -218,51 +181,41 @@ static void SFApplyPairAdjustment(SFInternal *internal, PairAdjustmentPosSubtabl
 
 #ifdef GPOS_CURSIVE
 
-static void SFApplyCursiveAttachment(SFInternal *internal, CursiveAttachmentPosSubtable *stable, LookupFlag lookupFlag, SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    int gidx;                   // end glyph index
+static void SFApplyCursiveAttachment(SFInternal *internal, CursiveAttachmentPosSubtable *stable, LookupFlag lookupFlag, int sidx, int eidx) {
     int cidx;                   // coverage index
     
     SFBool hasExitAnchor = SFFalse;
     AnchorTable exitAnchor;
     
-    for (; ;) {
-        if (sidx.record < eidx.record) {
-            gidx = SFGetGlyphCount(internal, sidx.record);
-        } else if (sidx.record == eidx.record) {
-            gidx = eidx.glyph + 1;
-        } else {
-            break;
+    //The exit anchor is only read once it is set, but it is cleared so that no compiler
+    //takes it for uninitialized.
+    memset(&exitAnchor, 0, sizeof(AnchorTable));
+    
+    for (; sidx <= eidx; sidx++) {
+        if (SFIsIgnoredGlyph(internal, sidx, lookupFlag) && hasExitAnchor) {
+            SFGetAnchorType(internal, sidx) |= atCursiveIgnored;
+            continue;
         }
         
-        for (; sidx.glyph < gidx; sidx.glyph++) {
-            if (SFIsIgnoredGlyph(internal, sidx, lookupFlag) && hasExitAnchor) {
-                SFGetPositionRecord(internal, sidx).anchorType |= atCursiveIgnored;
-                continue;
+        cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
+        if (cidx != UNDEFINED_INDEX) {
+            if (stable->entryExitRecord[cidx].hasEntryAnchor && hasExitAnchor) {
+                SFGetAnchorType(internal, sidx) |= atEntry;
+                SFGetXAnchor(internal, sidx) = exitAnchor.xCoordinate - stable->entryExitRecord[cidx].entryAnchor.xCoordinate;
+                SFGetYAnchor(internal, sidx) = exitAnchor.yCoordinate - stable->entryExitRecord[cidx].entryAnchor.yCoordinate;
+                
+                hasExitAnchor = SFFalse;
             }
             
-            cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
-            if (cidx != UNDEFINED_INDEX) {
-                if (stable->entryExitRecord[cidx].hasEntryAnchor && hasExitAnchor) {
-                    SFGetPositionRecord(internal, sidx).anchorType |= atEntry;
-                    SFGetPositionRecord(internal, sidx).anchor.x = exitAnchor.xCoordinate - stable->entryExitRecord[cidx].entryAnchor.xCoordinate;
-                    SFGetPositionRecord(internal, sidx).anchor.y = exitAnchor.yCoordinate - stable->entryExitRecord[cidx].entryAnchor.yCoordinate;
-                    
-                    hasExitAnchor = SFFalse;
-                }
+            if (stable->entryExitRecord[cidx].hasExitAnchor) {
+                SFGetAnchorType(internal, sidx) |= atExit;
                 
-                if (stable->entryExitRecord[cidx].hasExitAnchor) {
-                    SFGetPositionRecord(internal, sidx).anchorType |= atExit;
-                    
-                    hasExitAnchor = SFTrue;
-                    exitAnchor = stable->entryExitRecord[cidx].exitAnchor;
-                }
-            } else {
-                hasExitAnchor = SFFalse;
+                hasExitAnchor = SFTrue;
+                exitAnchor = stable->entryExitRecord[cidx].exitAnchor;
             }
+        } else {
+            hasExitAnchor = SFFalse;
         }
-        
-        sidx.record++;
-        sidx.glyph = 0;
     }
 }
 
@@ -270,65 +223,46 @@ static void SFApplyCursiveAttachment(SFInternal *internal, CursiveAttachmentPosS
 
 #ifdef GPOS_MARK_TO_BASE
 
-static void SFApplyMarkToBaseAttachment(SFInternal *internal, MarkToBaseAttachmentPosSubtable *stable, LookupFlag lookupFlag, SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    int gidx;                   // end glyph index
-
-    for (; ;) {
-        if (sidx.record < eidx.record) {
-            if (SFIsOddLevel(internal, sidx.record)) {
-                goto continue_loop;
-            }
+static void SFApplyMarkToBaseAttachment(SFInternal *internal, MarkToBaseAttachmentPosSubtable *stable, LookupFlag lookupFlag, int sidx, int eidx) {
+    for (; sidx <= eidx; sidx++) {
+        int midx;
+        
+        if (SFIsGlyphOfOddLevel(internal, sidx))
+            continue;
+        
+        midx = SFGetIndexOfGlyphInCoverage(&stable->markCoverage, SFGetGlyph(internal, sidx));
+        if (midx != UNDEFINED_INDEX) {
+            int pidx;           // previous index
+            SFUShort cls;
             
-            gidx = SFGetGlyphCount(internal, sidx.record);
-        } else if (sidx.record == eidx.record) {
-            if (SFIsOddLevel(internal, sidx.record)) {
-                break;
-            }
+            int bidx;           // base index
+            int x, y;
             
-            gidx = eidx.glyph + 1;
-        } else {
-            break;
-        }
-
-        for (; sidx.glyph < gidx; sidx.glyph++) {
-            int midx = SFGetIndexOfGlyphInCoverage(&stable->markCoverage, SFGetGlyph(internal, sidx));
-            if (midx != UNDEFINED_INDEX) {
-                SFGlyphIndex pidx;  // previous index
-                SFUShort cls;
-                
-                int bidx;           // base index
-                int x, y;
-                
-                pidx = sidx;
-                if (!SFGetPreviousBaseGlyphIndex(internal, &pidx, lookupFlag)) {
-                    continue;
-                }
+            pidx = sidx;
+            if (!SFGetPreviousBaseGlyphIndex(internal, &pidx, lookupFlag)) {
+                continue;
+            }
 
-                bidx = SFGetIndexOfGlyphInCoverage(&stable->baseCoverage, SFGetGlyph(internal, pidx));
-                if (bidx == UNDEFINED_INDEX) {
-                    continue;   // previous glyph did not match any of the base glyphs
+            bidx = SFGetIndexOfGlyphInCoverage(&stable->baseCoverage, SFGetGlyph(internal, pidx));
+            if (bidx == UNDEFINED_INDEX) {
+                continue;   // previous glyph did not match any of the base glyphs
 								// listed in base coverage table, so try matching sequence
 								// from next input glyph.
-                }
-                
-                SFGetPositionRecord(internal, sidx).anchorType |= atMark;
-                
-                // class Index to be applied on base glyph.
-                cls = stable->markArray.markRecord[midx].cls;
-                
-                x = stable->markArray.markRecord[midx].markAnchor.xCoordinate - stable->baseArray.baseRecord[bidx].baseAnchor[cls].xCoordinate;
-                if (x) {
-                    SFGetPositionRecord(internal, sidx).anchor.x = x;
-                }
-                
-                y = stable->markArray.markRecord[midx].markAnchor.yCoordinate - stable->baseArray.baseRecord[bidx].baseAnchor[cls].yCoordinate;
-                SFGetPositionRecord(internal, sidx).anchor.y = y;
             }
+            
+            SFGetAnchorType(internal, sidx) |= atMark;
+            
+            // class Index to be applied on base glyph.
+            cls = stable->markArray.markRecord[midx].cls;
+            
+            x = stable->markArray.markRecord[midx].markAnchor.xCoordinate - stable->baseArray.baseRecord[bidx].baseAnchor[cls].xCoordinate;
+            if (x) {
+                SFGetXAnchor(internal, sidx) = x;
+            }
+            
+            y = stable->markArray.markRecord[midx].markAnchor.yCoordinate - stable->baseArray.baseRecord[bidx].baseAnchor[cls].yCoordinate;
+            SFGetYAnchor(internal, sidx) = y;
         }
-        
-    continue_loop:
-        sidx.record++;
-        sidx.glyph = 0;
     }
 }
 
@@ -336,73 +270,54 @@ static void SFApplyMarkToBaseAttachment(SFInternal *internal, MarkToBaseAttachme
 
 #ifdef GPOS_MARK_TO_LIGATURE
 
-static void SFApplyMarkToLigatureAttachment(SFInternal *internal, MarkToLigatureAttachmentPosSubtable *stable, LookupFlag lookupFlag, SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    int gidx;                   // end glyph index
-    
-    for (; ;) {
-        if (sidx.record < eidx.record) {
-            if (SFIsOddLevel(internal, sidx.record)) {
-                goto continue_loop;
-            }
+static void SFApplyMarkToLigatureAttachment(SFInternal *internal, MarkToLigatureAttachmentPosSubtable *stable, LookupFlag lookupFlag, int sidx, int eidx) {
+    for (; sidx <= eidx; sidx++) {
+        int markIndex;
+        
+        if (SFIsGlyphOfOddLevel(internal, sidx))
+            continue;
+        
+        markIndex = SFGetIndexOfGlyphInCoverage(&stable->markCoverage, SFGetGlyph(internal, sidx));
+        
+        if (markIndex != UNDEFINED_INDEX) {
+            int pidx;           // previous index
+            SFUShort cls;
+            int component;
+
+            LigatureAttachTable *ligAttach;
             
-            gidx = SFGetGlyphCount(internal, sidx.record);
-        } else if (sidx.record == eidx.record) {
-            if (SFIsOddLevel(internal, sidx.record)) {
-                break;
-            }
+            int lidx;           // ligature index
+            int x, y;
             
-            gidx = eidx.glyph + 1;
-        } else {
-            break;
-        }
-        
-        for (; sidx.glyph < gidx; sidx.glyph++) {
-            int markIndex = SFGetIndexOfGlyphInCoverage(&stable->markCoverage, SFGetGlyph(internal, sidx));
+            pidx = sidx;
+            component = 0;
             
-            if (markIndex != UNDEFINED_INDEX) {
-                SFGlyphIndex pidx;  // previous index
-                SFUShort cls;
-                int component;
-
-                LigatureAttachTable *ligAttach;
-                
-                int lidx;           // ligature index
-                int x, y;
-                
-                pidx = sidx;
-                component = 0;
-                
-                if (!SFGetPreviousLigatureGlyphIndex(internal, &pidx, lookupFlag, &component)) {
-                    continue;
-                }
+            if (!SFGetPreviousLigatureGlyphIndex(internal, &pidx, lookupFlag, &component)) {
+                continue;
+            }
 
-                lidx = SFGetIndexOfGlyphInCoverage(&stable->ligatureCoverage, SFGetGlyph(internal, pidx));
-                ligAttach = &stable->ligatureArray.ligatureAttach[lidx];
-                
-                if (lidx == UNDEFINED_INDEX || component >= ligAttach->componentCount) {
-                    continue;   // Previous glyph did not match any of the ligature glyphs
+            lidx = SFGetIndexOfGlyphInCoverage(&stable->ligatureCoverage, SFGetGlyph(internal, pidx));
+            ligAttach = &stable->ligatureArray.ligatureAttach[lidx];
+            
+            if (lidx == UNDEFINED_INDEX || component >= ligAttach->componentCount) {
+                continue;   // Previous glyph did not match any of the ligature glyphs
 								// listed in base coverage table, so try matching sequence
 								// from next input glyph.
-                }
-                
-                SFGetPositionRecord(internal, sidx).anchorType = atMark;
-                
-                // class Index to be applied on base glyph.
-                cls = stable->markArray.markRecord[markIndex].cls;
-                
-                x = stable->markArray.markRecord[markIndex].markAnchor.xCoordinate - ligAttach->componentRecord[component].ligatureAnchor[cls].xCoordinate;
-                if (x) {
-                    SFGetPositionRecord(internal, sidx).anchor.x = x;
-                }
-                
-                y = stable->markArray.markRecord[markIndex].markAnchor.yCoordinate - ligAttach->componentRecord[component].ligatureAnchor[cls].yCoordinate;
-                SFGetPositionRecord(internal, sidx).anchor.y = y;
             }
+            
+            SFGetAnchorType(internal, sidx) = atMark;
+            
+            // class Index to be applied on base glyph.
+            cls = stable->markArray.markRecord[markIndex].cls;
+            
+            x = stable->markArray.markRecord[markIndex].markAnchor.xCoordinate - ligAttach->componentRecord[component].ligatureAnchor[cls].xCoordinate;
+            if (x) {
+                SFGetXAnchor(internal, sidx) = x;
+            }
+            
+            y = stable->markArray.markRecord[markIndex].markAnchor.yCoordinate - ligAttach->componentRecord[component].ligatureAnchor[cls].yCoordinate;
+            SFGetYAnchor(internal, sidx) = y;
         }
-        
-    continue_loop:
-        sidx.record++;
-        sidx.glyph = 0;
     }
 }
 
@@ -410,80 +325,59 @@ static void SFApplyMarkToLigatureAttachment(SFInternal *internal, MarkToLigature
 
 #ifdef GPOS_MARK_TO_MARK
 
-static void SFApplyMarkToMarkAttachment(SFInternal *internal, MarkToMarkAttachmentPosSubtable *stable, LookupFlag lookupFlag, SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    int gidx;                   // end glyph index
-    
-    for (; ;) {
-        if (sidx.record < eidx.record) {
-            if (SFIsOddLevel(internal, sidx.record)) {
-                goto continue_loop;
-            }
-            
-            gidx = SFGetGlyphCount(internal, sidx.record);
-        } else if (sidx.record == eidx.record) {
-            if (SFIsOddLevel(internal, sidx.record)) {
-                break;
-            }
-            
-            gidx = eidx.glyph + 1;
-        } else {
-            break;
-        }
+static void SFApplyMarkToMarkAttachment(SFInternal *internal, MarkToMarkAttachmentPosSubtable *stable, LookupFlag lookupFlag, int sidx, int eidx) {
+    for (; sidx <= eidx; sidx++) {
+        int mark1Index;
+        
+        if (SFIsGlyphOfOddLevel(internal, sidx))
+            continue;
         
-        for (; sidx.glyph < gidx; sidx.glyph++) {
-            int mark1Index = SFGetIndexOfGlyphInCoverage(&stable->mark1Coverage, SFGetGlyph(internal, sidx));
+        mark1Index = SFGetIndexOfGlyphInCoverage(&stable->mark1Coverage, SFGetGlyph(internal, sidx));
+        
+        if (mark1Index != UNDEFINED_INDEX) {
+            int pidx;
+            SFUShort cls;
             
-            if (mark1Index != UNDEFINED_INDEX) {
-                SFGlyphIndex pidx;
-                SFUShort cls;
-                
-                int mark2Index;
-                int x, y;
-                
-                pidx = sidx;
-                if (!SFGetPreviousGlyphIndex(internal, &pidx, lookupFlag) || !SFGetGlyph(internal, pidx)) {
-                    continue;
-                }
+            int mark2Index;
+            int x, y;
+            
+            pidx = sidx;
+            if (!SFGetPreviousGlyphIndex(internal, &pidx, lookupFlag) || !SFGetGlyph(internal, pidx)) {
+                continue;
+            }
 
-                mark2Index = SFGetIndexOfGlyphInCoverage(&stable->mark2Coverage, SFGetGlyph(internal, pidx));
-                if (mark2Index == UNDEFINED_INDEX) {
-                    continue;   // Previous glyph did not match any of the base glyphs
+            mark2Index = SFGetIndexOfGlyphInCoverage(&stable->mark2Coverage, SFGetGlyph(internal, pidx));
+            if (mark2Index == UNDEFINED_INDEX) {
+                continue;   // Previous glyph did not match any of the base glyphs
 								// listed in base coverage table, so try matching sequence
 								// from next input glyph.
-                }
-                
-                SFGetPositionRecord(internal, sidx).anchorType = atMark;
-                
-                // class Index to be applied on first mark glyph.
-                cls = stable->mark1Array.markRecord[mark1Index].cls;
-                
-                x = stable->mark1Array.markRecord[mark1Index].markAnchor.xCoordinate - stable->mark2Array.mark2Record[mark2Index].mark2Anchor[cls].xCoordinate;
-                if (x) {
-                    SFGetPositionRecord(internal, sidx).anchor.x = x - SFGetPositionRecord(internal, pidx).anchor.x;
-                }
-                
-                y = stable->mark1Array.markRecord[mark1Index].markAnchor.yCoordinate - stable->mark2Array.mark2Record[mark2Index].mark2Anchor[cls].yCoordinate;
-                SFGetPositionRecord(internal, sidx).anchor.y = y + SFGetPositionRecord(internal, pidx).anchor.y;
             }
+            
+            SFGetAnchorType(internal, sidx) = atMark;
+            
+            // class Index to be applied on first mark glyph.
+            cls = stable->mark1Array.markRecord[mark1Index].cls;
+            
+            x = stable->mark1Array.markRecord[mark1Index].markAnchor.xCoordinate - stable->mark2Array.mark2Record[mark2Index].mark2Anchor[cls].xCoordinate;
+            if (x) {
+                SFGetXAnchor(internal, sidx) = x - SFGetXAnchor(internal, pidx);
+            }
+            
+            y = stable->mark1Array.markRecord[mark1Index].markAnchor.yCoordinate - stable->mark2Array.mark2Record[mark2Index].mark2Anchor[cls].yCoordinate;
+            SFGetYAnchor(internal, sidx) = y + SFGetYAnchor(internal, pidx);
         }
-        
-    continue_loop:
-        sidx.record++;
-        sidx.glyph = 0;
     }
 }
 
 #endif
 
-static void SFApplyGPOSLookup(SFInternal *internal, LookupTable lookup, SFGlyphIndex sidx, SFGlyphIndex eidx) {
-	int i = 0;
+static void SFApplyGPOSSubtable(SFInternal *internal, LookupTable *lookup, int subtableIndex, LookupFlag lookupFlag, int sidx, int eidx) {
+    void *subtable = lookup->subtables[subtableIndex];
 
 #ifdef GPOS_SINGLE
     
-    if (lookup.lookupType == ltpSingleAdjustment) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplySingleAdjustment(internal, lookup.subtables[i], lookup.lookupFlag, sidx, eidx);
-    }
+    if (lookup->lookupType == ltpSingleAdjustment)
+        SFApplySingleAdjustment(internal, subtable, lookupFlag, sidx, eidx);
     
 #define GPOS_ELSE
     
@@ -497,10 +391,8 @@ static void SFApplyGPOSLookup(SFInternal *internal, LookupTable lookup, SFGlyphI
 #define GPOS_ELSE
 #endif
         
-     if (lookup.lookupType == ltpPairAdjustment) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplyPairAdjustment(internal, lookup.subtables[i], lookup.lookupFlag, sidx, eidx);
-    }
+    if (lookup->lookupType == ltpPairAdjustment)
+        SFApplyPairAdjustment(internal, subtable, lookupFlag, sidx, eidx);
     
 #endif
     
@@ -512,10 +404,8 @@ static void SFApplyGPOSLookup(SFInternal *internal, LookupTable lookup, SFGlyphI
 #define GPOS_ELSE
 #endif
              
-    if (lookup.lookupType == ltpCursiveAttachment) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplyCursiveAttachment(internal, lookup.subtables[i], lookup.lookupFlag, sidx, eidx);
-    }
+    if (lookup->lookupType == ltpCursiveAttachment)
+        SFApplyCursiveAttachment(internal, subtable, lookupFlag, sidx, eidx);
     
 #endif
     
@@ -527,10 +417,8 @@ static void SFApplyGPOSLookup(SFInternal *internal, LookupTable lookup, SFGlyphI
 #define GPOS_ELSE
 #endif
         
-    if (lookup.lookupType == ltpMarkToBaseAttachment) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplyMarkToBaseAttachment(internal, lookup.subtables[i], lookup.lookupFlag, sidx, eidx);
-    }
+    if (lookup->lookupType == ltpMarkToBaseAttachment)
+        SFApplyMarkToBaseAttachment(internal, subtable, lookupFlag, sidx, eidx);
     
 #endif
     
@@ -542,10 +430,8 @@ static void SFApplyGPOSLookup(SFInternal *internal, LookupTable lookup, SFGlyphI
 #define GPOS_ELSE
 #endif
     
-    if (lookup.lookupType == ltpMarkToLigatureAttachment) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplyMarkToLigatureAttachment(internal, lookup.subtables[i], lookup.lookupFlag, sidx, eidx);
-    }
+    if (lookup->lookupType == ltpMarkToLigatureAttachment)
+        SFApplyMarkToLigatureAttachment(internal, subtable, lookupFlag, sidx, eidx);
     
 #endif
 
@@ -557,10 +443,8 @@ static void SFApplyGPOSLookup(SFInternal *internal, LookupTable lookup, SFGlyphI
 #define GPOS_ELSE
 #endif
         
-    if (lookup.lookupType == ltpMarkToMarkAttachment) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplyMarkToMarkAttachment(internal, lookup.subtables[i], lookup.lookupFlag, sidx, eidx);
-    }
+    if (lookup->lookupType == ltpMarkToMarkAttachment)
+        SFApplyMarkToMarkAttachment(internal, subtable, lookupFlag, sidx, eidx);
     
 #endif
     
@@ -572,10 +456,8 @@ static void SFApplyGPOSLookup(SFInternal *internal, LookupTable lookup, SFGlyphI
 #define GPOS_ELSE
 #endif
 
-    if (lookup.lookupType == ltpChainedContextPositioning) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplyChainingContextual(internal, lookup.subtables[i], lookup.lookupFlag, &SFApplyGPOSLookup);
-    }
+    if (lookup->lookupType == ltpChainedContextPositioning)
+        SFApplyChainingContextual(internal, subtable, lookupFlag, &SFApplyGPOSLookupAtIndex);
     
 #endif
     
@@ -584,78 +466,42 @@ static void SFApplyGPOSLookup(SFInternal *internal, LookupTable lookup, SFGlyphI
 #endif
 }
 
-static void SFApplyGPOSFeatureList(SFInternal *internal, int featureIndex) {
-    FeatureTable feature = internal->gpos->featureList.featureRecord[featureIndex].feature;
-    
-    SFGlyphIndex sidx;
-    SFGlyphIndex eidx;
-    
+static void SFApplyGPOSLookupAtIndex(SFInternal *internal, SFUShort lookupIndex, int sidx, int eidx) {
+    LookupTable *lookup = SFGetGPOSLookup(internal->gpos, lookupIndex, internal->arena);
     int i;
     
-    sidx.record = 0;
-    sidx.glyph = 0;
-    
-    eidx.record = SFGetCharCount(internal) - 1;
-    eidx.glyph = SFGetGlyphCount(internal, eidx.record) - 1;
-    
-    for (i = 0; i < feature.lookupCount; i++) {
-        LookupTable currentLookup = internal->gpos->lookupList.lookupTables[feature.lookupListIndex[i]];
-        SFApplyGPOSLookup(internal, currentLookup, sidx, eidx);
-    }
-}
-
-static int SFGetIndexOfGPOSFeatureTag(char tag[5]) {
-	int i;
-    for (i = 0; i < GPOS_FEATURE_TAGS; i++) {
-        if (strcmp((const char *)gposFeaturesTagOrder[i], tag) == 0)
-            return i;
-    }
-    
-    return -1;
+    for (i = 0; i < lookup->subTableCount; i++)
+        SFApplyGPOSSubtable(internal, lookup, i, lookup->lookupFlag, sidx, eidx);
 }
 
 void SFApplyGPOS(SFInternal *internal) {
-    SFBool arabScriptFound = SFFalse;
-    int arabScriptIndex;
+    const SFShapePlan *plan = internal->plan;
     
-	int i;
+    int sidx = 0;
+    int eidx = SFGetTotalGlyphCount(internal) - 1;
     
-    for (i = 0; i < internal->gpos->scriptList.scriptCount; i++) {
-        if (strcmp((const char *)internal->gpos->scriptList.scriptRecord[i].scriptTag, "arab") == 0) {
-            arabScriptFound = SFTrue;
-            arabScriptIndex = i;
-        }
-    }
+    int i, j;
     
-    if (arabScriptFound) {
-        int totalFeatures = internal->gpos->scriptList.scriptRecord[arabScriptIndex].script.defaultLangSys.featureCount;
-        
-        int order1[GPOS_FEATURE_TAGS];
-        
-        int order2Len = 0;
-		int *order2 = malloc(sizeof(int) * totalFeatures);
-
-        for (i = 0; i < GPOS_FEATURE_TAGS; i++)
-            order1[i] = -1;
+    if (!plan->hasGPOSScript)
+        return;
+    
+    SFUpdateGlyphDigest(internal);
+    SFAddAllGlyphProperties(internal);
+    
+    if (!SFGetTotalGlyphCount(internal))
+        return;
+    
+    for (i = 0; i < plan->gposLookupCount; i++) {
+        const SFPlanLookup *planLookup = &plan->gposLookups[i];
+        LookupTable *currentLookup = planLookup->lookup;
         
-        for (i = 0; i < totalFeatures; i++) {
-            int featureIndex = internal->gpos->scriptList.scriptRecord[arabScriptIndex].script.defaultLangSys.featureIndex[i];
-            
-            int val = SFGetIndexOfGPOSFeatureTag((char *)internal->gpos->featureList.featureRecord[featureIndex].featureTag);
-            if (val > -1)
-                order1[val] = featureIndex;
-            else
-                order2[order2Len++] = featureIndex;
-        }
+        //Positionings do not change the glyphs, so the digest of the string stays valid.
+        if (!SFDoGlyphDigestsIntersect(&currentLookup->digest, &internal->glyphDigest))
+            continue;
         
-        for (i = 0; i < GPOS_FEATURE_TAGS; i++) {
-            if (order1[i] > -1)
-                SFApplyGPOSFeatureList(internal, order1[i]);
+        for (j = 0; j < currentLookup->subTableCount; j++) {
+            if (SFDoGlyphDigestsIntersect(&currentLookup->subtableDigests[j], &internal->glyphDigest))
+                SFApplyGPOSSubtable(internal, currentLookup, j, planLookup->lookupFlag, sidx, eidx);
         }
-        
-        for (i = 0; i < order2Len; i++)
-            SFApplyGPOSFeatureList(internal, order2[i]);
-
-		free(order2);
     }
 }
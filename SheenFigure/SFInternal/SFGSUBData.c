@@ -22,7 +22,7 @@
 
 #ifdef GSUB_SINGLE
 
-static void SFReadSingleSubst(const SFUByte * const ssTable, SingleSubstSubtable *tablePtr) {
+static void SFReadSingleSubst(const SFUByte * const ssTable, SingleSubstSubtable *tablePtr, SFArena *arena) {
     SFUShort substFormat;
     SFUShort coverageOffset;
     
@@ -40,7 +40,7 @@ static void SFReadSingleSubst(const SFUByte * const ssTable, SingleSubstSubtable
     printf("\n       Coverage Table:");
 #endif
     
-    SFReadCoverageTable(&ssTable[coverageOffset], &tablePtr->coverage);
+    SFReadCoverageTable(&ssTable[coverageOffset], &tablePtr->coverage, arena);
     
     switch (substFormat) {
             
@@ -60,8 +60,9 @@ static void SFReadSingleSubst(const SFUByte * const ssTable, SingleSubstSubtable
 #ifdef GSUB_SINGLE_FORMAT2
         case 2:
         {
-            SFGlyph *substitutes;
+#ifdef LOOKUP_TEST
             SFUShort i;
+#endif
             
             glyphCount = SFReadUShort(ssTable, 4);
             tablePtr->format.format2.glyphCount = glyphCount;
@@ -70,37 +71,24 @@ static void SFReadSingleSubst(const SFUByte * const ssTable, SingleSubstSubtable
             printf("\n       Total Substitutes: %d", glyphCount);
 #endif
             
-            substitutes = malloc(sizeof(SFGlyph) * glyphCount);
-            for (i = 0; i < glyphCount; i++) {
-                substitutes[i] = SFReadUShort(ssTable, 6 + (i * 2));
-                
+            tablePtr->format.format2.substitute = SFReadUShortArray(ssTable, 6, glyphCount, arena);
+            
 #ifdef LOOKUP_TEST
-                printf("\n        Substitute At Index %d: %d", i + 1, substitutes[i]);
+            for (i = 0; i < glyphCount; i++)
+                printf("\n        Substitute At Index %d: %d", i + 1, SFUShortArrayGet(tablePtr->format.format2.substitute, i));
 #endif
-            }
-            
-            tablePtr->format.format2.substitute = substitutes;
         }
             break;
 #endif
     }
 }
 
-static void SFFreeSingleSubst(SingleSubstSubtable *tablePtr) {
-    SFFreeCoverageTable(&tablePtr->coverage);
-    
-#ifdef GSUB_SINGLE_FORMAT2
-    if (tablePtr->substFormat == 2)
-        free(tablePtr->format.format2.substitute);
-#endif
-}
-
 #endif
 
 
 #ifdef GSUB_MULTIPLE
 
-static void SFReadMultipleSubst(const SFUByte * const msTable, MultipleSubstSubtable *tablePtr) {
+static void SFReadMultipleSubst(const SFUByte * const msTable, MultipleSubstSubtable *tablePtr, SFArena *arena) {
     SFUShort substFormat;
     SFUShort coverageOffset;
     SFUShort sequenceCount;
@@ -120,7 +108,7 @@ static void SFReadMultipleSubst(const SFUByte * const msTable, MultipleSubstSubt
     printf("\n        Offset: %d", coverageOffset);
 #endif
     
-    SFReadCoverageTable(&msTable[coverageOffset], &tablePtr->coverage);
+    SFReadCoverageTable(&msTable[coverageOffset], &tablePtr->coverage, arena);
     
     sequenceCount = SFReadUShort(msTable, 4);
     tablePtr->sequenceCount = sequenceCount;
@@ -129,16 +117,17 @@ static void SFReadMultipleSubst(const SFUByte * const msTable, MultipleSubstSubt
     printf("\n       Total Sequences: %d", sequenceCount);
 #endif
     
-    sequenceTables = malloc(sizeof(SequenceTable) * sequenceCount);
+    sequenceTables = SFArenaAllocate(arena, sizeof(SequenceTable) * sequenceCount);
     
     for (i = 0; i < sequenceCount; i++) {
         SFUShort offset;
         const SFUByte *sqTable;
         
         SFUShort glyphCount;
-        SFGlyph *substitutes;
         
+#ifdef LOOKUP_TEST
 		SFUShort j;
+#endif
 
         offset = SFReadUShort(msTable, 6 + (i * 2));
         
@@ -151,44 +140,25 @@ static void SFReadMultipleSubst(const SFUByte * const msTable, MultipleSubstSubt
 #endif
         
         sequenceTables[i].glyphCount = glyphCount;
-        
-        substitutes = malloc(sizeof(SFGlyph) * glyphCount);
+        sequenceTables[i].substitute = SFReadUShortArray(sqTable, 2, glyphCount, arena);
         
 #ifdef LOOKUP_TEST
         printf("\n        Total Substitutes: %d", glyphCount);
-#endif
         
-        for (j = 0; j < glyphCount; j++) {
-            substitutes[j] = SFReadUShort(sqTable, 2 + (j * 2));
-            
-#ifdef LOOKUP_TEST
-            printf("\n        Substitute At Index %d: %d", j, substitutes[j]);
+        for (j = 0; j < glyphCount; j++)
+            printf("\n        Substitute At Index %d: %d", j, SFUShortArrayGet(sequenceTables[i].substitute, j));
 #endif
-        }
-        
-        sequenceTables[i].substitute = substitutes;
     }
     
     tablePtr->sequence = sequenceTables;
 }
 
-static void SFFreeMultipleSubst(MultipleSubstSubtable *tablePtr) {
-	int i;
-
-    SFFreeCoverageTable(&tablePtr->coverage);
-    
-    for (i = 0; i < tablePtr->sequenceCount; i++)
-        free(tablePtr->sequence[i].substitute);
-    
-    free(tablePtr->sequence);
-}
-
 #endif
 
 
 #ifdef GSUB_ALTERNATE
 
-static void SFReadAlternateSubst(const SFUByte * const asTable, AlternateSubstSubtable *tablePtr) {
+static void SFReadAlternateSubst(const SFUByte * const asTable, AlternateSubstSubtable *tablePtr, SFArena *arena) {
     SFUShort substFormat;
     SFUShort coverageOffset;
     
@@ -208,7 +178,7 @@ static void SFReadAlternateSubst(const SFUByte * const asTable, AlternateSubstSu
     printf("\n       Coverage Table:");
 #endif
     
-    SFReadCoverageTable(&asTable[coverageOffset], &tablePtr->coverage);
+    SFReadCoverageTable(&asTable[coverageOffset], &tablePtr->coverage, arena);
     
     tablePtr->alternateSetCount = SFReadUShort(asTable, 4);
     
@@ -216,16 +186,17 @@ static void SFReadAlternateSubst(const SFUByte * const asTable, AlternateSubstSu
     printf("\n       Total Alternate Sets: %d", tablePtr->alternateSetCount);
 #endif
     
-    alternateSetTables = malloc(sizeof(AlternateSetTable) * tablePtr->alternateSetCount);
+    alternateSetTables = SFArenaAllocate(arena, sizeof(AlternateSetTable) * tablePtr->alternateSetCount);
     
     for (i = 0; i < tablePtr->alternateSetCount; i++) {
         SFUShort offset;
         const SFUByte *aTable;
         
         SFUShort glyphCount;
-        SFGlyph *substitutes;
         
+#ifdef LOOKUP_TEST
         SFUShort j;
+#endif
         
         offset = SFReadUShort(asTable, 6 + (i * 2));
         
@@ -237,43 +208,26 @@ static void SFReadAlternateSubst(const SFUByte * const asTable, AlternateSubstSu
         aTable = &asTable[offset];
         glyphCount = SFReadUShort(aTable, 0);
         
+        alternateSetTables[i].glyphCount = glyphCount;
+        alternateSetTables[i].substitute = SFReadUShortArray(aTable, 2, glyphCount, arena);
+        
 #ifdef LOOKUP_TEST
         printf("\n        Total Alternates: %d", glyphCount);
-#endif
-        
-        substitutes = malloc(sizeof(SFGlyph) * glyphCount);
         
-        for (j = 0; j < glyphCount; j++) {
-            substitutes[j] = SFReadUShort(aTable, 2 + (j * 2));
-            
-#ifdef LOOKUP_TEST
-            printf("\n        Alternate At Index %d: %d", j, substitutes[j]);
+        for (j = 0; j < glyphCount; j++)
+            printf("\n        Alternate At Index %d: %d", j, SFUShortArrayGet(alternateSetTables[i].substitute, j));
 #endif
-        }
-        
-        alternateSetTables[i].substitute = substitutes;
     }
     
     tablePtr->alternateSet = alternateSetTables;
 }
 
-static void SFFreeAlternateSubst(AlternateSubstSubtable *tablePtr) {
-	int i;
-
-    SFFreeCoverageTable(&tablePtr->coverage);
-    
-    for (i = 0; i < tablePtr->alternateSetCount; i++)
-        free(tablePtr->alternateSet[i].substitute);
-    
-    free(tablePtr->alternateSet);
-}
-
 #endif
 
 
 #ifdef GSUB_LIGATURE
 
-static void SFReadLigatureSubst(const SFUByte * const lsTable, LigatureSubstSubtable *tablePtr) {
+static void SFReadLigatureSubst(const SFUByte * const lsTable, LigatureSubstSubtable *tablePtr, SFArena *arena) {
     SFUShort substFormat;
     SFUShort coverageOffset;
     
@@ -294,7 +248,7 @@ static void SFReadLigatureSubst(const SFUByte * const lsTable, LigatureSubstSubt
     printf("\n        Offset: %d", coverageOffset);
 #endif
     
-    SFReadCoverageTable(&lsTable[coverageOffset], &tablePtr->coverage);
+    SFReadCoverageTable(&lsTable[coverageOffset], &tablePtr->coverage, arena);
     
     ligSetCount = SFReadUShort(lsTable, 4);
     tablePtr->ligSetCount = ligSetCount;
@@ -303,7 +257,7 @@ static void SFReadLigatureSubst(const SFUByte * const lsTable, LigatureSubstSubt
     printf("\n       Total Ligature Sets: %d", ligSetCount);
 #endif
     
-    ligSetTables = malloc(sizeof(LigatureSetTable) * ligSetCount);
+    ligSetTables = SFArenaAllocate(arena, sizeof(LigatureSetTable) * ligSetCount);
     
     for (i = 0; i < ligSetCount; i++) {
         SFUShort offset;
@@ -326,16 +280,17 @@ static void SFReadLigatureSubst(const SFUByte * const lsTable, LigatureSubstSubt
         printf("\n        Total Ligature Tables: %d", ligCount);
 #endif
         
-        ligatureTables = malloc(sizeof(LigatureTable) * ligCount);
+        ligatureTables = SFArenaAllocate(arena, sizeof(LigatureTable) * ligCount);
         
         for (j = 0; j < ligCount; j++) {
             SFUShort ligOffset;
             const SFUByte *lTable;
             
             SFUShort compCount;
-            SFGlyph *components;
             
+#ifdef LOOKUP_TEST
 			SFUShort k;
+#endif
 
             ligOffset = SFReadUShort(ligsTable, 2 + (j * 2));
             
@@ -352,18 +307,13 @@ static void SFReadLigatureSubst(const SFUByte * const lsTable, LigatureSubstSubt
             printf("\n         Total Components: %d", compCount);
 #endif
             
-            components = malloc(sizeof(SFGlyph) * compCount);
-            components[0] = 0;
+            //The first component is the covered glyph itself, so it is not part of the array.
+            ligatureTables[j].component = SFReadUShortArray(lTable, 4, compCount ? compCount - 1 : 0, arena);
             
-            for (k = 0; k < compCount - 1; k++) {
-                components[k + 1] = SFReadUShort(lTable, 4 + (k * 2));
-                
 #ifdef LOOKUP_TEST
-                printf("\n         Component At Index %d: %d", k + 1, components[k + 1]);
+            for (k = 0; k + 1 < compCount; k++)
+                printf("\n         Component At Index %d: %d", k + 1, SFUShortArrayGet(ligatureTables[j].component, k));
 #endif
-            }
-            
-            ligatureTables[j].component = components;
         }
         
         ligSetTables[i].ligature = ligatureTables;
@@ -372,27 +322,12 @@ static void SFReadLigatureSubst(const SFUByte * const lsTable, LigatureSubstSubt
     tablePtr->ligatureSet = ligSetTables;
 }
 
-static void SFFreeLigatureSubst(LigatureSubstSubtable *tablePtr) {
-	int i, j;
-
-    SFFreeCoverageTable(&tablePtr->coverage);
-    
-    for (i = 0; i < tablePtr->ligSetCount; i++) {
-        for (j = 0; j < tablePtr->ligatureSet[i].ligatureCount; j++)
-            free(tablePtr->ligatureSet[i].ligature[j].component);
-        
-        free(tablePtr->ligatureSet[i].ligature);
-    }
-    
-    free(tablePtr->ligatureSet);
-}
-
 #endif
 
 
 #ifdef GSUB_REVERSE_CHAINING_CONTEXT
 
-static void SFReadReverseChainingContextSubst(const SFUByte * const rccssTable, ReverseChainingContextSubstSubtable *tablePtr) {
+static void SFReadReverseChainingContextSubst(const SFUByte * const rccssTable, ReverseChainingContextSubstSubtable *tablePtr, SFArena *arena) {
     SFUShort coverageOffset;
     SFUShort backtrackGlyphCount;
     CoverageTable *backtrackCoverageTables;
@@ -401,9 +336,12 @@ static void SFReadReverseChainingContextSubst(const SFUByte * const rccssTable,
     CoverageTable *lookaheadCoverageTables;
     
     SFUShort glyphCount;
-    SFGlyph *substitutes;
     
-    SFUShort i, j, k;
+    SFUShort i, j;
+    
+#ifdef LOOKUP_TEST
+    SFUShort k;
+#endif
     
     coverageOffset = SFReadUShort(rccssTable, 2);
     
@@ -412,7 +350,7 @@ static void SFReadReverseChainingContextSubst(const SFUByte * const rccssTable,
     printf("\n        Offset: %d", coverageOffset);
 #endif
     
-    SFReadCoverageTable(&rccssTable[coverageOffset], &tablePtr->Coverage);
+    SFReadCoverageTable(&rccssTable[coverageOffset], &tablePtr->Coverage, arena);
     
     backtrackGlyphCount = SFReadUShort(rccssTable, 4);
     tablePtr->backtrackGlyphCount = backtrackGlyphCount;
@@ -421,7 +359,7 @@ static void SFReadReverseChainingContextSubst(const SFUByte * const rccssTable,
     printf("\n       Total Backtrack Glyphs: %d", backtrackGlyphCount);
 #endif
     
-    backtrackCoverageTables = malloc(sizeof(CoverageTable) * backtrackGlyphCount);
+    backtrackCoverageTables = SFArenaAllocate(arena, sizeof(CoverageTable) * backtrackGlyphCount);
     
     for (i = 0; i < backtrackGlyphCount; i++) {
         SFUShort coverageOffset = SFReadUShort(rccssTable, 6 + (i * 2));
@@ -431,7 +369,7 @@ static void SFReadReverseChainingContextSubst(const SFUByte * const rccssTable,
         printf("\n        Offset: %d", coverageOffset);
 #endif
         
-        SFReadCoverageTable(&rccssTable[coverageOffset], &backtrackCoverageTables[i]);
+        SFReadCoverageTable(&rccssTable[coverageOffset], &backtrackCoverageTables[i], arena);
     }
     i = i + (6 + (i * 2));
     
@@ -444,7 +382,7 @@ static void SFReadReverseChainingContextSubst(const SFUByte * const rccssTable,
     printf("\n       Total Lookahead Glyphs: %d", backtrackGlyphCount);
 #endif
     
-    lookaheadCoverageTables = malloc(sizeof(CoverageTable) * lookaheadGlyphCount);
+    lookaheadCoverageTables = SFArenaAllocate(arena, sizeof(CoverageTable) * lookaheadGlyphCount);
     
     i += 2;
     for (j = 0; j < lookaheadGlyphCount; j++) {
@@ -455,7 +393,7 @@ static void SFReadReverseChainingContextSubst(const SFUByte * const rccssTable,
         printf("\n        Offset: %d", coverageOffset);
 #endif
         
-        SFReadCoverageTable(&rccssTable[coverageOffset], &lookaheadCoverageTables[j]);
+        SFReadCoverageTable(&rccssTable[coverageOffset], &lookaheadCoverageTables[j], arena);
     }
     i = i + (j * 2) + 2;
     
@@ -468,41 +406,19 @@ static void SFReadReverseChainingContextSubst(const SFUByte * const rccssTable,
     printf("\n       Total Substitute Glyphs: %d", glyphCount);
 #endif
     
-    substitutes = malloc(sizeof(SFGlyph) * glyphCount);
-    
     i += 2;
-    for (k = 0; k < glyphCount; k++) {
-        substitutes[k] = SFReadUShort(rccssTable, i + (k * 2));
-        
+    tablePtr->substitute = SFReadUShortArray(rccssTable, i, glyphCount, arena);
+    
 #ifdef LOOKUP_TEST
-        printf("\n       Substitute At Index %d: %d", k, substitutes[k]);
+    for (k = 0; k < glyphCount; k++)
+        printf("\n       Substitute At Index %d: %d", k, SFUShortArrayGet(tablePtr->substitute, k));
 #endif
-    }
-    
-    tablePtr->substitute = substitutes;
-}
-
-static void SFFreeReverseChainingContextSubst(ReverseChainingContextSubstSubtable *tablePtr) {
-    int i;
-    
-    SFFreeCoverageTable(&tablePtr->Coverage);
-    
-    for (i = 0; i < tablePtr->backtrackGlyphCount; i++)
-        SFFreeCoverageTable(&tablePtr->backtrackGlyphCoverage[i]);
-    
-    free(tablePtr->backtrackGlyphCoverage);
-    
-    for (i = 0; i < tablePtr->lookaheadGlyphCount; i++)
-        SFFreeCoverageTable(&tablePtr->lookaheadGlyphCoverage[i]);
-    
-    free(tablePtr->lookaheadGlyphCoverage);
-    free(tablePtr->substitute);
 }
 
 #endif
 
 
-static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type) {
+static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type, SFGlyphDigest *digest, SFArena *arena) {
     void *subtablePtr = NULL;
     
     if (*type == ltsExtensionSubstitution) {
@@ -511,7 +427,7 @@ static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type)
         *type = SFReadUShort(sTable, 2);
         extensionOffset = SFReadUInt(sTable, 4);
         
-        return SFReadSubstitution(&sTable[extensionOffset], type);
+        return SFReadSubstitution(&sTable[extensionOffset], type, digest, arena);
     }
     
     switch (*type) {
@@ -519,8 +435,9 @@ static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type)
 #ifdef GSUB_SINGLE
         case ltsSingle:
         {
-            SingleSubstSubtable *subtable = malloc(sizeof(SingleSubstSubtable));
-            SFReadSingleSubst(sTable, subtable);
+            SingleSubstSubtable *subtable = SFArenaAllocate(arena, sizeof(SingleSubstSubtable));
+            SFReadSingleSubst(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->coverage);
             subtablePtr = subtable;
             break;
         }
@@ -529,8 +446,9 @@ static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type)
 #ifdef GSUB_MULTIPLE
         case ltsMultiple:
         {
-            MultipleSubstSubtable *subtable = malloc(sizeof(MultipleSubstSubtable));
-            SFReadMultipleSubst(sTable, subtable);
+            MultipleSubstSubtable *subtable = SFArenaAllocate(arena, sizeof(MultipleSubstSubtable));
+            SFReadMultipleSubst(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->coverage);
             subtablePtr = subtable;
             break;
         }
@@ -539,8 +457,9 @@ static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type)
 #ifdef GSUB_ALTERNATE
         case ltsAlternate:
         {
-            AlternateSubstSubtable *subtable = malloc(sizeof(AlternateSubstSubtable));
-            SFReadAlternateSubst(sTable, subtable);
+            AlternateSubstSubtable *subtable = SFArenaAllocate(arena, sizeof(AlternateSubstSubtable));
+            SFReadAlternateSubst(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->coverage);
             subtablePtr = subtable;
             break;
         }
@@ -549,8 +468,9 @@ static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type)
 #ifdef GSUB_LIGATURE
         case ltsLigature:
         {
-            LigatureSubstSubtable *subtable = malloc(sizeof(LigatureSubstSubtable));
-            SFReadLigatureSubst(sTable, subtable);
+            LigatureSubstSubtable *subtable = SFArenaAllocate(arena, sizeof(LigatureSubstSubtable));
+            SFReadLigatureSubst(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->coverage);
             subtablePtr = subtable;
             break;
         }
@@ -559,8 +479,9 @@ static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type)
 #ifdef GSUB_GPOS_CONTEXT
         case ltsContext:
         {
-            ContextSubPosSubtable *subtable = malloc(sizeof(ContextSubPosSubtable));
-            SFReadContextSubPos(sTable, subtable);
+            ContextSubPosSubtable *subtable = SFArenaAllocate(arena, sizeof(ContextSubPosSubtable));
+            SFReadContextSubPos(sTable, subtable, arena);
+            SFAddContextSubPosToDigest(digest, subtable);
             subtablePtr = subtable;
             break;
         }
@@ -569,8 +490,9 @@ static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type)
 #ifdef GSUB_GPOS_CHAINING_CONTEXT
         case ltsChainingContext:
         {
-            ChainingContextualSubPosSubtable *subtable = malloc(sizeof(ChainingContextualSubPosSubtable));
-            SFReadChainingContextSubPos(sTable, subtable);
+            ChainingContextualSubPosSubtable *subtable = SFArenaAllocate(arena, sizeof(ChainingContextualSubPosSubtable));
+            SFReadChainingContextSubPos(sTable, subtable, arena);
+            SFAddChainingContextSubPosToDigest(digest, subtable);
             subtablePtr = subtable;
             break;
         }
@@ -579,8 +501,9 @@ static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type)
 #ifdef GSUB_REVERSE_CHAINING_CONTEXT
         case ltsReverseChainingContextSingle:
         {
-            ReverseChainingContextSubstSubtable *subtable = malloc(sizeof(ReverseChainingContextSubstSubtable));
-            SFReadReverseChainingContextSubst(sTable, subtable);
+            ReverseChainingContextSubstSubtable *subtable = SFArenaAllocate(arena, sizeof(ReverseChainingContextSubstSubtable));
+            SFReadReverseChainingContextSubst(sTable, subtable, arena);
+            SFAddCoverageToDigest(digest, &subtable->Coverage);
             subtablePtr = subtable;
             break;
         }
@@ -594,59 +517,8 @@ static void *SFReadSubstitution(const SFUByte * const sTable, LookupType *type)
     return subtablePtr;
 }
 
-static void SFFreeSubstitution(void *tablePtr, LookupType type) {
-    switch (type) {
-            
-#ifdef GSUB_SINGLE
-        case ltsSingle:
-            SFFreeSingleSubst(tablePtr);
-            break;
-#endif
-            
-#ifdef GSUB_MULTIPLE
-        case ltsMultiple:
-            SFFreeMultipleSubst(tablePtr);
-            break;
-#endif
-            
-#ifdef GSUB_ALTERNATE
-        case ltsAlternate:
-            SFFreeAlternateSubst(tablePtr);
-            break;
-#endif
-            
-#ifdef GSUB_LIGATURE
-        case ltsLigature:
-            SFFreeLigatureSubst(tablePtr);
-            break;
-#endif
-            
-#ifdef GSUB_GPOS_CONTEXT
-        case ltsContext:
-            SFFreeContextSubPos(tablePtr);
-            break;
-#endif
-            
-#ifdef GSUB_GPOS_CHAINING_CONTEXT
-        case ltsChainingContext:
-            SFFreeChainingContextSubPos(tablePtr);
-            break;
-#endif
-            
-#ifdef GSUB_REVERSE_CHAINING_CONTEXT
-        case ltsReverseChainingContextSingle:
-            SFFreeReverseChainingContextSubst(tablePtr);
-            break;
-#endif
-        default:
-            break;
-    }
-    
-    free(tablePtr);
-}
-
 
-void SFReadGSUB(const SFUByte * const table, SFTableGSUB *tablePtr) {
+void SFReadGSUB(const SFUByte * const table, SFTableGSUB *tablePtr, SFArena *arena) {
     SFUShort scriptListOffset;
     SFUShort featureListOffset;
     SFUShort lookupListOffset;
@@ -662,7 +534,7 @@ void SFReadGSUB(const SFUByte * const table, SFTableGSUB *tablePtr) {
     printf("\n  Offset: %d", scriptListOffset);
 #endif
     
-    SFReadScriptListTable(&table[scriptListOffset], &tablePtr->scriptList);
+    SFReadScriptListTable(&table[scriptListOffset], &tablePtr->scriptList, arena);
     
     featureListOffset = SFReadUShort(table, 6);
     
@@ -671,7 +543,7 @@ void SFReadGSUB(const SFUByte * const table, SFTableGSUB *tablePtr) {
     printf("\n  Offset: %d", featureListOffset);
 #endif
     
-    SFReadFeatureListTable(&table[featureListOffset], &tablePtr->featureList);
+    SFReadFeatureListTable(&table[featureListOffset], &tablePtr->featureList, arena);
     
     lookupListOffset = SFReadUShort(table, 8);
     
@@ -680,11 +552,15 @@ void SFReadGSUB(const SFUByte * const table, SFTableGSUB *tablePtr) {
     printf("\n  Offset: %d", lookupListOffset);
 #endif
     
-    SFReadLookupListTable(&table[lookupListOffset], &tablePtr->lookupList, &SFReadSubstitution);
+    SFReadLookupListTable(&table[lookupListOffset], &tablePtr->lookupList, &SFReadSubstitution, arena);
 }
 
-void SFFreeGSUB(SFTableGSUB *tablePtr) {
-    SFFreeScriptListTable(&tablePtr->scriptList);
-    SFFreeFeatureListTable(&tablePtr->featureList);
-    SFFreeLookupListTable(&tablePtr->lookupList, &SFFreeSubstitution);
+LookupTable *SFGetGSUBLookup(SFTableGSUB *tablePtr, SFUShort lookupIndex, SFArena *arena) {
+    LookupTable *lookup = &tablePtr->lookupList.lookupTables[lookupIndex];
+    
+#ifdef SF_LAZY_LOOKUPS
+    SFLoadLookupTable(&tablePtr->lookupList, lookup, &SFReadSubstitution, arena);
+#endif
+    
+    return lookup;
 }
@@ -38,7 +38,8 @@ typedef struct SingleSubstSubtable {
 #ifdef GSUB_SINGLE_FORMAT2
         struct {
             SFUShort glyphCount;    //Number of GlyphIDs in the Substitute array
-            SFGlyph *substitute;    //Array of substitute GlyphIDs-ordered by Coverage Index
+            SFUShortArray substitute;
+                                    //Array of substitute GlyphIDs-ordered by Coverage Index
         } format2;
 #endif
     } format;
@@ -53,7 +54,7 @@ typedef struct SingleSubstSubtable {
 typedef struct SequenceTable {
     SFUShort glyphCount;            //Number of GlyphIDs in the Substitute array.
                                     //This should always be greater than 0.
-    SFGlyph *substitute;            //String of GlyphIDs to substitute
+    SFUShortArray substitute;       //String of GlyphIDs to substitute
 } SequenceTable;
 
 typedef struct MultipleSubstSubtable {
@@ -71,7 +72,7 @@ typedef struct MultipleSubstSubtable {
 
 typedef struct AlternateSetTable {
     SFUShort glyphCount;            //Number of GlyphIDs in the Alternate array
-    SFGlyph *substitute;            //Array of alternate GlyphIDs-in arbitrary order
+    SFUShortArray substitute;       //Array of alternate GlyphIDs-in arbitrary order
 } AlternateSetTable;
 
 typedef struct AlternateSubstSubtable {
@@ -90,7 +91,7 @@ typedef struct AlternateSubstSubtable {
 typedef struct LigatureTable {
     SFGlyph ligGlyph;               //GlyphID of ligature to substitute
     SFUShort compCount;             //Number of components in the ligature
-    SFGlyph	*component;             //[CompCount - 1]. Array of component GlyphIDs-start with
+    SFUShortArray component;        //[CompCount - 1]. Array of component GlyphIDs-start with
                                     //the second component-ordered in writing direction
 } LigatureTable;
 
@@ -125,7 +126,7 @@ typedef struct ReverseChainingContextSubstSubtable {
                                     //Array of offsets to coverage tables in lookahead sequence,
                                     //in glyph sequence order
     SFUShort glyphCount;            //Number of GlyphIDs in the Substitute array
-    SFGlyph *substitute;            //Array of substitute GlyphIDs-ordered by Coverage Index
+    SFUShortArray substitute;       //Array of substitute GlyphIDs-ordered by Coverage Index
 } ReverseChainingContextSubstSubtable;
 
 #endif
@@ -138,8 +139,9 @@ typedef struct SFTableGSUB {
     LookupListTable lookupList;     //Offset to LookupList table-from beginning of GSUB table
 } SFTableGSUB;
 
-void SFReadGSUB(const SFUByte * const table, SFTableGSUB *tablePtr);
-void SFFreeGSUB(SFTableGSUB *tablePtr);
+void SFReadGSUB(const SFUByte * const table, SFTableGSUB *tablePtr, SFArena *arena);
+
+LookupTable *SFGetGSUBLookup(SFTableGSUB *tablePtr, SFUShort lookupIndex, SFArena *arena);
 
 #endif
 
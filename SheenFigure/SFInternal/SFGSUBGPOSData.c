@@ -21,7 +21,7 @@
 
 #ifdef GSUB_GPOS_CONTEXT
 
-void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *tablePtr) {
+void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *tablePtr, SFArena *arena) {
     SFUShort subPosFormat = SFReadUShort(csTable, 0);
     tablePtr->subPosFormat = subPosFormat;
     
@@ -48,7 +48,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
             printf("\n        Offset: %d", coverageOffset);
 #endif
             
-            SFReadCoverageTable(&csTable[coverageOffset], &tablePtr->format.format1.coverage);
+            SFReadCoverageTable(&csTable[coverageOffset], &tablePtr->format.format1.coverage, arena);
             
             subPosRuleSetCount = SFReadUShort(csTable, 4);
             tablePtr->format.format1.subPosRuleSetCount = subPosRuleSetCount;
@@ -57,7 +57,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
             printf("\n       Total SubPos Rule Sets: %d", subPosRuleSetCount);
 #endif
             
-            subPosRuleSetTables = malloc(sizeof(SubPosRuleSetTable) * subPosRuleSetCount);
+            subPosRuleSetTables = SFArenaAllocate(arena, sizeof(SubPosRuleSetTable) * subPosRuleSetCount);
             
             for (i = 0; i < subPosRuleSetCount; i++) {
                 SFUShort subPosRuleSetOffset;
@@ -82,7 +82,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
                 printf("\n        Total SubPos Rules: %d", subPosRuleCount);
 #endif
                 
-                subPosRuleTables = malloc(sizeof(SubPosRuleTable) * subPosRuleCount);
+                subPosRuleTables = SFArenaAllocate(arena, sizeof(SubPosRuleTable) * subPosRuleCount);
                 
                 for (j = 0; j < subPosRuleCount; j++) {
                     SFUShort subPosRuleOffset;
@@ -115,7 +115,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
                     printf("\n         Total Lookup Records: %d", subPosCount);
 #endif
                     
-                    glyphs = malloc(sizeof(SFGlyph) * glyphCount);
+                    glyphs = SFArenaAllocate(arena, sizeof(SFGlyph) * glyphCount);
                     glyphs[0] = 0;
                     
                     for (k = 0; k < glyphCount; k++) {
@@ -130,7 +130,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
                     
                     k += 4;
                     
-                    subPosLookupRecords = malloc(sizeof(SubPosLookupRecord) * subPosCount);
+                    subPosLookupRecords = SFArenaAllocate(arena, sizeof(SubPosLookupRecord) * subPosCount);
                     for (l = 0; l < subPosCount; l++) {
                         SFUShort beginOffset = k + (l * 4);
                         
@@ -172,7 +172,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
             printf("\n        Offset: %d", coverageOffset);
 #endif
             
-            SFReadCoverageTable(&csTable[coverageOffset], &tablePtr->format.format2.coverage);
+            SFReadCoverageTable(&csTable[coverageOffset], &tablePtr->format.format2.coverage, arena);
             
             classDefOffset = SFReadUShort(csTable, 4);
             
@@ -181,7 +181,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
             printf("\n        Offset: %d", classDefOffset);
 #endif
             
-            SFReadClassDefTable(&csTable[classDefOffset], &tablePtr->format.format2.classDef);
+            SFReadClassDefTable(&csTable[classDefOffset], &tablePtr->format.format2.classDef, arena);
             
             subPosClassSetCount = SFReadUShort(csTable, 6);
             
@@ -189,7 +189,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
             printf("\n       Total SubPos Class Sets: %d", subPosClassSetCount);
 #endif
             
-            subPosRuleSetTables = malloc(sizeof(SubPosClassSetSubtable) * subPosClassSetCount);
+            subPosRuleSetTables = SFArenaAllocate(arena, sizeof(SubPosClassSetSubtable) * subPosClassSetCount);
             
             for (i = 0; i < subPosClassSetCount; i++) {
                 SFUShort subPosClassSetOffset;
@@ -217,7 +217,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
                 printf("\n        Total SubPos Class Rules: %d", subPosClassRuleCount);
 #endif
                 
-                subPosRuleTables = malloc(sizeof(SubPosClassRuleTable) * subPosClassRuleCount);
+                subPosRuleTables = SFArenaAllocate(arena, sizeof(SubPosClassRuleTable) * subPosClassRuleCount);
                 
                 for (j = 0; j < subPosClassRuleCount; j++) {
                     SFUShort subPosClassRuleOffset;
@@ -248,7 +248,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
                     printf("\n         Total Lookup Records: %d", subPosCount);
 #endif
                     
-                    classes = malloc(sizeof(SFUShort) * glyphCount);
+                    classes = SFArenaAllocate(arena, sizeof(SFUShort) * glyphCount);
                     classes[0] = 0;
                     
                     for (k = 0; k < glyphCount; k++) {
@@ -263,7 +263,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
                     
                     k += 4;
                     
-                    subPosLookupRecords = malloc(sizeof(SubPosLookupRecord) * subPosCount);
+                    subPosLookupRecords = SFArenaAllocate(arena, sizeof(SubPosLookupRecord) * subPosCount);
                     for (l = 0; l < subPosCount; l++) {
                         SFUShort beginOffset = k + (l * 4);
                         
@@ -310,7 +310,7 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
             tablePtr->format.format3.glyphCount = glyphCount;
             tablePtr->format.format3.subPosCount = subPosCount;
             
-            coverageTables = malloc(sizeof(CoverageTable) * glyphCount);
+            coverageTables = SFArenaAllocate(arena, sizeof(CoverageTable) * glyphCount);
             
             for (i = 0; i < glyphCount; i++) {
                 SFUShort coverageOffset = SFReadUShort(csTable, 6 + (i * 2));
@@ -320,12 +320,12 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
                 printf("\n        Offset: %d", coverageOffset);
 #endif
                 
-                SFReadCoverageTable(&csTable[coverageOffset], &coverageTables[i]);
+                SFReadCoverageTable(&csTable[coverageOffset], &coverageTables[i], arena);
             }
             
             tablePtr->format.format3.coverage = coverageTables;
             
-            subPosLookupRecords = malloc(sizeof(SubPosLookupRecord) * subPosCount);
+            subPosLookupRecords = SFArenaAllocate(arena, sizeof(SubPosLookupRecord) * subPosCount);
             for (j = 0; j < subPosCount; j++) {
                 SFUShort beginOffset = 8 + (j * 4);
                 
@@ -346,58 +346,25 @@ void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *t
     }
 }
 
-void SFFreeContextSubPos(ContextSubPosSubtable *tablePtr) {
-	int i;
-
+//Adds the glyphs the first input glyph of the subtable can be.
+void SFAddContextSubPosToDigest(SFGlyphDigest *digest, ContextSubPosSubtable *tablePtr) {
     switch (tablePtr->subPosFormat) {
 #ifdef GSUB_GPOS_CONTEXT_FORMAT1
         case 1:
-        {
-            SFFreeCoverageTable(&tablePtr->format.format1.coverage);
-            
-            for (i = 0; i < tablePtr->format.format1.subPosRuleSetCount; i++) {
-                for (int j = 0; j < tablePtr->format.format1.subPosRuleSet[i].subPosRuleCount; j++) {
-                    free(tablePtr->format.format1.subPosRuleSet[i].subPosRule[j].input);
-                    free(tablePtr->format.format1.subPosRuleSet[i].subPosRule[j].subPosLookupRecord);
-                }
-                
-                free(tablePtr->format.format1.subPosRuleSet[i].subPosRule);
-            }
-            
-            free(tablePtr->format.format1.subPosRuleSet);
-        }
+            SFAddCoverageToDigest(digest, &tablePtr->format.format1.coverage);
             break;
 #endif
             
 #ifdef GSUB_GPOS_CONTEXT_FORMAT2
         case 2:
-        {
-            SFFreeCoverageTable(&tablePtr->format.format2.coverage);
-            
-            for (i = 0; i < tablePtr->format.format2.subPosClassSetCount; i++) {
-                for (int j = 0; j < tablePtr->format.format2.subPosClassSet[i].subPosClassRuleCount; j++) {
-                    free(tablePtr->format.format2.subPosClassSet[i].subPosClassRule[j].cls);
-                    free(tablePtr->format.format2.subPosClassSet[i].subPosClassRule[j].subPosLookupRecord);
-                }
-                
-                free(tablePtr->format.format2.subPosClassSet[i].subPosClassRule);
-            }
-            
-            SFFreeClassDefTable(&tablePtr->format.format2.classDef);
-            free(tablePtr->format.format2.subPosClassSet);
-        }
+            SFAddCoverageToDigest(digest, &tablePtr->format.format2.coverage);
             break;
 #endif
             
 #ifdef GSUB_GPOS_CONTEXT_FORMAT3
         case 3:
-        {
-            for (i = 0; i < tablePtr->format.format3.glyphCount; i++)
-                SFFreeCoverageTable(&tablePtr->format.format3.coverage[i]);
-            
-            free(tablePtr->format.format3.coverage);
-            free(tablePtr->format.format3.subPosLookupRecord);
-        }
+            if (tablePtr->format.format3.glyphCount)
+                SFAddCoverageToDigest(digest, &tablePtr->format.format3.coverage[0]);
             break;
 #endif
     }
@@ -408,7 +375,7 @@ void SFFreeContextSubPos(ContextSubPosSubtable *tablePtr) {
 
 #ifdef GSUB_GPOS_CHAINING_CONTEXT
 
-void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContextualSubPosSubtable *tablePtr) {
+void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContextualSubPosSubtable *tablePtr, SFArena *arena) {
     SFUShort subPosFormat = SFReadUShort(ccsTable, 0);
     tablePtr->subPosFormat = subPosFormat;
     
@@ -435,7 +402,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
             printf("\n       Coverage Table:");
             printf("\n        Offset: %d", coverageOffset);
 #endif
-            SFReadCoverageTable(&ccsTable[coverageOffset], &tablePtr->format.format1.coverage);
+            SFReadCoverageTable(&ccsTable[coverageOffset], &tablePtr->format.format1.coverage, arena);
             
             chainSubPosRuleSetCount = SFReadUShort(ccsTable, 4);
             
@@ -444,7 +411,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
 #endif
             tablePtr->format.format1.chainSubPosRuleSetCount = chainSubPosRuleSetCount;
             
-            chainSubPosRuleSetTables = malloc(sizeof(ChainSubPosRuleSetTable) * chainSubPosRuleSetCount);
+            chainSubPosRuleSetTables = SFArenaAllocate(arena, sizeof(ChainSubPosRuleSetTable) * chainSubPosRuleSetCount);
             
             for (i = 0; i < chainSubPosRuleSetCount; i++) {
                 SFUShort chainSubPosRuleSetOffset;
@@ -470,7 +437,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                 printf("\n        Total Chain Sub Rule Tables: %d", chainSubPosRuleCount);
 #endif
                 
-                chainSubPosRuleTables = malloc(sizeof(ChainSubPosRuleSubtable) * chainSubPosRuleCount);
+                chainSubPosRuleTables = SFArenaAllocate(arena, sizeof(ChainSubPosRuleSubtable) * chainSubPosRuleCount);
                 
                 for (j = 0; j < chainSubPosRuleCount; j++) {
                     SFUShort chainSubPosRuleOffset;
@@ -505,7 +472,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                     printf("\n         Total Backtrack Glyphs: %d", backtrackGlyphCount);
 #endif
                     
-                    backtrackGlyphs = malloc(sizeof(SFGlyph) * backtrackGlyphCount);
+                    backtrackGlyphs = SFArenaAllocate(arena, sizeof(SFGlyph) * backtrackGlyphCount);
                     
                     for (k = 0; k < backtrackGlyphCount; k++) {
                         backtrackGlyphs[k] = SFReadUShort(csrTable, 2 + (k * 2));
@@ -525,7 +492,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                     printf("\n         Total Input Glyphs: %d", inputGlyphCount);
 #endif
                     
-                    inputGlyphs = malloc(sizeof(SFGlyph) * inputGlyphCount);
+                    inputGlyphs = SFArenaAllocate(arena, sizeof(SFGlyph) * inputGlyphCount);
                     inputGlyphs[0] = 0;
                     
                     k += 2;
@@ -547,7 +514,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                     printf("\n         Total Lookahead Glyphs: %d", lookaheadGlyphCount);
 #endif
                     
-                    lookaheadGlyphs = malloc(sizeof(SFGlyph) * lookaheadGlyphCount);
+                    lookaheadGlyphs = SFArenaAllocate(arena, sizeof(SFGlyph) * lookaheadGlyphCount);
                     
                     k += 2;
                     for (m = 0; m < lookaheadGlyphCount; m++) {
@@ -567,7 +534,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                     printf("\n         Total SubPositute Lookup Records: %d", subPosCount);
 #endif
                     
-                    subPosLookupRecords = malloc(sizeof(SubPosLookupRecord) * subPosCount);
+                    subPosLookupRecords = SFArenaAllocate(arena, sizeof(SubPosLookupRecord) * subPosCount);
                     
                     for (n = 0; n < subPosCount; l++) {
                         SFUShort beginOffset = k + (n * 4);
@@ -613,7 +580,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
             printf("\n        Offset: %d", coverageOffset);
 #endif
             
-            SFReadCoverageTable(&ccsTable[coverageOffset], &tablePtr->format.format2.coverage);
+            SFReadCoverageTable(&ccsTable[coverageOffset], &tablePtr->format.format2.coverage, arena);
             
             backtrackClassDefOffset = SFReadUShort(ccsTable, 4);
             
@@ -622,7 +589,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
             printf("\n        Offset: %d", backtrackClassDefOffset);
 #endif
             
-            SFReadClassDefTable(&ccsTable[backtrackClassDefOffset], &tablePtr->format.format2.backtrackClassDef);
+            SFReadClassDefTable(&ccsTable[backtrackClassDefOffset], &tablePtr->format.format2.backtrackClassDef, arena);
             
             inputClassDefOffset = SFReadUShort(ccsTable, 6);
             
@@ -631,7 +598,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
             printf("\n        Offset: %d", inputClassDefOffset);
 #endif
             
-            SFReadClassDefTable(&ccsTable[inputClassDefOffset], &tablePtr->format.format2.inputClassDef);
+            SFReadClassDefTable(&ccsTable[inputClassDefOffset], &tablePtr->format.format2.inputClassDef, arena);
             
             lookaheadClassDefOffset = SFReadUShort(ccsTable, 8);
             
@@ -640,7 +607,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
             printf("\n        Offset: %d", lookaheadClassDefOffset);
 #endif
             
-            SFReadClassDefTable(&ccsTable[lookaheadClassDefOffset], &tablePtr->format.format2.lookaheadClassDef);
+            SFReadClassDefTable(&ccsTable[lookaheadClassDefOffset], &tablePtr->format.format2.lookaheadClassDef, arena);
             
             chainSubPosClassSetCount = SFReadUShort(ccsTable, 10);
             
@@ -648,7 +615,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
             printf("\n       Total Chain Sub Class Sets: %d", chainSubPosClassSetCount);
 #endif
             
-            chainSubPosClassSets = malloc(sizeof(ChainSubPosClassSetSubtable) * chainSubPosClassSetCount);
+            chainSubPosClassSets = SFArenaAllocate(arena, sizeof(ChainSubPosClassSetSubtable) * chainSubPosClassSetCount);
             
             for (i = 0; i < chainSubPosClassSetCount; i++) {
                 SFUShort chainSubPosClassSetOffset;
@@ -674,7 +641,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                 printf("\n        Total Chain Sub Class Rules: %d", chainSubPosClassRuleCount);
 #endif
                 
-                chainSubPosClassRuleTables = malloc(sizeof(ChainSubPosClassRuleTable) * chainSubPosClassRuleCount);
+                chainSubPosClassRuleTables = SFArenaAllocate(arena, sizeof(ChainSubPosClassRuleTable) * chainSubPosClassRuleCount);
                 
                 for (j = 0; j < chainSubPosClassRuleCount; j++) {
                     SFUShort chainSubPosClassRuleOffset;
@@ -709,7 +676,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                     printf("\n         Total Backtrack Glyphs: %d", backtrackGlyphCount);
 #endif
                     
-                    backtrackGlyphs = malloc(sizeof(SFGlyph) * backtrackGlyphCount);
+                    backtrackGlyphs = SFArenaAllocate(arena, sizeof(SFGlyph) * backtrackGlyphCount);
                     
                     for (k = 0; k < backtrackGlyphCount; k++) {
                         backtrackGlyphs[k] = SFReadUShort(cscrTable, 2 + (k * 2));
@@ -729,7 +696,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                     printf("\n         Total Input Glyphs: %d", inputGlyphCount);
 #endif
                     
-                    inputGlyphs = malloc(sizeof(SFGlyph) * inputGlyphCount);
+                    inputGlyphs = SFArenaAllocate(arena, sizeof(SFGlyph) * inputGlyphCount);
                     inputGlyphs[0] = 0;
                     
                     k += 2;
@@ -751,7 +718,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                     printf("\n         Total Lookahead Glyphs: %d", lookaheadGlyphCount);
 #endif
                     
-                    lookaheadGlyphs = malloc(sizeof(SFGlyph) * lookaheadGlyphCount);
+                    lookaheadGlyphs = SFArenaAllocate(arena, sizeof(SFGlyph) * lookaheadGlyphCount);
                     
                     k += 2;
                     for (m = 0; m < lookaheadGlyphCount; m++) {
@@ -771,7 +738,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                     printf("\n         Total SubPositute Lookup Records: %d", subPosCount);
 #endif
                     
-                    subPosLookupRecords = malloc(sizeof(SubPosLookupRecord) * subPosCount);
+                    subPosLookupRecords = SFArenaAllocate(arena, sizeof(SubPosLookupRecord) * subPosCount);
                     
                     for (n = 0; n < subPosCount; l++) {
                         SFUShort beginOffset = k + (n * 4);
@@ -821,7 +788,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
             printf("\n       Total Backtrack Glyphs: %d", backtrackGlyphCount);
 #endif
             
-            backtrackCoverageTables = malloc(sizeof(CoverageTable) * backtrackGlyphCount);
+            backtrackCoverageTables = SFArenaAllocate(arena, sizeof(CoverageTable) * backtrackGlyphCount);
             
             for (i = 0; i < backtrackGlyphCount; i++) {
                 SFUShort coverageOffset = SFReadUShort(ccsTable, 4 + (i * 2));
@@ -831,7 +798,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                 printf("\n         Offset: %d", coverageOffset);
                 
 #endif
-                SFReadCoverageTable(&ccsTable[coverageOffset], &backtrackCoverageTables[i]);
+                SFReadCoverageTable(&ccsTable[coverageOffset], &backtrackCoverageTables[i], arena);
             }
             i = (4 + (i * 2));
             
@@ -844,7 +811,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
             printf("\n       Total Input Glyphs: %d", inputGlyphCount);
 #endif
             
-            inputCoverageTables = malloc(sizeof(CoverageTable) * inputGlyphCount);
+            inputCoverageTables = SFArenaAllocate(arena, sizeof(CoverageTable) * inputGlyphCount);
             
             i += 2;
             
@@ -856,7 +823,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                 printf("\n         Offset: %d", coverageOffset);
 #endif
                 
-                SFReadCoverageTable(&ccsTable[coverageOffset], &inputCoverageTables[j]);
+                SFReadCoverageTable(&ccsTable[coverageOffset], &inputCoverageTables[j], arena);
             }
             i += (j * 2);
             
@@ -869,7 +836,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
             printf("\n       Total Lookahead Glyphs: %d", lookaheadGlyphCount);
 #endif
             
-            lookaheadCoverageTables = malloc(sizeof(CoverageTable) * lookaheadGlyphCount);
+            lookaheadCoverageTables = SFArenaAllocate(arena, sizeof(CoverageTable) * lookaheadGlyphCount);
             
             i += 2;
             
@@ -881,7 +848,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
                 printf("\n         Offset: %d", coverageOffset);
                 
 #endif
-                SFReadCoverageTable(&ccsTable[coverageOffset], &lookaheadCoverageTables[k]);
+                SFReadCoverageTable(&ccsTable[coverageOffset], &lookaheadCoverageTables[k], arena);
             }
             i += (k * 2);
             
@@ -890,7 +857,7 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
             subPosCount = SFReadUShort(ccsTable, i);
             tablePtr->format.format3.subPosCount = subPosCount;
             
-            subPosLookupRecords = malloc(sizeof(SubPosLookupRecord) * subPosCount);
+            subPosLookupRecords = SFArenaAllocate(arena, sizeof(SubPosLookupRecord) * subPosCount);
             
 #ifdef LOOKUP_TEST
             printf("\n         Total SubPositute Lookup Records: %d", subPosCount);
@@ -917,76 +884,25 @@ void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContext
     }
 }
 
-void SFFreeChainingContextSubPos(ChainingContextualSubPosSubtable *tablePtr) {
-	int i;
-
+//Adds the glyphs the first input glyph of the subtable can be.
+void SFAddChainingContextSubPosToDigest(SFGlyphDigest *digest, ChainingContextualSubPosSubtable *tablePtr) {
     switch (tablePtr->subPosFormat) {
-            
 #ifdef GSUB_GPOS_CHAINING_CONTEXT_FORMAT1
         case 1:
-        {
-            SFFreeCoverageTable(&tablePtr->format.format1.coverage);
-            
-            for (i = 0; i < tablePtr->format.format1.chainSubPosRuleSetCount; i++) {
-                for (int j = 0; j < tablePtr->format.format1.chainSubPosRuleSet[i].chainSubPosRuleCount; j++) {
-                    free(tablePtr->format.format1.chainSubPosRuleSet[i].chainSubPosRule[j].backtrack);
-                    free(tablePtr->format.format1.chainSubPosRuleSet[i].chainSubPosRule[j].input);
-                    free(tablePtr->format.format1.chainSubPosRuleSet[i].chainSubPosRule[j].lookAhead);
-                    free(tablePtr->format.format1.chainSubPosRuleSet[i].chainSubPosRule[j].subPosLookupRecord);
-                }
-                
-                free(tablePtr->format.format1.chainSubPosRuleSet[i].chainSubPosRule);
-            }
-            
-            free(tablePtr->format.format1.chainSubPosRuleSet);
-        }
+            SFAddCoverageToDigest(digest, &tablePtr->format.format1.coverage);
             break;
 #endif
             
 #ifdef GSUB_GPOS_CHAINING_CONTEXT_FORMAT2
         case 2:
-        {
-            SFFreeCoverageTable(&tablePtr->format.format2.coverage);
-            
-            SFFreeClassDefTable(&tablePtr->format.format2.backtrackClassDef);
-            SFFreeClassDefTable(&tablePtr->format.format2.inputClassDef);
-            SFFreeClassDefTable(&tablePtr->format.format2.lookaheadClassDef);
-            
-            for (i = 0; i < tablePtr->format.format2.chainSubPosClassSetCount; i++) {
-                for (int j = 0; j < tablePtr->format.format2.chainSubPosClassSet[i].chainSubPosClassRuleCount; j++) {
-                    free(tablePtr->format.format2.chainSubPosClassSet[i].chainSubPosClassRule[j].backtrack);
-                    free(tablePtr->format.format2.chainSubPosClassSet[i].chainSubPosClassRule[j].input);
-                    free(tablePtr->format.format2.chainSubPosClassSet[i].chainSubPosClassRule[j].lookAhead);
-                    free(tablePtr->format.format2.chainSubPosClassSet[i].chainSubPosClassRule[j].subPosLookupRecord);
-                }
-                
-                free(tablePtr->format.format2.chainSubPosClassSet[i].chainSubPosClassRule);
-            }
-            
-            free(tablePtr->format.format2.chainSubPosClassSet);
-        }
+            SFAddCoverageToDigest(digest, &tablePtr->format.format2.coverage);
             break;
 #endif
             
 #ifdef GSUB_GPOS_CHAINING_CONTEXT_FORMAT3
         case 3:
-        {
-            for (i = 0; i < tablePtr->format.format3.backtrackGlyphCount; i++)
-                SFFreeCoverageTable(&tablePtr->format.format3.backtrackGlyphCoverage[i]);
-            
-            free(tablePtr->format.format3.backtrackGlyphCoverage);
-            
-            for (i = 0; i < tablePtr->format.format3.inputGlyphCount; i++)
-                SFFreeCoverageTable(&tablePtr->format.format3.inputGlyphCoverage[i]);
-            
-            free(tablePtr->format.format3.inputGlyphCoverage);
-            
-            for (i = 0; i < tablePtr->format.format3.lookaheadGlyphCount; i++)
-                SFFreeCoverageTable(&tablePtr->format.format3.lookaheadGlyphCoverage[i]);
-            
-            free(tablePtr->format.format3.lookaheadGlyphCoverage);
-            free(tablePtr->format.format3.subPosLookupRecord);
-        }
+            if (tablePtr->format.format3.inputGlyphCount)
+                SFAddCoverageToDigest(digest, &tablePtr->format.format3.inputGlyphCoverage[0]);
             break;
 #endif
     }
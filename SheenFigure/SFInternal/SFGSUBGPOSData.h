@@ -117,8 +117,8 @@ typedef struct ContextSubPosSubtable {
     } format;
 } ContextSubPosSubtable;
 
-void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *tablePtr);
-void SFFreeContextSubPos(ContextSubPosSubtable *tablePtr);
+void SFReadContextSubPos(const SFUByte * const csTable, ContextSubPosSubtable *tablePtr, SFArena *arena);
+void SFAddContextSubPosToDigest(SFGlyphDigest *digest, ContextSubPosSubtable *tablePtr);
 
 #endif
 
@@ -246,8 +246,8 @@ typedef struct ChainingContextualSubPosSubtable {
     } format;
 } ChainingContextualSubPosSubtable;
 
-void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContextualSubPosSubtable *tablePtr);
-void SFFreeChainingContextSubPos(ChainingContextualSubPosSubtable *tablePtr);
+void SFReadChainingContextSubPos(const SFUByte * const ccsTable, ChainingContextualSubPosSubtable *tablePtr, SFArena *arena);
+void SFAddChainingContextSubPosToDigest(SFGlyphDigest *digest, ChainingContextualSubPosSubtable *tablePtr);
 
 #endif
 
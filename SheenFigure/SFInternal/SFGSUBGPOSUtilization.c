@@ -22,22 +22,25 @@
 #ifdef GSUB_GPOS_CHAINING_CONTEXT
 
 void SFApplyChainingContextual(SFInternal *internal, ChainingContextualSubPosSubtable *stable, LookupFlag lookupFlag, SFApplyLookupFunction applyLookupFunction) {
-    SFGlyphIndex pidx;              // previous index
-    SFGlyphIndex cidx;              // current index
-    SFGlyphIndex nidx;              // next index
+    int pidx;                       // previous index
+    int cidx;                       // current index
+    int nidx;                       // next index
     
-	SFGlyphIndex *inputIndexes;
+	SFScratchMark mark;
+	int *inputIndexes;
     
-    if (stable->subPosFormat != 3)
+    if (stable->subPosFormat != 3 || !SFGetTotalGlyphCount(internal))
         return;
     
-    cidx = SFMakeGlyphIndex(0, 0);
+    cidx = 0;
     if (SFIsIgnoredGlyph(internal, cidx, lookupFlag)) {
         if (!SFGetNextValidGlyphIndex(internal, &cidx, lookupFlag))
             return;
     }
     
-    inputIndexes = malloc(sizeof(SFGlyphIndex) * stable->format.format3.inputGlyphCount);
+    //Nested lookups push above the input indexes, so they stay valid while the lookups are applied.
+    mark = SFScratchGetMark(internal->scratch);
+    inputIndexes = SFScratchPush(internal->scratch, sizeof(int) * stable->format.format3.inputGlyphCount);
     
     do {
         int coverageIndex;
@@ -53,7 +56,7 @@ void SFApplyChainingContextual(SFInternal *internal, ChainingContextualSubPosSub
         
         // loop to check input glyphs.
         for (i = 1, j = 0; i < stable->format.format3.inputGlyphCount; i++) {
-            SFGlyphIndex tmpIndex;
+            int tmpIndex;
             SFGlyph currentGlyph;
             
             tmpIndex = inputIndexes[j];
@@ -114,8 +117,14 @@ void SFApplyChainingContextual(SFInternal *internal, ChainingContextualSubPosSub
         // finally all conditions are satisfied, so we apply substitution/positioning here.
         for (i = 0; i < stable->format.format3.subPosCount; i++) {
             SubPosLookupRecord currentRecord = stable->format.format3.subPosLookupRecord[i];
+            int glyphCount = SFGetTotalGlyphCount(internal);
             
-            (*applyLookupFunction)(internal, internal->gsub->lookupList.lookupTables[currentRecord.lookupListIndex], inputIndexes[currentRecord.sequenceIndex], inputIndexes[stable->format.format3.inputGlyphCount - 1]);
+            (*applyLookupFunction)(internal, currentRecord.lookupListIndex, inputIndexes[currentRecord.sequenceIndex], inputIndexes[stable->format.format3.inputGlyphCount - 1]);
+            
+            //Glyphs added by the lookup move the input glyphs after the one it was applied at.
+            glyphCount = SFGetTotalGlyphCount(internal) - glyphCount;
+            for (j = currentRecord.sequenceIndex + 1; glyphCount && j < stable->format.format3.inputGlyphCount; j++)
+                inputIndexes[j] += glyphCount;
         }
         
         cidx = inputIndexes[stable->format.format3.inputGlyphCount - 1];
@@ -127,7 +136,7 @@ void SFApplyChainingContextual(SFInternal *internal, ChainingContextualSubPosSub
     } while (SFGetNextValidGlyphIndex(internal, &cidx, lookupFlag));
     
 exit:
-	free(inputIndexes);
+	SFScratchRewind(internal->scratch, mark);
 }
 
 #endif
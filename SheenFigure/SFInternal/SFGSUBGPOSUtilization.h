@@ -19,7 +19,7 @@
 
 #include "SFInternal.h"
 
-typedef void (*SFApplyLookupFunction)(SFInternal *internal, LookupTable lookup, SFGlyphIndex sindex, SFGlyphIndex eindex);
+typedef void (*SFApplyLookupFunction)(SFInternal *internal, SFUShort lookupIndex, int sindex, int eindex);
 
 #ifdef GSUB_GPOS_CHAINING_CONTEXT
 
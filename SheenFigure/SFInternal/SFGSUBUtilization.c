@@ -285,40 +285,7 @@ static const SFUInt ARABIC_LETTERS[] =
     FOUR_PART_LETTER, /* 06FF; KNOTTED HEH WITH INVERTED V ABOVE; D; KNOTTED HEH */
 };
 
-#define GSUB_FEATURE_TAGS 8
-static unsigned char gsubFeaturesTagOrder[GSUB_FEATURE_TAGS][5] = {
-    "ccmp",
-    "init",
-    "medi",
-    "fina",
-    "isol",
-    "rlig",
-    "calt",
-    "liga",
-};
-
-typedef enum {
-    stInit,
-    stMedi,
-    stFina,
-    stOther,
-} ShortTag;
-
-static void SFApplyGSUBLookup(SFInternal *internal, LookupTable lookup, SFGlyphIndex sidx, SFGlyphIndex eidx);
-
-static ShortTag getShortTag(const unsigned char tag[5]) {
-    ShortTag stag = stOther;
-    if (tag) {
-        if (tag[0] == 'i' && tag[1] == 'n' && tag[2] == 'i' && tag[3] == 't')
-            stag = stInit;
-        else if (tag[0] == 'm' && tag[1] == 'e' && tag[2] == 'd' && tag[3] == 'i')
-            stag = stMedi;
-        else if (tag[0] == 'f' && tag[1] == 'i' && tag[2] == 'n' && tag[3] == 'a')
-            stag = stFina;
-    }
-    
-    return stag;
-}
+static void SFApplyGSUBLookupAtIndex(SFInternal *internal, SFUShort lookupIndex, int sidx, int eidx);
 
 static void applyArabicSubstitution(SFInternal *internal, void *stable, LookupFlag lookupFlag, LookupType type, short stag) {
     CoverageTable coverage;
@@ -405,7 +372,7 @@ static void applyArabicSubstitution(SFInternal *internal, void *stable, LookupFl
     
 #define GET_NEXT_VALUES()                                                                       \
     for (; ni < SFGetCharCount(internal); ni++) {                                              \
-        if (!SFIsIgnoredGlyph(internal, SFMakeGlyphIndex(ni, 0), lookupFlag)) {                \
+        if (!SFIsIgnoredGlyph(internal, SFGetFirstGlyphOfChar(internal, ni), lookupFlag)) {    \
             break;                                                                              \
         }                                                                                       \
     }                                                                                           \
@@ -414,7 +381,7 @@ static void applyArabicSubstitution(SFInternal *internal, void *stable, LookupFl
         SET_NULL_VALUES();                                                                      \
     } else {                                                                                    \
         tnl = GET_TYPE_OF_LETTER(SFGetChar(internal, ni));                                     \
-        nextIndex = SFGetIndexOfGlyphInCoverage(&coverage, internal->record->charRecord[ni].gRec[0].glyph);\
+        nextIndex = SFGetIndexOfGlyphInCoverage(&coverage, SFGetGlyph(internal, SFGetFirstGlyphOfChar(internal, ni)));\
     }
     
     GET_NEXT_VALUES();
@@ -443,11 +410,11 @@ static void applyArabicSubstitution(SFInternal *internal, void *stable, LookupFl
 
             if (type == ltsSingle) {
                 if (singleSubst->substFormat == 1)
-                    internal->record->charRecord[i].gRec[0].glyph += singleSubst->format.format1.deltaGlyphID;
+                    SFGetGlyph(internal, SFGetFirstGlyphOfChar(internal, i)) += singleSubst->format.format1.deltaGlyphID;
                 else if (singleSubst->substFormat == 2)
-                    internal->record->charRecord[i].gRec[0].glyph = singleSubst->format.format2.substitute[currentIndex];
+                    SFGetGlyph(internal, SFGetFirstGlyphOfChar(internal, i)) = SFUShortArrayGet(singleSubst->format.format2.substitute, currentIndex);
                 
-                internal->record->charRecord[i].gRec[0].glyphProp = gpNotReceived;
+                SFGetGlyphProperties(internal, SFGetFirstGlyphOfChar(internal, i)) = gpNotReceived;
             }
 #endif
 
@@ -459,16 +426,11 @@ static void applyArabicSubstitution(SFInternal *internal, void *stable, LookupFl
 #endif
             if (type == ltsMultiple) {
                 if (multipleSubst->sequence[currentIndex].glyphCount == 1) {
-                    internal->record->charRecord[i].gRec[0].glyph = multipleSubst->sequence[currentIndex].substitute[0];
+                    SFGetGlyph(internal, SFGetFirstGlyphOfChar(internal, i)) = SFUShortArrayGet(multipleSubst->sequence[currentIndex].substitute, 0);
                     
-                    internal->record->charRecord[i].gRec[0].glyphProp = gpNotReceived;
+                    SFGetGlyphProperties(internal, SFGetFirstGlyphOfChar(internal, i)) = gpNotReceived;
                 } else {
-                    int length;
-                    
-                    SFInsertGlyphs(&internal->record->charRecord[i].gRec, multipleSubst->sequence[currentIndex].substitute, 1, multipleSubst->sequence[currentIndex].glyphCount, 0, &length);
-                    
-                    internal->record->glyphCount += length - internal->record->charRecord[i].glyphCount;
-                    internal->record->charRecord[i].glyphCount = length;
+                    SFReplaceGlyph(internal->record, SFGetFirstGlyphOfChar(internal, i), multipleSubst->sequence[currentIndex].substitute, multipleSubst->sequence[currentIndex].glyphCount);
                 }
             }
 #endif
@@ -480,8 +442,8 @@ static void applyArabicSubstitution(SFInternal *internal, void *stable, LookupFl
 #define GSUB_ELSE
 #endif
             if (type == ltsAlternate) {
-                internal->record->charRecord[i].gRec[0].glyph = alternateSubst->alternateSet[currentIndex].substitute[0];
-                internal->record->charRecord[i].gRec[0].glyphProp = gpNotReceived;
+                SFGetGlyph(internal, SFGetFirstGlyphOfChar(internal, i)) = SFUShortArrayGet(alternateSubst->alternateSet[currentIndex].substitute, 0);
+                SFGetGlyphProperties(internal, SFGetFirstGlyphOfChar(internal, i)) = gpNotReceived;
             }
 #endif
         }
@@ -501,51 +463,27 @@ static void applyArabicSubstitution(SFInternal *internal, void *stable, LookupFl
 
 #ifdef GSUB_SINGLE
 
-static void SFApplySingleSubstitution(SFInternal *internal, SingleSubstSubtable *stable, LookupFlag lookupFlag, const unsigned char tag[5], SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    ShortTag stag = getShortTag(tag);
+static void SFApplySingleSubstitution(SFInternal *internal, SingleSubstSubtable *stable, LookupFlag lookupFlag, ShortTag stag, int sidx, int eidx) {
     if (stag == stOther) {
         int cidx;                   // coverage index
-        int gidx;                   // end glyph index
         
-        for (; ;) {
-            if (sidx.record < eidx.record) {
-                if (SFIsOddLevel(internal, sidx.record)) {
-                    goto continue_loop;
-                }
-                
-                gidx = SFGetGlyphCount(internal, sidx.record);
-            } else if (sidx.record == eidx.record) {
-                if (SFIsOddLevel(internal, sidx.record)) {
-                    break;
-                }
-                
-                gidx = eidx.glyph + 1;
-            } else {
-                break;
-            }
+        for (; sidx <= eidx; sidx++) {
+            if (SFIsGlyphOfOddLevel(internal, sidx) || SFIsIgnoredGlyph(internal, sidx, lookupFlag))
+                continue;
             
-            for (; sidx.glyph < gidx; sidx.glyph++) {
-                if (SFIsIgnoredGlyph(internal, sidx, lookupFlag))
-                    continue;
-                
-                cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
-                if (cidx != UNDEFINED_INDEX) {
-                    if (stable->substFormat == 1) {
-                        SFGetGlyph(internal, sidx) += stable->format.format1.deltaGlyphID;
-                    } else if (stable->substFormat == 2) {
-                        SFGetGlyph(internal, sidx) = stable->format.format2.substitute[cidx];
-                    }
-                    
-                    SFGetGlyphProperties(internal, sidx) = gpNotReceived;
+            cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
+            if (cidx != UNDEFINED_INDEX) {
+                if (stable->substFormat == 1) {
+                    SFGetGlyph(internal, sidx) += stable->format.format1.deltaGlyphID;
+                } else if (stable->substFormat == 2) {
+                    SFGetGlyph(internal, sidx) = SFUShortArrayGet(stable->format.format2.substitute, cidx);
                 }
+                
+                SFGetGlyphProperties(internal, sidx) = gpNotReceived;
             }
-            
-        continue_loop:
-            sidx.record++;
-            sidx.glyph = 0;
         }
     } else {
-        applyArabicSubstitution(internal, stable, lookupFlag | lfIgnoreMarks, ltsSingle, stag);
+        applyArabicSubstitution(internal, stable, lookupFlag, ltsSingle, stag);
     }
 }
 
@@ -553,59 +491,35 @@ static void SFApplySingleSubstitution(SFInternal *internal, SingleSubstSubtable
 
 #ifdef GSUB_MULTIPLE
 
-static void SFApplyMultipleSubstitution(SFInternal *internal, MultipleSubstSubtable *stable, LookupFlag lookupFlag, unsigned char tag[5], SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    ShortTag stag;
-    
+static void SFApplyMultipleSubstitution(SFInternal *internal, MultipleSubstSubtable *stable, LookupFlag lookupFlag, ShortTag stag, int sidx, int eidx) {
     if (!SFGetCharCount(internal))
         return;
     
-    stag = getShortTag(tag);
     if (stag == stOther) {
         int cidx;                   // coverage index
-        int gidx;                   // end glyph index
         
-        for (; ;) {
-            if (sidx.record < eidx.record) {
-                if (SFIsOddLevel(internal, sidx.record)) {
-                    goto continue_loop;
-                }
-                
-                gidx = SFGetGlyphCount(internal, sidx.record);
-            } else if (sidx.record == eidx.record) {
-                if (SFIsOddLevel(internal, sidx.record)) {
-                    break;
-                }
-                
-                gidx = eidx.glyph + 1;
-            } else {
-                break;
-            }
+        for (; sidx <= eidx; sidx++) {
+            if (SFIsGlyphOfOddLevel(internal, sidx) || SFIsIgnoredGlyph(internal, sidx, lookupFlag))
+                continue;
             
-            for (; sidx.glyph < gidx; sidx.glyph++) {
-                if (SFIsIgnoredGlyph(internal, sidx, lookupFlag))
-                    continue;
-                
-                cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
-                if (cidx != UNDEFINED_INDEX) {
-                    if (stable->sequence[cidx].glyphCount == 1) {
-                        SFGetGlyph(internal, sidx) = stable->sequence[cidx].substitute[0];
-                        SFGetGlyphProperties(internal, sidx) = gpNotReceived;
-                    } else {
-                        int length;
-                        SFInsertGlyphs(&SFGetGlyphRecord(internal, sidx.record), stable->sequence[cidx].substitute, SFGetGlyphCount(internal, sidx.record), stable->sequence[cidx].glyphCount, sidx.glyph, &length);
-                        
-                        SFGetTotalGlyphCount(internal) += length - SFGetGlyphCount(internal, sidx.record);
-                        SFGetGlyphCount(internal, sidx.record) = length;
-                    }
+            cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
+            if (cidx != UNDEFINED_INDEX) {
+                if (stable->sequence[cidx].glyphCount == 1) {
+                    SFGetGlyph(internal, sidx) = SFUShortArrayGet(stable->sequence[cidx].substitute, 0);
+                    SFGetGlyphProperties(internal, sidx) = gpNotReceived;
+                } else if (stable->sequence[cidx].glyphCount > 1) {
+                    int addedCount = stable->sequence[cidx].glyphCount - 1;
+                    
+                    SFReplaceGlyph(internal->record, sidx, stable->sequence[cidx].substitute, stable->sequence[cidx].glyphCount);
+                    
+                    //The glyphs of the sequence are not substituted again.
+                    sidx += addedCount;
+                    eidx += addedCount;
                 }
             }
-            
-        continue_loop:
-            sidx.record++;
-            sidx.glyph = 0;
         }
     } else {
-        applyArabicSubstitution(internal, stable, lookupFlag | lfIgnoreMarks, ltsMultiple, stag);
+        applyArabicSubstitution(internal, stable, lookupFlag, ltsMultiple, stag);
     }
 }
 
@@ -613,42 +527,18 @@ static void SFApplyMultipleSubstitution(SFInternal *internal, MultipleSubstSubta
 
 #ifdef GSUB_ALTERNATE
 
-static void SFApplyAlternateSubstitution(SFInternal *internal, AlternateSubstSubtable *stable, LookupFlag lookupFlag, const unsigned char tag[5], SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    ShortTag stag = getShortTag(tag);
+static void SFApplyAlternateSubstitution(SFInternal *internal, AlternateSubstSubtable *stable, LookupFlag lookupFlag, ShortTag stag, int sidx, int eidx) {
     if (stag == stOther) {
         int cidx;                   // coverage index
-        int gidx;                   // end glyph index
         
-        for (; ;) {
-            if (sidx.record < eidx.record) {
-                if (SFIsOddLevel(internal, sidx.record)) {
-                    goto continue_loop;
-                }
-                
-                gidx = SFGetGlyphCount(internal, sidx.record);
-            } else if (sidx.record == eidx.record) {
-                if (SFIsOddLevel(internal, sidx.record)) {
-                    break;
-                }
-                
-                gidx = eidx.glyph + 1;
-            } else {
-                break;
-            }
-            
-            for (; sidx.glyph < gidx; sidx.glyph++) {
-                if (SFIsIgnoredGlyph(internal, sidx, lookupFlag)) {
-                    continue;
-                }
-                
-                cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
-                if (cidx != UNDEFINED_INDEX)
-                    SFGetGlyph(internal, sidx) = stable->alternateSet[cidx].substitute[0];
+        for (; sidx <= eidx; sidx++) {
+            if (SFIsGlyphOfOddLevel(internal, sidx) || SFIsIgnoredGlyph(internal, sidx, lookupFlag)) {
+                continue;
             }
             
-        continue_loop:
-            sidx.record++;
-            sidx.glyph = 0;
+            cidx = SFGetIndexOfGlyphInCoverage(&stable->coverage, SFGetGlyph(internal, sidx));
+            if (cidx != UNDEFINED_INDEX)
+                SFGetGlyph(internal, sidx) = SFUShortArrayGet(stable->alternateSet[cidx].substitute, 0);
         }
     } else
         applyArabicSubstitution(internal, stable, lookupFlag, ltsAlternate, stag);
@@ -658,8 +548,8 @@ static void SFApplyAlternateSubstitution(SFInternal *internal, AlternateSubstSub
 
 #ifdef GSUB_LIGATURE
 
-static void SFApplyLigatureSubstitution(SFInternal *internal, LigatureSubstSubtable *stable, LookupFlag lookupFlag, SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    SFGlyphIndex index = sidx;
+static void SFApplyLigatureSubstitution(SFInternal *internal, LigatureSubstSubtable *stable, LookupFlag lookupFlag, int sidx, int eidx) {
+    int index = sidx;
     if (SFIsIgnoredGlyph(internal, index, lookupFlag)) {
         if (!SFGetNextValidGlyphIndex(internal, &index, lookupFlag)) {
             return;
@@ -681,7 +571,8 @@ static void SFApplyLigatureSubstitution(SFInternal *internal, LigatureSubstSubta
         
         //Loop to match any of the ligature table with current glyphs.
         for (i = 0; i < currentLigSet.ligatureCount; i++) {
-			SFGlyphIndex *inputIndexes = malloc(sizeof(SFGlyphIndex) * currentLigSet.ligature[i].compCount);
+			SFScratchMark mark = SFScratchGetMark(internal->scratch);
+			int *inputIndexes = SFScratchPush(internal->scratch, sizeof(int) * currentLigSet.ligature[i].compCount);
 
             int inputIndexesCount;
             int j = 1, k = 0, l = 1;
@@ -691,11 +582,11 @@ static void SFApplyLigatureSubstitution(SFInternal *internal, LigatureSubstSubta
             
             //Loop to match next required glyphs.
             for (; j < currentLigSet.ligature[i].compCount; j++) {
-                SFGlyphIndex tmpIndex = inputIndexes[k];
+                int tmpIndex = inputIndexes[k];
                 if (!SFGetNextValidGlyphIndex(internal, &tmpIndex, lookupFlag))
                     goto continue_parent_loop;
                 
-                if (SFGetGlyph(internal, tmpIndex) != currentLigSet.ligature[i].component[j])
+                if (SFGetGlyph(internal, tmpIndex) != SFUShortArrayGet(currentLigSet.ligature[i].component, j - 1))
                     goto continue_parent_loop;
                 
                 inputIndexes[++k] = tmpIndex;
@@ -707,34 +598,31 @@ static void SFApplyLigatureSubstitution(SFInternal *internal, LigatureSubstSubta
             
             for (; l < inputIndexesCount; l++) {
                 SFGetGlyph(internal, inputIndexes[l]) = 0;
-                SFGetTotalGlyphCount(internal) -= 1;
             }
             
             index = inputIndexes[l - 1];
 
-			free(inputIndexes);
+			SFScratchRewind(internal->scratch, mark);
             break;
             
         continue_parent_loop:
             {
-				free(inputIndexes);
+				SFScratchRewind(internal->scratch, mark);
             }
         }
     } while (SFGetNextValidGlyphIndex(internal, &index, lookupFlag)
-             && SFCompareGlyphIndex(index, eidx) <= 0);
+             && index <= eidx);
 }
 
 #endif
 
-static void SFApplyGSUBLookupWithFeatureTag(SFInternal *internal, LookupTable lookup, unsigned char featureTag[5], SFGlyphIndex sidx, SFGlyphIndex eidx) {
-	int i = 0;
+static void SFApplyGSUBSubtable(SFInternal *internal, LookupTable *lookup, int subtableIndex, LookupFlag lookupFlag, ShortTag stag, int sidx, int eidx) {
+    void *subtable = lookup->subtables[subtableIndex];
 
 #ifdef GSUB_SINGLE
     
-    if (lookup.lookupType == ltsSingle) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplySingleSubstitution(internal, lookup.subtables[i], lookup.lookupFlag, featureTag, sidx, eidx);
-    }
+    if (lookup->lookupType == ltsSingle)
+        SFApplySingleSubstitution(internal, subtable, lookupFlag, stag, sidx, eidx);
     
 #define GSUB_ELSE
     
@@ -748,10 +636,8 @@ static void SFApplyGSUBLookupWithFeatureTag(SFInternal *internal, LookupTable lo
 #define GSUB_ELSE
 #endif
 
-    if (lookup.lookupType == ltsAlternate) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplyAlternateSubstitution(internal, lookup.subtables[i], lookup.lookupFlag, featureTag, sidx, eidx);
-    }
+    if (lookup->lookupType == ltsAlternate)
+        SFApplyAlternateSubstitution(internal, subtable, lookupFlag, stag, sidx, eidx);
     
 #endif
     
@@ -763,10 +649,8 @@ static void SFApplyGSUBLookupWithFeatureTag(SFInternal *internal, LookupTable lo
 #define GSUB_ELSE
 #endif
         
-    if (lookup.lookupType == ltsMultiple) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplyMultipleSubstitution(internal, lookup.subtables[i], lookup.lookupFlag, featureTag, sidx, eidx);
-    }
+    if (lookup->lookupType == ltsMultiple)
+        SFApplyMultipleSubstitution(internal, subtable, lookupFlag, stag, sidx, eidx);
     
 #endif
     
@@ -778,10 +662,8 @@ static void SFApplyGSUBLookupWithFeatureTag(SFInternal *internal, LookupTable lo
 #define GSUB_ELSE
 #endif
     
-    if (lookup.lookupType == ltsLigature) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplyLigatureSubstitution(internal, lookup.subtables[i], lookup.lookupFlag, sidx, eidx);
-    }
+    if (lookup->lookupType == ltsLigature)
+        SFApplyLigatureSubstitution(internal, subtable, lookupFlag, sidx, eidx);
     
 #endif
     
@@ -793,10 +675,8 @@ static void SFApplyGSUBLookupWithFeatureTag(SFInternal *internal, LookupTable lo
 #define GSUB_ELSE
 #endif
         
-    if (lookup.lookupType == ltsChainingContext) {
-        for (; i < lookup.subTableCount; i++)
-            SFApplyChainingContextual(internal, lookup.subtables[i], lookup.lookupFlag, &SFApplyGSUBLookup);
-    }
+    if (lookup->lookupType == ltsChainingContext)
+        SFApplyChainingContextual(internal, subtable, lookupFlag, &SFApplyGSUBLookupAtIndex);
     
 #endif
 
@@ -805,87 +685,46 @@ static void SFApplyGSUBLookupWithFeatureTag(SFInternal *internal, LookupTable lo
 #endif
 }
 
-static void SFApplyGSUBLookup(SFInternal *internal, LookupTable lookup, SFGlyphIndex sidx, SFGlyphIndex eidx) {
-    SFApplyGSUBLookupWithFeatureTag(internal, lookup, NULL, sidx, eidx);
-}
-
-static void SFApplyGSUBFeatureList(SFInternal *internal, int featureIndex) {
-    FeatureTable feature = internal->gsub->featureList.featureRecord[featureIndex].feature;
+static void SFApplyGSUBLookupAtIndex(SFInternal *internal, SFUShort lookupIndex, int sidx, int eidx) {
+    LookupTable *lookup = SFGetGSUBLookup(internal->gsub, lookupIndex, internal->arena);
+    int i;
     
-    SFGlyphIndex sidx;
-    SFGlyphIndex eidx;
-    
-	int i;
+    for (i = 0; i < lookup->subTableCount; i++)
+        SFApplyGSUBSubtable(internal, lookup, i, lookup->lookupFlag, stOther, sidx, eidx);
+}
 
-    sidx.record = 0;
-    sidx.glyph = 0;
+void SFApplyGSUB(SFInternal *internal) {
+    const SFShapePlan *plan = internal->plan;
+    int i, j;
     
-    eidx.record = SFGetCharCount(internal) - 1;
-    eidx.glyph = SFGetGlyphCount(internal, eidx.record);
+    if (!plan->hasGSUBScript)
+        return;
     
-    for (i = 0; i < feature.lookupCount; i++) {
-        LookupTable currentLookup = internal->gsub->lookupList.lookupTables[feature.lookupListIndex[i]];
-        SFApplyGSUBLookupWithFeatureTag(internal, currentLookup, internal->gsub->featureList.featureRecord[featureIndex].featureTag, sidx, eidx);
-    }
-}
-
-static int getIndexOfGSUBFeatureTag(char tag[5]) {
-	int i;
-    for (i = 0; i < GSUB_FEATURE_TAGS; i++) {
-        if (strcmp((const char *)gsubFeaturesTagOrder[i], tag) == 0)
-            return i;
-    }
+    SFUpdateGlyphDigest(internal);
+    SFAddAllGlyphProperties(internal);
     
-    return -1;
-}
-
-void SFApplyGSUB(SFInternal *internal) {
-    SFBool arabScriptFound = SFFalse;
-    int arabScriptIndex;
-    
-	int i;
-    for (i = 0; i < internal->gsub->scriptList.scriptCount; i++) {
-        if (strcmp((const char *)internal->gsub->scriptList.scriptRecord[i].scriptTag, "arab") == 0) {
-            arabScriptFound = SFTrue;
-            arabScriptIndex = i;
-        }
-    }
+    if (!SFGetTotalGlyphCount(internal))
+        return;
     
-    if (arabScriptFound) {
-        int totalFeatures = internal->gsub->scriptList.scriptRecord[arabScriptIndex].script.defaultLangSys.featureCount;
-        
-        int order1[GSUB_FEATURE_TAGS];
+    for (i = 0; i < plan->gsubLookupCount; i++) {
+        const SFPlanLookup *planLookup = &plan->gsubLookups[i];
+        LookupTable *currentLookup = planLookup->lookup;
         
-        int order2Len = 0;
-		int *order2 = malloc(sizeof(int) * totalFeatures);
-
-        for (i = 0; i < GSUB_FEATURE_TAGS; i++)
-            order1[i] = -1;
+        //Lookups and subtables that cannot start at any glyph of the string are skipped.
+        if (!SFDoGlyphDigestsIntersect(&currentLookup->digest, &internal->glyphDigest))
+            continue;
         
-        for (i = 0; i < totalFeatures; i++) {
-            int featureIndex = internal->gsub->scriptList.scriptRecord[arabScriptIndex].script.defaultLangSys.featureIndex[i];
+        for (j = 0; j < currentLookup->subTableCount; j++) {
+            if (!SFDoGlyphDigestsIntersect(&currentLookup->subtableDigests[j], &internal->glyphDigest))
+                continue;
             
-            int val = getIndexOfGSUBFeatureTag((char *)internal->gsub->featureList.featureRecord[featureIndex].featureTag);
-            if (val > -1)
-                order1[val] = featureIndex;
-            else
-                order2[order2Len++] = featureIndex;
-        }
-        
-        for (i = 0; i < GSUB_FEATURE_TAGS; i++) {
-            if (order1[i] > -1)
-                SFApplyGSUBFeatureList(internal, order1[i]);
+            //The end index is taken again for each subtable as substitutions may add glyphs.
+            SFApplyGSUBSubtable(internal, currentLookup, j, planLookup->lookupFlag, planLookup->shortTag, 0, SFGetTotalGlyphCount(internal) - 1);
+            
+            //The substitutions may have brought glyphs the digest does not have yet, and the
+            //properties of the substituted glyphs are received again.
+            SFUpdateGlyphDigest(internal);
+            SFAddAllGlyphProperties(internal);
         }
-        
-		free(order2);
-
-        /*for (int i = 0; i < record->charCount; i++) {
-         for (int j = 0; j < record->charRecord[i].glyphCount; j++)
-         memset(&record->charRecord[i].gRec[j].posRec, 0, sizeof(SFPositionRecord));
-         }*/
-        
-        //for (int i = 0; i < order2Len; i++)
-        //    applyGSUBFeatureList(order2[i]);
     }
 }
-
@@ -14,35 +14,77 @@
  * limitations under the License.
  */
 
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "bidi.h"
+#include "SFAllocator.h"
 #include "SFGDEFUtilization.h"
 #include "SFInternal.h"
 
-const SFPositionRecord SFPositionRecordZero = {{0, 0}, {0, 0}, 0, {0, 0}};
+typedef struct SFGlyphArray {
+    size_t offset;                  //Offset of the array pointer in the string record
+    size_t size;                    //Size of a single element of the array
+} SFGlyphArray;
 
-SFStringRecord *SFMakeStringRecordForBaseLevel(SFUnichar *chars, int len, int baselevel) {
-    SFStringRecord *record = malloc(sizeof(SFStringRecord));
+#define SF_GLYPH_ARRAY_COUNT 11
+
+//Arrays are laid out in the storage in this order, from the widest elements to the narrowest, so
+//that every one of them stays aligned.
+static const SFGlyphArray SFGlyphArrays[SF_GLYPH_ARRAY_COUNT] = {
+    { offsetof(SFStringRecord, glyphChars), sizeof(int) },
+    { offsetof(SFStringRecord, fontAdvances), sizeof(int) },
+    { offsetof(SFStringRecord, xPlacements), sizeof(short) },
+    { offsetof(SFStringRecord, yPlacements), sizeof(short) },
+    { offsetof(SFStringRecord, xAdvances), sizeof(short) },
+    { offsetof(SFStringRecord, yAdvances), sizeof(short) },
+    { offsetof(SFStringRecord, xAnchors), sizeof(short) },
+    { offsetof(SFStringRecord, yAnchors), sizeof(short) },
+    { offsetof(SFStringRecord, glyphs), sizeof(SFGlyph) },
+    { offsetof(SFStringRecord, glyphProps), sizeof(SFUByte) },
+    { offsetof(SFStringRecord, anchorTypes), sizeof(SFUByte) }
+};
 
+#define SFGetGlyphArray(record, i)  (*(SFUByte **)((SFUByte *)(record) + SFGlyphArrays[i].offset))
+
+//Moves the glyph arrays to a block that has room for the given number of glyphs, keeping the
+//glyphs already in them.
+static void SFSetGlyphCapacity(SFStringRecord *record, int capacity) {
+    SFUByte *storage = SFAllocate(SFSubsystemText, SF_GLYPH_STORAGE_SIZE * capacity);
+    SFUByte *array = storage;
     int i;
     
+    for (i = 0; i < SF_GLYPH_ARRAY_COUNT; i++) {
+        if (record->glyphStorage)
+            memcpy(array, SFGetGlyphArray(record, i), SFGlyphArrays[i].size * record->glyphCount);
+        
+        SFGetGlyphArray(record, i) = array;
+        array += SFGlyphArrays[i].size * capacity;
+    }
+    
+    SFFree(SFSubsystemText, record->glyphStorage);
+    
+    record->glyphStorage = storage;
+    record->glyphCapacity = capacity;
+}
+
+SFStringRecord *SFMakeStringRecordForBaseLevel(SFUnichar *chars, int len, int baselevel) {
+    SFStringRecord *record = SFAllocate(SFSubsystemText, sizeof(SFStringRecord));
+    
     record->charCount = len;
-    record->glyphCount = len;
+    record->glyphCount = 0;
     
     record->chars = chars;
-    record->types = malloc(sizeof(int) * len);
-    record->levels = malloc(sizeof(int) * len);
-    record->charRecord = malloc(sizeof(SFCharRecord) * len);
+    record->types = SFAllocate(SFSubsystemText, sizeof(SFUByte) * len);
+    record->levels = SFAllocate(SFSubsystemText, sizeof(SFUByte) * len);
+    record->charGlyphs = SFAllocate(SFSubsystemText, sizeof(int) * (len + 1));
     
-    generateBidiTypesAndLevels(baselevel, chars, record->types, record->levels, len);
+    record->glyphStorage = NULL;
+    SFSetGlyphCapacity(record, len);
     
-    for (i = 0; i < len; i++) {
-        record->charRecord[i].glyphCount = 1;
-        record->charRecord[i].gRec = malloc(sizeof(SFGlyphRecord));
-        record->charRecord[i].gRec[0].glyphProp = gpNotReceived;
-        record->charRecord[i].gRec[0].posRec = SFPositionRecordZero;
-    }
+    generateBidiTypesAndLevels(baselevel, chars, record->types, record->levels, len);
+    SFClearGlyphs(record);
     
     record->retainChars = SFFalse;
     
@@ -52,20 +94,31 @@ SFStringRecord *SFMakeStringRecordForBaseLevel(SFUnichar *chars, int len, int ba
     return record;
 }
 
-void SFClearCharRecord(SFStringRecord *record) {
+void SFClearGlyphs(SFStringRecord *record) {
+    int count = record->charCount;
     int i;
     
-    record->glyphCount = record->glyphCount;
+    record->glyphCount = count;
     
-    for (i = 0; i < record->charCount; i++) {
-        record->charRecord[i].glyphCount = 1;
-        record->charRecord[i].gRec[0].glyphProp = gpNotReceived;
-        record->charRecord[i].gRec[0].posRec = SFPositionRecordZero;
+    for (i = 0; i < count; i++) {
+        record->charGlyphs[i] = i;
+        record->glyphChars[i] = i;
     }
+    
+    record->charGlyphs[count] = count;
+    
+    memset(record->xPlacements, 0, sizeof(short) * count);
+    memset(record->yPlacements, 0, sizeof(short) * count);
+    memset(record->xAdvances, 0, sizeof(short) * count);
+    memset(record->yAdvances, 0, sizeof(short) * count);
+    memset(record->xAnchors, 0, sizeof(short) * count);
+    memset(record->yAnchors, 0, sizeof(short) * count);
+    memset(record->glyphProps, gpNotReceived, sizeof(SFUByte) * count);
+    memset(record->anchorTypes, atNone, sizeof(SFUByte) * count);
 }
 
 void SFClearStringRecordForBaseLevel(SFStringRecord *record, int baselevel) {
-    SFClearCharRecord(record);
+    SFClearGlyphs(record);
     generateBidiTypesAndLevels(baselevel, record->chars, record->types, record->levels, record->charCount);
 }
 
@@ -90,189 +143,157 @@ void SFReleaseStringRecord(SFStringRecord *record) {
         pthread_mutex_unlock(&record->retainMutex);
         
         if (record->retainCount == 0) {
-            int i;
-            for (i = 0; i < record->charCount; i++) {
-                free(record->charRecord[i].gRec);
-            }
-            
+            //The characters are handed over by the caller, who allocates them with malloc.
             if (!record->retainChars) {
                 free(record->chars);
             }
             
-            free(record->types);
-            free(record->levels);
-            free(record->charRecord);
+            SFFree(SFSubsystemText, record->types);
+            SFFree(SFSubsystemText, record->levels);
+            SFFree(SFSubsystemText, record->charGlyphs);
+            SFFree(SFSubsystemText, record->glyphStorage);
             
-            free(record);
+            SFFree(SFSubsystemText, record);
         }
     }
 }
 
-SFGlyphIndex SFMakeGlyphIndex(int recordIndex, int glyphIndex) {
-    SFGlyphIndex index;
-    index.record = recordIndex;
-    index.glyph = glyphIndex;
-    
-    return index;
-}
-
-int SFCompareGlyphIndex(const SFGlyphIndex index1, const SFGlyphIndex index2) {
-    if (index1.record < index2.record)
-        return -1;
+//Replaces the glyph at the index with the given glyphs, which belong to the same character.
+//The glyphs after it are moved forward, growing the arrays when they have no room for them.
+void SFReplaceGlyph(SFStringRecord *record, int index, SFUShortArray glyphs, int count) {
+    int charIndex;
+    int moveCount;
+    int i;
     
-    if (index1.record > index2.record)
-        return 1;
+    if (count <= 0 || index < 0 || index >= record->glyphCount)
+        return;
     
-    if (index1.glyph < index2.glyph)
-        return -1;
+    if (record->glyphCount + count - 1 > record->glyphCapacity) {
+        int capacity = record->glyphCapacity * 2;
+        
+        if (capacity < record->glyphCount + count - 1)
+            capacity = record->glyphCount + count - 1;
+        
+        SFSetGlyphCapacity(record, capacity);
+    }
     
-    if (index1.glyph > index2.glyph)
-        return 1;
+    charIndex = record->glyphChars[index];
+    moveCount = record->glyphCount - (index + 1);
     
-    return 0;
-}
-
-void SFInsertGlyphs(SFGlyphRecord **src, const SFGlyph *val, int srcsize, int valsize, int sidx, int *length) {
-    if (valsize > 0 && sidx <= srcsize) {
-        int i = 0;
+    for (i = 0; i < SF_GLYPH_ARRAY_COUNT; i++) {
+        SFUByte *array = SFGetGlyphArray(record, i);
+        size_t size = SFGlyphArrays[i].size;
         
-        *length = sidx + valsize;
-        *src = realloc(*src, sizeof(SFGlyphRecord) * *length);
+        memmove(array + size * (index + count), array + size * (index + 1), size * moveCount);
+    }
+    
+    for (i = index; i < index + count; i++) {
+        record->glyphs[i] = SFUShortArrayGet(glyphs, i - index);
+        record->glyphProps[i] = gpNotReceived;
+        record->glyphChars[i] = charIndex;
         
-        while (sidx < valsize) {
-            (*src)[sidx].glyph = val[i++];
-            (*src)[sidx].glyphProp = gpNotReceived;
-            (*src)[sidx].posRec = SFPositionRecordZero;
-            sidx++;
-        }
+        record->xPlacements[i] = 0;
+        record->yPlacements[i] = 0;
+        record->xAdvances[i] = 0;
+        record->yAdvances[i] = 0;
+        record->anchorTypes[i] = atNone;
+        record->xAnchors[i] = 0;
+        record->yAnchors[i] = 0;
     }
+    
+    record->glyphCount += count - 1;
+    
+    for (i = charIndex + 1; i <= record->charCount; i++)
+        record->charGlyphs[i] += count - 1;
 }
 
-SFGlyphIndex SFGetLastGlyphIndex(SFStringRecord *record) {
-    SFGlyphIndex index;
-    index.record = record->charCount - 1;
-    index.glyph = record->charRecord[index.record].glyphCount - 1;
+void SFUpdateGlyphDigest(SFInternal *internal) {
+    int i;
+    
+    SFClearGlyphDigest(&internal->glyphDigest);
     
-    return index;
+    for (i = 0; i < SFGetTotalGlyphCount(internal); i++)
+        SFAddGlyphToDigest(&internal->glyphDigest, SFGetGlyph(internal, i));
 }
 
-SFBool SFGetPreviousGlyphIndex(SFInternal *internal, SFGlyphIndex *index, const LookupFlag lookupFlag) {
-	SFGlyphIndex pidx;
-	pidx.record = index->record;
-    pidx.glyph = index->glyph - 1;
-    
-    for (; pidx.record >= 0;) {
-        for (; pidx.glyph >= 0; pidx.glyph--) {
-            *index = pidx;
-			return SFTrue;
-        }
-        
-        --pidx.record;
-        pidx.glyph = SFGetGlyphCount(internal, pidx.record) - 1;
+SFBool SFGetPreviousGlyphIndex(SFInternal *internal, int *index, const LookupFlag lookupFlag) {
+    if (*index > 0) {
+        --(*index);
+        return SFTrue;
     }
     
     return SFFalse;
 }
 
-SFBool SFGetPreviousValidGlyphIndex(SFInternal *internal, SFGlyphIndex *index, const LookupFlag lookupFlag) {
-    SFGlyphIndex pidx;
-	pidx.record = index->record;
-    pidx.glyph = index->glyph - 1;
-    
-    for (; pidx.record >= 0;) {
-        for (; pidx.glyph >= 0; pidx.glyph--) {
-            if (!SFIsIgnoredGlyph(internal, pidx, lookupFlag)) {
-                *index = pidx;
-                
-                return SFTrue;
-            }
+SFBool SFGetPreviousValidGlyphIndex(SFInternal *internal, int *index, const LookupFlag lookupFlag) {
+    int pidx;
+    
+    for (pidx = *index - 1; pidx >= 0; pidx--) {
+        if (!SFIsIgnoredGlyph(internal, pidx, lookupFlag)) {
+            *index = pidx;
+            return SFTrue;
         }
-        
-        --pidx.record;
-        pidx.glyph = SFGetGlyphCount(internal, pidx.record) - 1;
     }
     
     return SFFalse;
 }
 
-SFBool SFGetNextValidGlyphIndex(SFInternal *internal, SFGlyphIndex *index, const LookupFlag lookupFlag) {
-    SFGlyphIndex nidx;
-	nidx.record = index->record;
-    nidx.glyph = index->glyph + 1;
-    
-    for (; nidx.record < internal->record->charCount;) {
-        for (; nidx.glyph < SFGetGlyphCount(internal, nidx.record); nidx.glyph++) {
-            if (!SFIsIgnoredGlyph(internal, nidx, lookupFlag)) {
-                *index = nidx;
-                
-                return SFTrue;
-            }
+SFBool SFGetNextValidGlyphIndex(SFInternal *internal, int *index, const LookupFlag lookupFlag) {
+    int nidx;
+    
+    for (nidx = *index + 1; nidx < SFGetTotalGlyphCount(internal); nidx++) {
+        if (!SFIsIgnoredGlyph(internal, nidx, lookupFlag)) {
+            *index = nidx;
+            return SFTrue;
         }
-        
-        ++nidx.record;
-        nidx.glyph = 0;
     }
     
     return SFFalse;
 }
 
-SFBool SFGetPreviousBaseGlyphIndex(SFInternal *internal, SFGlyphIndex *index, const LookupFlag lookupFlag) {
-    SFGlyphIndex pidx;
-    pidx.record = index->record;
-    pidx.glyph = index->glyph - 1;
-    
-    for (; pidx.record >= 0;) {
-        for (; pidx.glyph >= 0; pidx.glyph--) {
-            if (!SFIsIgnoredGlyph(internal, pidx, lookupFlag)) {
-                SFGlyphProperty prop = SFGetGlyphProperties(internal, pidx);
-                
-                if (prop & gpBase) {
-                    *index = pidx;
-                    return SFTrue;
-                }
-				
-				if (!(prop & gpMark)) {
-                    return SFFalse;
-                }
+SFBool SFGetPreviousBaseGlyphIndex(SFInternal *internal, int *index, const LookupFlag lookupFlag) {
+    int pidx;
+    
+    for (pidx = *index - 1; pidx >= 0; pidx--) {
+        if (!SFIsIgnoredGlyph(internal, pidx, lookupFlag)) {
+            SFGlyphProperty prop = SFGetGlyphProperties(internal, pidx);
+            
+            if (prop & gpBase) {
+                *index = pidx;
+                return SFTrue;
+            }
+            
+            if (!(prop & gpMark)) {
+                return SFFalse;
             }
         }
-        
-        --pidx.record;
-        pidx.glyph = internal->record->charRecord[pidx.record].glyphCount - 1;
     }
     
     return SFFalse;
 }
 
-SFBool SFGetPreviousLigatureGlyphIndex(SFInternal *internal, SFGlyphIndex *index, const LookupFlag lookupFlag, int *emptyGlyphs) {
-	SFGlyphIndex pidx;
-    pidx.record = index->record;
-    pidx.glyph = index->glyph - 1;
-    
-    for (; pidx.record >= 0;) {
-        for (; pidx.glyph >= 0; pidx.glyph--) {
-            SFGlyph currentGlyph = SFGetGlyph(internal, pidx);
+SFBool SFGetPreviousLigatureGlyphIndex(SFInternal *internal, int *index, const LookupFlag lookupFlag, int *emptyGlyphs) {
+    int pidx;
+    
+    for (pidx = *index - 1; pidx >= 0; pidx--) {
+        SFGlyph currentGlyph = SFGetGlyph(internal, pidx);
+        
+        if (currentGlyph == 0) {
+            ++(*emptyGlyphs);
+            continue;
+        }
+        
+        if (!SFIsIgnoredGlyph(internal, pidx, lookupFlag)) {
+            SFGlyphProperty prop = SFGetGlyphProperties(internal, pidx);
             
-            if (currentGlyph == 0) {
-                ++(*emptyGlyphs);
-                continue;
+            if (prop & gpLigature) {
+                *index = pidx;
+                return SFTrue;
             }
             
-            if (!SFIsIgnoredGlyph(internal, pidx, lookupFlag)) {
-                SFGlyphProperty prop = SFGetGlyphProperties(internal, pidx);
-                
-                if (prop & gpLigature) {
-                    *index = pidx;
-                    return SFTrue;
-                }
-				
-				if (!(prop & gpMark))
-                    return SFFalse;
-            }
+            if (!(prop & gpMark))
+                return SFFalse;
         }
-        
-        --pidx.record;
-        pidx.glyph = internal->record->charRecord[pidx.record].glyphCount - 1;
     }
     
     return SFFalse;
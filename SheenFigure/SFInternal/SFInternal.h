@@ -27,16 +27,8 @@
 #include "SFGSUBData.h"
 #include "SFGPOSData.h"
 #include "SFGSUBGPOSData.h"
-
-typedef struct SFGlyphIndex {
-    int record;
-    int glyph;
-} SFGlyphIndex;
-
-typedef struct SFPosition {
-    short x;
-    short y;
-} SFPosition;
+#include "SFScratch.h"
+#include "SFShapePlan.h"
 
 typedef enum SFAnchorType {
     atNone = 0x0000,
@@ -56,36 +48,33 @@ typedef enum SFGlyphProperty {
     gpAdvance = 32
 } SFGlyphProperty;
 
-typedef struct SFPositionRecord {
-    SFPosition placement;
-    SFPosition advance;
-    
-    SFAnchorType anchorType;
-    SFPosition anchor;             //either mark or base anchor
-} SFPositionRecord;
-
-extern const SFPositionRecord SFPositionRecordZero;
-
-typedef struct SFGlyphRecord {
-    SFGlyph glyph;
-    SFGlyphProperty glyphProp;
-    SFPositionRecord posRec;
-    float advance;
-} SFGlyphRecord;
-
-typedef struct SFCharRecord {
-    int glyphCount;
-    SFGlyphRecord *gRec;            //glyphs[glyphCount]
-} SFCharRecord;
-
+//The glyphs of all characters are kept in a single run in the order of the characters. The
+//glyphs of a character are the ones from its first glyph up to the first glyph of the next one.
+//Every property of the glyphs lives in an array of its own, so that passes touching a single
+//property walk contiguous memory. All glyph arrays are carved out of one block of storage.
 typedef struct SFStringRecord {
     int charCount;
-    int glyphCount;
+    int glyphCount;                 //Number of glyphs in the glyph arrays, including the ones
+                                    //emptied by ligatures
+    int glyphCapacity;              //Number of glyphs the glyph arrays have room for
     
     SFUnichar *chars;               //chars[charCount]
-    int *types;                     //types[charCount]
-    int *levels;                    //levels[charCount]
-    SFCharRecord *charRecord;       //charRecord[charCount]
+    SFUByte *types;                 //types[charCount]
+    SFUByte *levels;                //levels[charCount]
+    int *charGlyphs;                //charGlyphs[charCount + 1], first glyph of every character
+    
+    void *glyphStorage;             //Block holding all of the glyph arrays
+    int *glyphChars;                //Index of the character every glyph is produced for
+    int *fontAdvances;              //Advances of the glyphs in the font, valid with gpAdvance
+    short *xPlacements;
+    short *yPlacements;
+    short *xAdvances;
+    short *yAdvances;
+    short *xAnchors;                //Either mark, base or cursive anchor
+    short *yAnchors;
+    SFGlyph *glyphs;
+    SFUByte *glyphProps;            //Values of SFGlyphProperty
+    SFUByte *anchorTypes;           //Values of SFAnchorType
     
     SFBool retainChars;
     
@@ -93,16 +82,23 @@ typedef struct SFStringRecord {
     SFUInt retainCount;
 } SFStringRecord;
 
+//Bytes taken by a single glyph across the glyph arrays.
+#define SF_GLYPH_STORAGE_SIZE       (sizeof(int) * 2 + sizeof(short) * 6 + sizeof(SFGlyph) + sizeof(SFUByte) * 2)
+
 typedef struct SFInternal {
     SFStringRecord *record;
     SFTableCMAP *cmap;
     SFTableGDEF *gdef;
     SFTableGSUB *gsub;
     SFTableGPOS *gpos;
+    SFArena *arena;
+    const SFShapePlan *plan;        //Lookups applied to the string
+    SFScratch *scratch;             //Temporary memory of the shaper
+    SFGlyphDigest glyphDigest;      //Digest of the glyphs in the string record
 } SFInternal;
 
 SFStringRecord *SFMakeStringRecordForBaseLevel(SFUnichar *chars, int len, int baselevel);
-void SFClearCharRecord(SFStringRecord *record);
+void SFClearGlyphs(SFStringRecord *record);
 void SFClearStringRecordForBaseLevel(SFStringRecord *record, int baselevel);
 SFStringRecord *SFRetainStringRecord(SFStringRecord *record);
 void SFReleaseStringRecord(SFStringRecord *record);
@@ -112,22 +108,30 @@ void SFReleaseStringRecord(SFStringRecord *record);
 #define SFGetChar(p, i)             (p->record->chars[i])
 #define SFGetCharCount(p)           (p->record->charCount)
 #define SFGetTotalGlyphCount(p)     (p->record->glyphCount)
-#define SFGetGlyph(p, i)            (p->record->charRecord[i.record].gRec[i.glyph].glyph)
-#define SFGetGlyphCount(p, i)       (p->record->charRecord[i].glyphCount)
-#define SFGetGlyphRecord(p, i)      (p->record->charRecord[i].gRec)
-#define SFGetGlyphProperties(p, i)  (p->record->charRecord[i.record].gRec[i.glyph].glyphProp)
-#define SFGetPositionRecord(p, i)   (p->record->charRecord[i.record].gRec[i.glyph].posRec)
-
-SFGlyphIndex SFMakeGlyphIndex(int recordIndex, int glyphIndex);
-int SFCompareGlyphIndex(const SFGlyphIndex index1, const SFGlyphIndex index2);
-void SFInsertGlyphs(SFGlyphRecord **src, const SFGlyph *val, int srcsize, int valsize, int sidx, int *length);
-SFGlyphIndex SFGetLastGlyphIndex(SFStringRecord *record);
-
-SFBool SFGetPreviousGlyphIndex(SFInternal *internal, SFGlyphIndex *index, const LookupFlag lookupFlag);
-SFBool SFGetPreviousValidGlyphIndex(SFInternal *internal, SFGlyphIndex *index, const LookupFlag lookupFlag);
-SFBool SFGetNextValidGlyphIndex(SFInternal *internal, SFGlyphIndex *index, const LookupFlag lookupFlag);
-
-SFBool SFGetPreviousBaseGlyphIndex(SFInternal *internal, SFGlyphIndex *index, const LookupFlag lookupFlag);
-SFBool SFGetPreviousLigatureGlyphIndex(SFInternal *internal, SFGlyphIndex *index, const LookupFlag lookupFlag, int *emptyGlyphs);
+#define SFGetFirstGlyphOfChar(p, i) (p->record->charGlyphs[i])
+#define SFGetGlyphCount(p, i)       (p->record->charGlyphs[(i) + 1] - p->record->charGlyphs[i])
+#define SFGetGlyph(p, i)            (p->record->glyphs[i])
+#define SFGetGlyphProperties(p, i)  (p->record->glyphProps[i])
+#define SFGetCharOfGlyph(p, i)      (p->record->glyphChars[i])
+
+#define SFGetXPlacement(p, i)       (p->record->xPlacements[i])
+#define SFGetYPlacement(p, i)       (p->record->yPlacements[i])
+#define SFGetXAdvance(p, i)         (p->record->xAdvances[i])
+#define SFGetYAdvance(p, i)         (p->record->yAdvances[i])
+#define SFGetAnchorType(p, i)       (p->record->anchorTypes[i])
+#define SFGetXAnchor(p, i)          (p->record->xAnchors[i])
+#define SFGetYAnchor(p, i)          (p->record->yAnchors[i])
+
+#define SFIsGlyphOfOddLevel(p, i)   SFIsOddLevel(p, SFGetCharOfGlyph(p, i))
+
+void SFReplaceGlyph(SFStringRecord *record, int index, SFUShortArray glyphs, int count);
+void SFUpdateGlyphDigest(SFInternal *internal);
+
+SFBool SFGetPreviousGlyphIndex(SFInternal *internal, int *index, const LookupFlag lookupFlag);
+SFBool SFGetPreviousValidGlyphIndex(SFInternal *internal, int *index, const LookupFlag lookupFlag);
+SFBool SFGetNextValidGlyphIndex(SFInternal *internal, int *index, const LookupFlag lookupFlag);
+
+SFBool SFGetPreviousBaseGlyphIndex(SFInternal *internal, int *index, const LookupFlag lookupFlag);
+SFBool SFGetPreviousLigatureGlyphIndex(SFInternal *internal, int *index, const LookupFlag lookupFlag, int *emptyGlyphs);
 
 #endif
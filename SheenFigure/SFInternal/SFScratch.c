@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include "SFAllocator.h"
+#include "SFScratch.h"
+
+#define SF_SCRATCH_MIN_BLOCK_SIZE   (4 * 1024)
+#define SF_SCRATCH_HEADER_SIZE      SF_SCRATCH_ALIGN(sizeof(SFScratchBlock))
+
+void SFScratchInitialize(SFScratch *scratch) {
+    scratch->firstBlock = NULL;
+    scratch->currentBlock = NULL;
+}
+
+//Adds a block that fits the size right after the current one. The blocks following the current
+//one hold nothing, so their order does not matter.
+static SFScratchBlock *SFScratchAddBlock(SFScratch *scratch, size_t size) {
+    SFScratchBlock *current = scratch->currentBlock;
+    SFScratchBlock *block;
+    size_t blockSize;
+    
+    blockSize = current ? current->size * 2 : SF_SCRATCH_MIN_BLOCK_SIZE;
+    if (blockSize < size)
+        blockSize = size;
+    
+    block = SFAllocate(SFSubsystemShaper, SF_SCRATCH_HEADER_SIZE + blockSize);
+    block->size = blockSize;
+    block->used = 0;
+    
+    if (current) {
+        block->next = current->next;
+        current->next = block;
+    } else {
+        block->next = NULL;
+        scratch->firstBlock = block;
+    }
+    
+    return block;
+}
+
+void *SFScratchPush(SFScratch *scratch, size_t size) {
+    SFScratchBlock *block = scratch->currentBlock;
+    void *memory;
+    
+    size = SF_SCRATCH_ALIGN(size);
+    
+    if (!block || block->size - block->used < size) {
+        //Move on to the first of the following blocks that is big enough.
+        for (block = block ? block->next : NULL; block; block = block->next) {
+            if (block->size >= size)
+                break;
+        }
+        
+        if (!block)
+            block = SFScratchAddBlock(scratch, size);
+        
+        block->used = 0;
+        scratch->currentBlock = block;
+    }
+    
+    memory = (SFUByte *)block + SF_SCRATCH_HEADER_SIZE + block->used;
+    block->used += size;
+    
+    return memory;
+}
+
+SFScratchMark SFScratchGetMark(SFScratch *scratch) {
+    SFScratchMark mark;
+    
+    mark.block = scratch->currentBlock;
+    mark.used = mark.block ? mark.block->used : 0;
+    
+    return mark;
+}
+
+void SFScratchRewind(SFScratch *scratch, SFScratchMark mark) {
+    if (mark.block) {
+        scratch->currentBlock = mark.block;
+        mark.block->used = mark.used;
+    } else if (scratch->firstBlock) {
+        scratch->currentBlock = scratch->firstBlock;
+        scratch->firstBlock->used = 0;
+    }
+}
+
+size_t SFScratchGetSize(SFScratch *scratch) {
+    SFScratchBlock *block;
+    size_t size = 0;
+    
+    for (block = scratch->firstBlock; block; block = block->next)
+        size += SF_SCRATCH_HEADER_SIZE + block->size;
+    
+    return size;
+}
+
+void SFScratchFinalize(SFScratch *scratch) {
+    SFScratchBlock *block = scratch->firstBlock;
+    
+    while (block) {
+        SFScratchBlock *next = block->next;
+        SFFree(SFSubsystemShaper, block);
+        
+        block = next;
+    }
+    
+    scratch->firstBlock = NULL;
+    scratch->currentBlock = NULL;
+}
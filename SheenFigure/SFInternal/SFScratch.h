@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _SF_SCRATCH_H
+#define _SF_SCRATCH_H
+
+#include <stddef.h>
+
+#include "SFConfig.h"
+#include "SFTypes.h"
+
+#define SF_SCRATCH_ALIGNMENT    8
+#define SF_SCRATCH_ALIGN(size)  (((size) + (SF_SCRATCH_ALIGNMENT - 1)) & ~(size_t)(SF_SCRATCH_ALIGNMENT - 1))
+
+typedef struct SFScratchBlock {
+    struct SFScratchBlock *next;
+    size_t size;                    //Number of bytes that can be handed out from the block
+    size_t used;                    //Number of bytes handed out and not yet rewound
+} SFScratchBlock;
+
+//A stack of temporary memory. Blocks are kept after being rewound, so that once the scratch
+//has grown to fit the work done with it, handing out memory costs no allocation.
+typedef struct SFScratch {
+    SFScratchBlock *firstBlock;
+    SFScratchBlock *currentBlock;   //Block memory is handed out from, NULL if there are no blocks
+} SFScratch;
+
+typedef struct SFScratchMark {
+    SFScratchBlock *block;
+    size_t used;
+} SFScratchMark;
+
+void SFScratchInitialize(SFScratch *scratch);
+
+//Returns uninitialized memory that stays valid until the scratch is rewound past it.
+void *SFScratchPush(SFScratch *scratch, size_t size);
+
+//Returns the current top of the scratch, for giving back everything pushed after it.
+SFScratchMark SFScratchGetMark(SFScratch *scratch);
+void SFScratchRewind(SFScratch *scratch, SFScratchMark mark);
+
+//Returns the number of bytes taken by the blocks of the scratch.
+size_t SFScratchGetSize(SFScratch *scratch);
+
+void SFScratchFinalize(SFScratch *scratch);
+
+#endif
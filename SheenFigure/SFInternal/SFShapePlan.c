@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string.h>
+
+#include "SFAllocator.h"
+#include "SFShapePlan.h"
+
+#define GSUB_FEATURE_TAGS 8
+static const char gsubFeaturesTagOrder[GSUB_FEATURE_TAGS][5] = {
+    "ccmp",
+    "init",
+    "medi",
+    "fina",
+    "isol",
+    "rlig",
+    "calt",
+    "liga",
+};
+
+#define GPOS_FEATURE_TAGS 4
+static const char gposFeaturesTagOrder[GPOS_FEATURE_TAGS][5] = {
+    "curs",                         //Cursive positioning
+    "kern",                         //Pair kerning
+    "mark",                         //Mark to base positioning
+    "mkmk"                          //Mark to mark positioning
+};
+
+static ShortTag getShortTag(const unsigned char tag[5]) {
+    ShortTag stag = stOther;
+    if (tag[0] == 'i' && tag[1] == 'n' && tag[2] == 'i' && tag[3] == 't')
+        stag = stInit;
+    else if (tag[0] == 'm' && tag[1] == 'e' && tag[2] == 'd' && tag[3] == 'i')
+        stag = stMedi;
+    else if (tag[0] == 'f' && tag[1] == 'i' && tag[2] == 'n' && tag[3] == 'a')
+        stag = stFina;
+    
+    return stag;
+}
+
+static int getIndexOfFeatureTag(const char tagOrder[][5], int tagCount, const unsigned char tag[5]) {
+    int i;
+    for (i = 0; i < tagCount; i++) {
+        if (strcmp(tagOrder[i], (const char *)tag) == 0)
+            return i;
+    }
+    
+    return -1;
+}
+
+static LangSysTable *getLangSys(ScriptListTable *scriptList, SFUInt scriptTag, SFUInt languageTag) {
+    LangSysTable *langSys = NULL;
+    int i, j;
+    
+    //The last record of the script is used if there are several of them. A language the
+    //script does not have falls back to the default language system.
+    for (i = 0; i < scriptList->scriptCount; i++) {
+        ScriptRecord *record = &scriptList->scriptRecord[i];
+        
+        if (SFMakeTagOfString(record->scriptTag) == scriptTag) {
+            langSys = &record->script.defaultLangSys;
+            
+            if (languageTag != SF_TAG_DEFAULT_LANGUAGE) {
+                for (j = 0; j < record->script.langSysCount; j++) {
+                    if (SFMakeTagOfString(record->script.langSysRecord[j].LangSysTag) == languageTag) {
+                        langSys = &record->script.langSysRecord[j].LangSys;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    
+    return langSys;
+}
+
+//Puts the features of the language system in the order they are applied, returning their
+//number. Features with a tag of the order come first, the last of them winning if several
+//have the same tag, followed by the others in the order of the language system if they are
+//applied at all. The features array must have room for the tags along with the features.
+static int getFeatureOrder(LangSysTable *langSys, FeatureListTable *featureList, const char tagOrder[][5], int tagCount, SFBool appliesOthers, int *features) {
+    int otherCount = 0;
+    int count = 0;
+    int i;
+    
+    for (i = 0; i < tagCount; i++)
+        features[i] = -1;
+    
+    for (i = 0; i < langSys->featureCount; i++) {
+        int featureIndex = SFUShortArrayGet(langSys->featureIndex, i);
+        int tagIndex = getIndexOfFeatureTag(tagOrder, tagCount, featureList->featureRecord[featureIndex].featureTag);
+        
+        if (tagIndex > -1)
+            features[tagIndex] = featureIndex;
+        else if (appliesOthers)
+            features[tagCount + otherCount++] = featureIndex;
+    }
+    
+    //The tags the language system does not have are left out.
+    for (i = 0; i < tagCount + otherCount; i++) {
+        if (features[i] > -1)
+            features[count++] = features[i];
+    }
+    
+    return count;
+}
+
+static int countLookups(FeatureListTable *featureList, const int *features, int featureCount) {
+    int count = 0;
+    int i;
+    
+    for (i = 0; i < featureCount; i++)
+        count += featureList->featureRecord[features[i]].feature.lookupCount;
+    
+    return count;
+}
+
+static void fillGSUBLookups(SFTableGSUB *gsub, const int *features, int featureCount, SFPlanLookup *lookups, SFArena *arena) {
+    int count = 0;
+    int i, j;
+    
+    for (i = 0; i < featureCount; i++) {
+        FeatureRecord *record = &gsub->featureList.featureRecord[features[i]];
+        ShortTag stag = getShortTag(record->featureTag);
+        
+        for (j = 0; j < record->feature.lookupCount; j++) {
+            SFPlanLookup *planLookup = &lookups[count++];
+            
+            planLookup->lookup = SFGetGSUBLookup(gsub, SFUShortArrayGet(record->feature.lookupListIndex, j), arena);
+            planLookup->lookupFlag = planLookup->lookup->lookupFlag;
+            planLookup->shortTag = stag;
+            
+            //Single and multiple substitutions of joining forms look past the marks between
+            //the letters.
+            if (stag != stOther
+                && (planLookup->lookup->lookupType == ltsSingle || planLookup->lookup->lookupType == ltsMultiple))
+                planLookup->lookupFlag |= lfIgnoreMarks;
+        }
+    }
+}
+
+static void fillGPOSLookups(SFTableGPOS *gpos, const int *features, int featureCount, SFPlanLookup *lookups, SFArena *arena) {
+    int count = 0;
+    int i, j;
+    
+    for (i = 0; i < featureCount; i++) {
+        FeatureRecord *record = &gpos->featureList.featureRecord[features[i]];
+        
+        for (j = 0; j < record->feature.lookupCount; j++) {
+            SFPlanLookup *planLookup = &lookups[count++];
+            
+            planLookup->lookup = SFGetGPOSLookup(gpos, SFUShortArrayGet(record->feature.lookupListIndex, j), arena);
+            planLookup->lookupFlag = planLookup->lookup->lookupFlag;
+            planLookup->shortTag = stOther;
+        }
+    }
+}
+
+SFShapePlan *SFMakeShapePlan(SFTableGSUB *gsub, SFTableGPOS *gpos, SFUInt scriptTag, SFUInt languageTag, SFArena *arena) {
+    LangSysTable *gsubLangSys = NULL;
+    LangSysTable *gposLangSys = NULL;
+    
+    int *gsubFeatures = NULL;
+    int *gposFeatures = NULL;
+    int gsubFeatureCount = 0;
+    int gposFeatureCount = 0;
+    
+    SFShapePlan *plan;
+    
+    if (gsub)
+        gsubLangSys = getLangSys(&gsub->scriptList, scriptTag, languageTag);
+    
+    if (gpos)
+        gposLangSys = getLangSys(&gpos->scriptList, scriptTag, languageTag);
+    
+    //Features of GSUB without a tag of the order are not applied.
+    if (gsubLangSys) {
+        gsubFeatures = SFAllocate(SFSubsystemTables, sizeof(int) * (GSUB_FEATURE_TAGS + gsubLangSys->featureCount));
+        gsubFeatureCount = getFeatureOrder(gsubLangSys, &gsub->featureList, gsubFeaturesTagOrder, GSUB_FEATURE_TAGS, SFFalse, gsubFeatures);
+    }
+    
+    if (gposLangSys) {
+        gposFeatures = SFAllocate(SFSubsystemTables, sizeof(int) * (GPOS_FEATURE_TAGS + gposLangSys->featureCount));
+        gposFeatureCount = getFeatureOrder(gposLangSys, &gpos->featureList, gposFeaturesTagOrder, GPOS_FEATURE_TAGS, SFTrue, gposFeatures);
+    }
+    
+    SFArenaLock(arena);
+    
+    plan = SFArenaAllocate(arena, sizeof(SFShapePlan));
+    plan->scriptTag = scriptTag;
+    plan->languageTag = languageTag;
+    
+    plan->hasGSUBScript = (gsubLangSys != NULL);
+    plan->gsubLookupCount = 0;
+    
+    if (gsubLangSys) {
+        plan->gsubLookupCount = countLookups(&gsub->featureList, gsubFeatures, gsubFeatureCount);
+        plan->gsubLookups = SFArenaAllocate(arena, sizeof(SFPlanLookup) * plan->gsubLookupCount);
+    }
+    
+    plan->hasGPOSScript = (gposLangSys != NULL);
+    plan->gposLookupCount = 0;
+    
+    if (gposLangSys) {
+        plan->gposLookupCount = countLookups(&gpos->featureList, gposFeatures, gposFeatureCount);
+        plan->gposLookups = SFArenaAllocate(arena, sizeof(SFPlanLookup) * plan->gposLookupCount);
+    }
+    
+    SFArenaUnlock(arena);
+    
+    //Loading the lookups takes the lock of the arena by itself.
+    if (gsubLangSys)
+        fillGSUBLookups(gsub, gsubFeatures, gsubFeatureCount, plan->gsubLookups, arena);
+    
+    if (gposLangSys)
+        fillGPOSLookups(gpos, gposFeatures, gposFeatureCount, plan->gposLookups, arena);
+    
+    SFFree(SFSubsystemTables, gsubFeatures);
+    SFFree(SFSubsystemTables, gposFeatures);
+    
+    return plan;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2013 SheenFigure
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef _SF_SHAPE_PLAN_H
+#define _SF_SHAPE_PLAN_H
+
+#include "SFConfig.h"
+#include "SFTypes.h"
+#include "SFArena.h"
+#include "SFCommonData.h"
+#include "SFGSUBData.h"
+#include "SFGPOSData.h"
+
+//Tags of scripts and languages are compared as numbers made of their four bytes.
+#define SFMakeTag(a, b, c, d)       (((SFUInt)(a) << 24) | ((SFUInt)(b) << 16) | ((SFUInt)(c) << 8) | (SFUInt)(d))
+#define SFMakeTagOfString(s)        SFMakeTag((s)[0], (s)[1], (s)[2], (s)[3])
+
+#define SF_TAG_ARAB                 SFMakeTag('a', 'r', 'a', 'b')
+#define SF_TAG_DEFAULT_LANGUAGE     0
+
+typedef enum {
+    stInit,
+    stMedi,
+    stFina,
+    stOther,
+} ShortTag;
+
+typedef struct SFPlanLookup {
+    LookupTable *lookup;
+    LookupFlag lookupFlag;          //Flag the subtables of the lookup are applied with
+    ShortTag shortTag;              //Joining form the substitutions of the feature produce
+} SFPlanLookup;
+
+//Lookups of a script and language in the order they are applied, with the features they
+//come from already resolved, so that shaping a string only has to walk them.
+typedef struct SFShapePlan {
+    SFUInt scriptTag;
+    SFUInt languageTag;             //SF_TAG_DEFAULT_LANGUAGE for the default language system
+    
+    SFBool hasGSUBScript;           //Whether GSUB has the script
+    int gsubLookupCount;
+    SFPlanLookup *gsubLookups;
+    
+    SFBool hasGPOSScript;           //Whether GPOS has the script
+    int gposLookupCount;
+    SFPlanLookup *gposLookups;
+    
+    struct SFShapePlan *next;       //Next plan made for the same tables
+} SFShapePlan;
+
+//Makes the plan of a script and language for the given tables, either of which may be NULL.
+//The lookups of the plan are loaded if they are not yet, and the plan lives in the arena.
+SFShapePlan *SFMakeShapePlan(SFTableGSUB *gsub, SFTableGPOS *gpos, SFUInt scriptTag, SFUInt languageTag, SFArena *arena);
+
+#endif
@@ -326,11 +326,11 @@ int NTypes[] = {
     ON,     // LS
 };
 
-int ClassFromChN(SFUnichar ch) {
+int ClassFromChN(SFCodepoint ch) {
     return NTypes[getTypeOfChar(ch)];
 }
 
-int ClassFromChWS(SFUnichar ch) {
+int ClassFromChWS(SFCodepoint ch) {
     return getTypeOfChar(ch);
 }
 
@@ -350,7 +350,7 @@ void reverseLogicalOrder(int *visOrder, int cch) {
 
 // Set a run of cval values at locations all prior to, but not including
 // iStart, to the new value nval.
-void SetDeferredRun(int *pval, int cval, int iStart, int nval) {
+void SetDeferredRun(SFUByte *pval, int cval, int iStart, int nval) {
     int i;
     
     for (i = iStart - 1; i >= iStart - cval; i--) {
@@ -372,19 +372,22 @@ void SetDeferredRun(int *pval, int cval, int iStart, int nval) {
 
     Output: Array of directional classes
 ------------------------------------------------------------------------*/
-int classify(const SFUnichar *pszText, int *pcls, int cch, SFBool fWS) {
+int classify(const SFUnichar *pszText, SFUByte *pcls, int cch, SFBool fWS) {
     int ich = 0;
     
-    if (fWS) {
-        for (; ich < cch; ich++) {
-            pcls[ich] = ClassFromChWS(pszText[ich]);
-        }
-        
-        return ich;
-    }
-
     for (; ich < cch; ich++) {
-        pcls[ich] = ClassFromChN(pszText[ich]);
+        SFCodepoint ch = pszText[ich];
+        
+        // both units of a surrogate pair take the class of the whole character
+        if (SFIsSurrogatePair(pszText, cch, ich))
+            ch = SFMakeCodepoint(ch, pszText[ich + 1]);
+        
+        pcls[ich] = (fWS ? ClassFromChWS(ch) : ClassFromChN(ch));
+        
+        if (ch > 0xFFFF) {
+            ich++;
+            pcls[ich] = pcls[ich - 1];
+        }
     }
     
     return ich;
@@ -404,7 +407,7 @@ int classify(const SFUnichar *pszText, int *pcls, int cch, SFBool fWS) {
 
     Note: Ignores explicit embeddings
 ------------------------------------------------------------------------*/
-int baseLevel(const int *pcls, int cch) {
+int baseLevel(const SFUByte *pcls, int cch) {
     int ich;
 
     for (ich = 0; ich < cch; ich++) {
@@ -463,7 +466,7 @@ int EmbeddingDirection(int level) {
 
 const int MAX_LEVEL = 61; // the real value
 
-int resolveExplicit(int level, int dir, int *pcls, int *plevel, int cch, int nNest) {
+int resolveExplicit(int level, int dir, SFUByte *pcls, SFUByte *plevel, int cch, int nNest) {
     // always called with a valid nesting level
     // nesting levels are != embedding levels
     int nLastValid;
@@ -704,7 +707,7 @@ int GetResolvedType(int action) {
     Note: On input only these directional classes are expected
           AL, HL, R, L,  ON, BN, NSM, AN, EN, ES, ET, CS,
 ------------------------------------------------------------------------*/
-void resolveWeak(int baselevel, int *pcls, int *plevel, int cch) {
+void resolveWeak(int baselevel, SFUByte *pcls, SFUByte *plevel, int cch) {
     int state = odd(baselevel) ? xl : xr;
     int action;
     
@@ -885,7 +888,7 @@ int stateNeutrals[][5] = {
 
           W8 resolves a number of ENs to L
 ------------------------------------------------------------------------*/
-void resolveNeutrals(int baselevel, int *pcls, const int *plevel, int cch) {
+void resolveNeutrals(int baselevel, SFUByte *pcls, const SFUByte *plevel, int cch) {
     // the state at the start of text depends on the base level
     int state = odd(baselevel) ? l : r;
     int action;
@@ -974,7 +977,7 @@ int addLevel[][4] = {
     /* odd  */    //1,    0,    1,    1,    // ODD
 };
 
-void resolveImplicit(const int *pcls, int *plevel, int cch) {
+void resolveImplicit(const SFUByte *pcls, SFUByte *plevel, int cch) {
     int ich;
 
     for (ich = 0; ich < cch; ich++) {
@@ -1006,7 +1009,7 @@ void resolveImplicit(const int *pcls, int *plevel, int cch) {
           a real implementation, cch and the initial pointer values
           would have to be adjusted.
 ------------------------------------------------------------------------*/
-void resolveWhitespace(int baselevel, const int *pcls, int *plevel, int cch) {
+void resolveWhitespace(int baselevel, const SFUByte *pcls, SFUByte *plevel, int cch) {
     int cchrun = 0;
     int oldlevel = baselevel;
     
@@ -1069,7 +1072,7 @@ void resolveWhitespace(int baselevel, const int *pcls, int *plevel, int cch) {
     Note: this should be applied a line at a time
 -------------------------------------------------------------------------*/
 
-int reorderLevel(int level, int *plevel, int *visOrder, int cch, SFBool fReverse) {
+int reorderLevel(int level, SFUByte *plevel, int *visOrder, int cch, SFBool fReverse) {
     int ich;
     
     // true as soon as first odd level encountered
@@ -1093,7 +1096,7 @@ int reorderLevel(int level, int *plevel, int *visOrder, int cch, SFBool fReverse
     return ich;
 }
 
-int reorder(int baselevel, int *plevel, int *visOrder, int cch) {
+int reorder(int baselevel, SFUByte *plevel, int *visOrder, int cch) {
     int ich = 0;
     
     while (ich < cch) {
@@ -1103,16 +1106,6 @@ int reorder(int baselevel, int *plevel, int *visOrder, int cch) {
     return ich;
 }
 
-static void saveMirroredChar(SFMirroredChar **current, int index, SFUnichar ch) {
-    SFMirroredChar *next = malloc(sizeof(SFMirroredChar));
-    next->index = index;
-    next->ch = ch;
-    next->next = NULL;
-    
-    (*current)->next = next;
-    *current = next;
-}
-
 // === DISPLAY OPTIONS ================================================
 /*-----------------------------------------------------------------------
     Function:    generateMirroredChars
@@ -1126,20 +1119,19 @@ static void saveMirroredChar(SFMirroredChar **current, int index, SFUnichar ch)
 
     In/Out: Array of characters (should be array of glyph ids)
 
+    Output: Array of mirrored characters with their indexes
+            Caller must allocate (at most one per input character)
+
+    Returns the number of mirrored characters
+
     Note:
     A full implementation would need to substitute mirrored glyphs even
     for characters that are not paired (e.g. integral sign).
 -----------------------------------------------------------------------*/
-SFMirroredChar *generateMirroredChars(const SFUnichar *pszInput, const int *plevel, int cch) {
-    SFMirroredChar *main = malloc(sizeof(SFMirroredChar));
-    SFMirroredChar *current = main;
-    
+int generateMirroredChars(const SFUnichar *pszInput, const SFUByte *plevel, int cch, SFMirroredChar *mirrors) {
     SFUnichar tmp = 0;
+    int count = 0;
     int ich = 0;
-
-    main->index = -1;
-    main->ch = -1;
-    main->next = NULL;
     
     for (; ich < cch; ich ++) {
         if (odd(plevel[ich])) {
@@ -1147,11 +1139,13 @@ SFMirroredChar *generateMirroredChars(const SFUnichar *pszInput, const int *plev
         }
         
         if (getMirroredChar(pszInput[ich], &tmp)) {
-            saveMirroredChar(&current, ich, tmp);
+            mirrors[count].index = ich;
+            mirrors[count].ch = tmp;
+            count++;
         }
     }
     
-    return main;
+    return count;
 }
 
 // === BIDI INTERFACE FUNCTIONS ========================================
@@ -1169,7 +1163,7 @@ SFMirroredChar *generateMirroredChars(const SFUnichar *pszInput, const int *plev
              Array of levels
  ------------------------------------------------------------------------*/
  
-void generateBidiVisualOrder(int baselevel, const int *pclsLine, int *plevelLine, int *visOrder, int cchPara) {
+void generateBidiVisualOrder(int baselevel, const SFUByte *pclsLine, SFUByte *plevelLine, int *visOrder, int cchPara) {
     // resolve whitespace
     resolveWhitespace(baselevel, pclsLine, plevelLine, cchPara);
     
@@ -1180,7 +1174,7 @@ void generateBidiVisualOrder(int baselevel, const int *pclsLine, int *plevelLine
     reorder(baselevel, plevelLine, visOrder, cchPara);
 }
 
-void generateBidiTypesAndLevels(int baselevel, const SFUnichar *pszInput, int *types, int *levels, int cch) {
+void generateBidiTypesAndLevels(int baselevel, const SFUnichar *pszInput, SFUByte *types, SFUByte *levels, int cch) {
     // assign directional types
     classify(pszInput, types, cch, SFFalse);
     
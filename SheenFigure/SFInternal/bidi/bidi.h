@@ -22,13 +22,11 @@
 typedef struct SFMirroredChar {
     int index;
     SFUnichar ch;
-    
-    struct SFMirroredChar *next;
 } SFMirroredChar;
 
-int baseLevel(const int *pcls, int cch);
-SFMirroredChar *generateMirroredChars(const SFUnichar *pszInput, const int *plevel, int cch);
-void generateBidiVisualOrder(int baselevel, const int *pclsLine, int *plevelLine, int *visOrder, int cchPara);
-void generateBidiTypesAndLevels(int baselevel, const SFUnichar *pszInput, int *types, int *levels, int cch);
+int baseLevel(const SFUByte *pcls, int cch);
+int generateMirroredChars(const SFUnichar *pszInput, const SFUByte *plevel, int cch, SFMirroredChar *mirrors);
+void generateBidiVisualOrder(int baselevel, const SFUByte *pclsLine, SFUByte *plevelLine, int *visOrder, int cchPara);
+void generateBidiTypesAndLevels(int baselevel, const SFUnichar *pszInput, SFUByte *types, SFUByte *levels, int cch);
 
 #endif
@@ -54,6 +54,6 @@ SFBool getMirroredChar(SFUnichar ch, SFUnichar *mirror) {
     return found;
 }
 
-int getTypeOfChar(SFUnichar ch) {
+int getTypeOfChar(SFCodepoint ch) {
     return (unsigned char)FRIBIDI_GET_TYPE(ch);
 }
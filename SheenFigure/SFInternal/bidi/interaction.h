@@ -20,6 +20,6 @@
 #include "bidi_class.h"
 
 SFBool getMirroredChar(SFUnichar ch, SFUnichar *mirror);
-int getTypeOfChar(SFUnichar uch);
+int getTypeOfChar(SFCodepoint uch);
 
 #endif
\ No newline at end of file
@@ -41,6 +41,16 @@ typedef uint16_t                        SFUShort;
 typedef uint32_t                        SFUInt;
 
 typedef SFUShort 						SFUnichar;
+typedef SFUInt                          SFCodepoint;
 typedef SFUShort                        SFGlyph;
 
+//Text is given as UTF-16, characters outside the BMP are combined out of surrogate pairs
+//while shaping.
+#define SFIsHighSurrogate(ch)           ((ch) >= 0xD800 && (ch) <= 0xDBFF)
+#define SFIsLowSurrogate(ch)            ((ch) >= 0xDC00 && (ch) <= 0xDFFF)
+#define SFIsSurrogatePair(chars, count, i)  \
+    (SFIsHighSurrogate((chars)[i]) && (i) + 1 < (count) && SFIsLowSurrogate((chars)[(i) + 1]))
+#define SFMakeCodepoint(high, low)      \
+    ((((SFCodepoint)(high) - 0xD800) << 10) + ((SFCodepoint)(low) - 0xDC00) + 0x10000)
+
 #endif